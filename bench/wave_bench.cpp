@@ -0,0 +1,732 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- wave_bench --
+
+    Benchmarks for the I/O and conversion hot paths.  Synthetic wave
+    files for every supported bit depth in mono and stereo are
+    generated at startup in a temporary directory, then each
+    benchmark is run a few times and the best time is kept.
+
+    Results are printed as CSV by default, or as JSON with --json,
+    so they can be saved and compared between releases.
+
+    usage: wave_bench [--json] [--seconds n] [--repeat n] [--out file]
+*/
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include "WaveFile.h"
+#include "AudioExpr.h"
+#include "SampleConversion.h"
+#include "Convolver.h"
+#include "Mixer.h"
+#include "ParallelProcessor.h"
+#include "PeakIndex.h"
+#include "SampleRateConverter.h"
+#include "SignalGenerator.h"
+#include "WaveStream.h"
+#include "WaveScanner.h"
+#include "WaveView.h"
+#include "AsyncWaveStream.h"
+#include "CaptureWriter.h"
+#include "RingBuffer.h"
+using namespace std;
+
+namespace {
+
+struct BenchResult {
+    string name;
+    uint16_t bitDepth;
+    uint16_t nChannels;
+    double value;
+    string unit;
+};
+
+struct BenchOptions {
+    bool json{false};
+    uint32_t seconds{30};
+    int repeat{3};
+    string outFileName;
+};
+
+const uint32_t SAMPLE_RATE = 44100;
+const uint32_t BLOCK_FRAMES = 4096;
+
+// a sink for results so the benchmarked loops are not optimized away
+volatile double g_sink;
+
+// runs f repeat times and returns the best time in seconds
+template <typename F>
+double bestTime(int repeat, F f) {
+    double best = numeric_limits<double>::max();
+    for (int i = 0; i < repeat; ++i) {
+        auto start = chrono::steady_clock::now();
+        f();
+        auto end = chrono::steady_clock::now();
+        best = min(best, chrono::duration<double>(end - start).count());
+    }
+    return best;
+}
+
+// fills a wave file with a sine wave, positive only for 8-bit
+void fillSine(WaveFile &wave) {
+    vector<float> block(static_cast<size_t>(BLOCK_FRAMES) * wave.nChannels());
+    float offset = wave.bitDepth() == 8 ? 0.5f : 0.0f;
+    for (uint64_t start = 0; start < wave.length(); start += BLOCK_FRAMES) {
+        for (size_t i = 0; i < block.size(); ++i) {
+            block[i] = offset + 0.4f * static_cast<float>(sin((start * wave.nChannels() + i) * 0.01));
+        }
+        wave.setSamples(start, BLOCK_FRAMES, block.data());
+    }
+}
+
+void benchFormat(const BenchOptions &options, const filesystem::path &directory,
+                 uint16_t bitDepth, uint16_t nChannels, vector<BenchResult> &results) {
+    uint64_t frames = static_cast<uint64_t>(options.seconds) * SAMPLE_RATE;
+    double megabytes = 0;
+
+    WaveFile source(frames, SAMPLE_RATE, nChannels, bitDepth);
+    fillSine(source);
+    megabytes = source.dataSize() / 1e6;
+
+    string fileName = (directory / ("bench_" + to_string(bitDepth) + "_" + to_string(nChannels) + ".wav")).string();
+    source.write(fileName);
+
+    auto add = [&](string name, double value, string unit) {
+        results.push_back({name, bitDepth, nChannels, value, unit});
+    };
+
+    // file I/O
+    double seconds = bestTime(options.repeat, [&]() {
+        WaveFile wave;
+        wave.read(fileName);
+        g_sink = wave.length();
+    });
+    add("read", megabytes / seconds, "MB/s");
+
+    seconds = bestTime(options.repeat, [&]() {
+        source.write(fileName);
+    });
+    add("write", megabytes / seconds, "MB/s");
+
+    seconds = bestTime(options.repeat, [&]() {
+        WaveFile wave;
+        wave.map(fileName);
+        g_sink = wave.length();
+    });
+    add("map", seconds * 1e3, "ms");
+
+    // one second from the middle of the file
+    seconds = bestTime(options.repeat, [&]() {
+        WaveFile wave;
+        wave.read(fileName, frames / 2, SAMPLE_RATE);
+        g_sink = wave.length();
+    });
+    add("read 1s range", seconds * 1e3, "ms");
+
+    // copy constructor
+    seconds = bestTime(options.repeat, [&]() {
+        WaveFile copy(source);
+        g_sink = copy.length();
+    });
+    add("copy", seconds * 1e6, "us");
+
+    // a copy followed by a change, which copies the shared samples
+    seconds = bestTime(options.repeat, [&]() {
+        WaveFile copy(source);
+        copy.setSample(0, AudioSample());
+        g_sink = copy.length();
+    });
+    add("copy+write", megabytes / seconds, "MB/s");
+
+    // one second segments rejoined in reverse, without copying the samples
+    seconds = bestTime(options.repeat, [&]() {
+        vector<WaveView> segments = WaveView(source).split(SAMPLE_RATE);
+        WaveViewList list;
+        for (auto segment = segments.rbegin(); segment != segments.rend(); ++segment) {
+            list.append(*segment);
+        }
+        g_sink = list.length();
+    });
+    add("split views", seconds * 1e6, "us");
+
+    // ext4 flushes a file that is truncated and rewritten on close, so
+    // the view is written to a new file each time
+    string viewFileName = fileName + ".view";
+    seconds = bestTime(options.repeat, [&]() {
+        filesystem::remove(viewFileName);
+        WaveView(source).slice(0, frames / 2).write(viewFileName);
+    });
+    add("view write", megabytes / 2 / seconds, "MB/s");
+    filesystem::remove(viewFileName);
+
+    // per-sample access
+    seconds = bestTime(options.repeat, [&]() {
+        double sum = 0;
+        for (uint64_t i = 0; i < source.length(); ++i) {
+            AudioSample sample = source.getSample(i);
+            sum += sample.left + sample.right;
+        }
+        g_sink = sum;
+    });
+    add("getSample", seconds * 1e9 / frames, "ns/frame");
+
+    WaveFile target(frames, SAMPLE_RATE, nChannels, bitDepth);
+    seconds = bestTime(options.repeat, [&]() {
+        for (uint64_t i = 0; i < target.length(); ++i) {
+            double value = (i % 200) * 0.005;
+            target.setSample(i, AudioSample(value, 1.0 - value));
+        }
+    });
+    add("setSample", seconds * 1e9 / frames, "ns/frame");
+
+    // block access
+    vector<float> block(static_cast<size_t>(BLOCK_FRAMES) * nChannels);
+    seconds = bestTime(options.repeat, [&]() {
+        double sum = 0;
+        for (uint64_t i = 0; i < source.length(); i += BLOCK_FRAMES) {
+            uint32_t count = source.getSamples(i, BLOCK_FRAMES, block.data());
+            sum += block[count - 1];
+        }
+        g_sink = sum;
+    });
+    add("getSamples", seconds * 1e9 / frames, "ns/frame");
+
+    seconds = bestTime(options.repeat, [&]() {
+        for (uint64_t i = 0; i < target.length(); i += BLOCK_FRAMES) {
+            target.setSamples(i, BLOCK_FRAMES, block.data());
+        }
+    });
+    add("setSamples", seconds * 1e9 / frames, "ns/frame");
+
+    vector<double> doubleBlock(block.size());
+    seconds = bestTime(options.repeat, [&]() {
+        double sum = 0;
+        for (uint64_t i = 0; i < source.length(); i += BLOCK_FRAMES) {
+            uint32_t count = source.getSamples(i, BLOCK_FRAMES, doubleBlock.data());
+            sum += doubleBlock[count - 1];
+        }
+        g_sink = sum;
+    });
+    add("getSamples double", seconds * 1e9 / frames, "ns/frame");
+
+    vector<int32_t> intBlock(block.size());
+    seconds = bestTime(options.repeat, [&]() {
+        double sum = 0;
+        for (uint64_t i = 0; i < source.length(); i += BLOCK_FRAMES) {
+            uint32_t count = source.getSamples(i, BLOCK_FRAMES, intBlock.data());
+            sum += intBlock[count - 1];
+        }
+        g_sink = sum;
+    });
+    add("getSamples int", seconds * 1e9 / frames, "ns/frame");
+
+    AudioBuffer buffer(nChannels, BLOCK_FRAMES);
+    seconds = bestTime(options.repeat, [&]() {
+        double sum = 0;
+        for (uint64_t i = 0; i < source.length(); i += BLOCK_FRAMES) {
+            source.readBuffer(i, buffer);
+            sum += buffer.channel(0)[0];
+        }
+        g_sink = sum;
+    });
+    add("readBuffer", seconds * 1e9 / frames, "ns/frame");
+
+    seconds = bestTime(options.repeat, [&]() {
+        for (uint64_t i = 0; i < target.length(); i += BLOCK_FRAMES) {
+            target.writeBuffer(i, buffer);
+        }
+    });
+    add("writeBuffer", seconds * 1e9 / frames, "ns/frame");
+
+    // whole file processing on the thread pool
+    ParallelProcessor processor;
+    seconds = bestTime(options.repeat, [&]() {
+        processor.gain(target, 0.5f);
+    });
+    add("parallel gain", seconds * 1e9 / frames, "ns/frame");
+
+    WaveFile converted;
+    seconds = bestTime(options.repeat, [&]() {
+        processor.convert(source, converted, 32, SampleFormat::Float);
+    });
+    add("parallel convert", seconds * 1e9 / frames, "ns/frame");
+
+    // waveform overview
+    seconds = bestTime(options.repeat, [&]() {
+        PeakIndex index;
+        index.build(source);
+        g_sink = index.nLevels();
+    });
+    add("peak index", seconds * 1e9 / frames, "ns/frame");
+
+    filesystem::remove(fileName);
+}
+
+// times a chain of AudioSample operators, (a + b) * g - c, eagerly and lazily
+void benchAudioSample(const BenchOptions &options, vector<BenchResult> &results) {
+    const uint32_t count = SAMPLE_RATE * options.seconds;
+    vector<AudioSample> a(BLOCK_FRAMES), b(BLOCK_FRAMES), c(BLOCK_FRAMES), out(BLOCK_FRAMES);
+    for (uint32_t i = 0; i < BLOCK_FRAMES; ++i) {
+        a[i] = AudioSample(sin(i * 0.01) * 0.5, cos(i * 0.01) * 0.5);
+        b[i] = AudioSample(0.25, -0.25);
+        c[i] = AudioSample(0.1 * (i % 10), -0.1);
+    }
+
+    double seconds = bestTime(options.repeat, [&]() {
+        for (uint32_t n = 0; n < count; n += BLOCK_FRAMES) {
+            for (uint32_t i = 0; i < BLOCK_FRAMES; ++i) {
+                out[i] = (a[i] + b[i]) * 0.8 - c[i];
+            }
+            g_sink = out[n % BLOCK_FRAMES].left;
+        }
+    });
+    results.push_back({"AudioSample chain", 0, 2, seconds * 1e9 / count, "ns/frame"});
+
+    // the same chain as a lazy expression, clamped once
+    seconds = bestTime(options.repeat, [&]() {
+        for (uint32_t n = 0; n < count; n += BLOCK_FRAMES) {
+            for (uint32_t i = 0; i < BLOCK_FRAMES; ++i) {
+                out[i] = (lazy(a[i]) + b[i]) * 0.8 - c[i];
+            }
+            g_sink = out[n % BLOCK_FRAMES].left;
+        }
+    });
+    results.push_back({"AudioExpr chain", 0, 2, seconds * 1e9 / count, "ns/frame"});
+
+    // and on planar blocks, one loop per channel
+    AudioBuffer blockA(2, BLOCK_FRAMES), blockB(2, BLOCK_FRAMES), blockC(2, BLOCK_FRAMES), blockOut(2, BLOCK_FRAMES);
+    for (uint32_t i = 0; i < BLOCK_FRAMES; ++i) {
+        blockA.channel(0)[i] = static_cast<float>(a[i].left);
+        blockA.channel(1)[i] = static_cast<float>(a[i].right);
+        blockB.channel(0)[i] = static_cast<float>(b[i].left);
+        blockB.channel(1)[i] = static_cast<float>(b[i].right);
+        blockC.channel(0)[i] = static_cast<float>(c[i].left);
+        blockC.channel(1)[i] = static_cast<float>(c[i].right);
+    }
+    seconds = bestTime(options.repeat, [&]() {
+        for (uint32_t n = 0; n < count; n += BLOCK_FRAMES) {
+            for (uint16_t ch = 0; ch < 2; ++ch) {
+                store(blockOut.channel(ch), BLOCK_FRAMES,
+                      (lazy(blockA.channel(ch)) + lazy(blockB.channel(ch))) * 0.8f - lazy(blockC.channel(ch)));
+            }
+            g_sink = blockOut.channel(0)[n % BLOCK_FRAMES];
+        }
+    });
+    results.push_back({"AudioExpr block chain", 0, 2, seconds * 1e9 / count, "ns/frame"});
+}
+
+// times a loop that keeps failing, setSample() past the end of a wave,
+// with the log on, and a message that is dropped by the log level
+void benchErrors(const BenchOptions &options, vector<BenchResult> &results) {
+    const uint32_t count = SAMPLE_RATE * options.seconds;
+    WaveFile wave(BLOCK_FRAMES, SAMPLE_RATE, 2, 16);
+    AudioSample sample(0.5, -0.5);
+
+    LogLevel level = logLevel();
+    setLogLevel(LogLevel::Info);
+    setLogHandler([](LogLevel, const string &) {});
+    double seconds = bestTime(options.repeat, [&]() {
+        wave.resetCounters();
+        for (uint32_t i = 0; i < count; ++i) {
+            wave.setSample(BLOCK_FRAMES + i, sample);
+        }
+        g_sink = static_cast<float>(wave.counters().outOfRange);
+    });
+    results.push_back({"setSample out of range", 16, 2, seconds * 1e9 / count, "ns/call"});
+    setLogHandler(nullptr);
+
+    setLogLevel(LogLevel::Error);
+    seconds = bestTime(options.repeat, [&]() {
+        for (uint32_t i = 0; i < count; ++i) {
+            logMessage(LogLevel::Info, "Reading from file: ", i);
+        }
+    });
+    results.push_back({"disabled log message", 0, 0, seconds * 1e9 / count, "ns/call"});
+    setLogLevel(level);
+}
+
+// times whole file sample rate conversion from 44.1kHz to 48kHz for each preset
+void benchResample(const BenchOptions &options, vector<BenchResult> &results) {
+    uint64_t frames = static_cast<uint64_t>(options.seconds) * SAMPLE_RATE;
+    WaveFile source(frames, SAMPLE_RATE, 2, 24);
+    fillSine(source);
+
+    const pair<ResampleQuality, string> presets[] = {
+        {ResampleQuality::Fast, "fast"},
+        {ResampleQuality::Standard, "standard"},
+        {ResampleQuality::High, "high"},
+        {ResampleQuality::Best, "best"}
+    };
+    for (const auto &preset : presets) {
+        WaveFile converted;
+        double seconds = bestTime(options.repeat, [&]() {
+            SampleRateConverter::convert(source, converted, 48000, preset.first);
+        });
+        results.push_back({"resample 48k " + preset.second, 24, 2, seconds * 1e9 / frames, "ns/frame"});
+    }
+}
+
+// times 24-bit to 16-bit conversion with each dither mode
+void benchBitDepth(const BenchOptions &options, vector<BenchResult> &results) {
+    uint64_t frames = static_cast<uint64_t>(options.seconds) * SAMPLE_RATE;
+    WaveFile source(frames, SAMPLE_RATE, 2, 24);
+    fillSine(source);
+
+    const pair<DitherMode, string> modes[] = {
+        {DitherMode::None, "none"},
+        {DitherMode::Triangular, "triangular"},
+        {DitherMode::NoiseShaped, "noise shaped"}
+    };
+    for (const auto &mode : modes) {
+        double seconds = bestTime(options.repeat, [&]() {
+            WaveFile copy(source);
+            copy.convertBitDepth(16, SampleFormat::PCM, mode.first);
+            g_sink = copy.dataSize();
+        });
+        results.push_back({"24 to 16 " + mode.second, 24, 2, seconds * 1e9 / frames, "ns/frame"});
+    }
+}
+
+// times streaming a 24-bit stereo file through the blocking and the
+// asynchronous streams, the direct read bypasses the page cache
+void benchStreams(const BenchOptions &options, const filesystem::path &directory,
+                  vector<BenchResult> &results) {
+    uint64_t frames = static_cast<uint64_t>(options.seconds) * SAMPLE_RATE;
+    WaveFile source(frames, SAMPLE_RATE, 2, 24);
+    fillSine(source);
+    double megabytes = source.dataSize() / 1e6;
+
+    string fileName = (directory / "bench_stream.wav").string();
+    vector<float> block(BLOCK_FRAMES * 2);
+
+    double seconds = bestTime(options.repeat, [&]() {
+        WaveStreamWriter writer(fileName, SAMPLE_RATE, 2, 24);
+        for (uint64_t frame = 0; frame < frames; frame += BLOCK_FRAMES) {
+            source.getSamples(frame, BLOCK_FRAMES, block.data());
+            writer.write(block.data(), static_cast<uint32_t>(min<uint64_t>(BLOCK_FRAMES, frames - frame)));
+        }
+    });
+    results.push_back({"stream write", 24, 2, megabytes / seconds, "MB/s"});
+
+    seconds = bestTime(options.repeat, [&]() {
+        AsyncWaveWriter writer;
+        writer.open(fileName, SAMPLE_RATE, 2, 24);
+        for (uint64_t frame = 0; frame < frames; frame += BLOCK_FRAMES) {
+            source.getSamples(frame, BLOCK_FRAMES, block.data());
+            writer.write(block.data(), static_cast<uint32_t>(min<uint64_t>(BLOCK_FRAMES, frames - frame)));
+        }
+    });
+    results.push_back({"async write", 24, 2, megabytes / seconds, "MB/s"});
+
+    seconds = bestTime(options.repeat, [&]() {
+        WaveStreamReader reader(fileName);
+        while (reader.read(block.data(), BLOCK_FRAMES) > 0) {
+        }
+        g_sink = reader.position();
+    });
+    results.push_back({"stream read", 24, 2, megabytes / seconds, "MB/s"});
+
+    for (bool direct : {false, true}) {
+        seconds = bestTime(options.repeat, [&]() {
+            AsyncWaveReader reader;
+            reader.open(fileName, direct);
+            while (reader.read(block.data(), BLOCK_FRAMES) > 0) {
+            }
+            g_sink = reader.position();
+        });
+        results.push_back({direct ? "async read direct" : "async read", 24, 2, megabytes / seconds, "MB/s"});
+    }
+}
+
+// times summing 64 stereo tracks at staggered offsets, half of them
+// with a fade in, to memory
+void benchMixer(const BenchOptions &options, vector<BenchResult> &results) {
+    const size_t TRACKS = 64;
+    uint64_t frames = static_cast<uint64_t>(options.seconds) * SAMPLE_RATE;
+    WaveFile source(frames, SAMPLE_RATE, 2, 24);
+    fillSine(source);
+
+    Mixer mixer(SAMPLE_RATE, 2);
+    for (size_t i = 0; i < TRACKS; ++i) {
+        mixer.addTrack(WaveView(source), i * 1000, 0.05f);
+        if (i % 2 == 1) {
+            mixer.addGainPoint(i, i * 1000, 0.0f);
+            mixer.addGainPoint(i, i * 1000 + SAMPLE_RATE, 1.0f);
+        }
+    }
+
+    vector<float> block(BLOCK_FRAMES * 2);
+    double seconds = bestTime(options.repeat, [&]() {
+        mixer.seek(0);
+        while (mixer.process(block.data(), BLOCK_FRAMES) > 0) {
+        }
+        g_sink = block[0];
+    });
+    results.push_back({"mix 64 tracks", 24, 2, seconds * 1e9 / mixer.length(), "ns/frame"});
+}
+
+// times convolving a stereo file with a 4 second stereo impulse
+// response, whole and a block at a time, in multiples of real time
+void benchConvolver(const BenchOptions &options, vector<BenchResult> &results) {
+    uint64_t frames = static_cast<uint64_t>(options.seconds) * SAMPLE_RATE;
+    WaveFile source(frames, SAMPLE_RATE, 2, 24);
+    fillSine(source);
+
+    WaveFile impulse(4 * SAMPLE_RATE, SAMPLE_RATE, 2, 32, SampleFormat::Float);
+    vector<float> decay(impulse.length() * 2);
+    for (size_t i = 0; i < decay.size(); ++i) {
+        decay[i] = 0.01f * static_cast<float>(exp(-3.0 * i / decay.size()) * sin(i * 1.7));
+    }
+    impulse.setSamples(0, static_cast<uint32_t>(impulse.length()), decay.data());
+
+    WaveFile convolved;
+    double seconds = bestTime(options.repeat, [&]() {
+        Convolver::convolve(source, impulse, convolved);
+        g_sink = convolved.length();
+    });
+    results.push_back({"convolve 4s IR", 24, 2, options.seconds / seconds, "x realtime"});
+
+    Convolver convolver;
+    convolver.setImpulse(impulse, 2);
+    vector<float> in(convolver.blockFrames() * 2);
+    vector<float> out(in.size());
+    seconds = bestTime(options.repeat, [&]() {
+        for (uint64_t frame = 0; frame < frames; frame += convolver.blockFrames()) {
+            source.getSamples(frame, convolver.blockFrames(), in.data());
+            convolver.process(in.data(), out.data());
+        }
+        g_sink = out[0];
+    });
+    results.push_back({"convolve stream 4s IR", 24, 2, options.seconds / seconds, "x realtime"});
+}
+
+// times filling a 16-bit stereo wave with a sine the way main.cpp used
+// to, with sin() and setSample() for every frame, and with the generator
+void benchGenerator(const BenchOptions &options, vector<BenchResult> &results) {
+    uint64_t frames = static_cast<uint64_t>(options.seconds) * SAMPLE_RATE;
+    WaveFile wave(frames, SAMPLE_RATE, 2, 16);
+
+    const double PI = 3.141592653589793238463;
+    double seconds = bestTime(options.repeat, [&]() {
+        for (uint64_t i = 0; i < frames; ++i) {
+            double value = sin(2 * PI * i * 440.0 / SAMPLE_RATE) * 0.6;
+            wave.setSample(i, AudioSample(value, value));
+        }
+    });
+    results.push_back({"sine setSample loop", 16, 2, seconds * 1e9 / frames, "ns/frame"});
+
+    SignalGenerator generator(SAMPLE_RATE);
+    generator.setSine(440.0, 0.6f);
+    seconds = bestTime(options.repeat, [&]() {
+        generator.reset();
+        generator.fill(wave);
+    });
+    results.push_back({"generator sine fill", 16, 2, seconds * 1e9 / frames, "ns/frame"});
+
+    // the signals alone, one channel
+    vector<float> block(BLOCK_FRAMES);
+    auto timeSignal = [&](string name) {
+        double best = bestTime(options.repeat, [&]() {
+            generator.reset();
+            for (uint64_t frame = 0; frame < frames; frame += BLOCK_FRAMES) {
+                generator.generate(block.data(), BLOCK_FRAMES);
+            }
+            g_sink = block[0];
+        });
+        results.push_back({name, 0, 1, best * 1e9 / frames, "ns/frame"});
+    };
+    generator.setSine(440.0);
+    timeSignal("generator sine");
+    generator.setSweep(20.0, 20000.0, options.seconds);
+    timeSignal("generator sweep");
+    generator.setMultitone({100.0, 1000.0, 3150.0, 10000.0});
+    timeSignal("generator 4 tones");
+    generator.setSaw(440.0);
+    timeSignal("generator saw");
+    generator.setPinkNoise();
+    timeSignal("generator pink noise");
+}
+
+// times queueing audio the way an audio callback does, 256 frames at a
+// time, through a bare ring buffer and through a capture to disk
+void benchCapture(const BenchOptions &options, const filesystem::path &directory,
+                  vector<BenchResult> &results) {
+    const uint32_t CALLBACK_FRAMES = 256;
+    uint64_t frames = static_cast<uint64_t>(options.seconds) * SAMPLE_RATE;
+    vector<float> block(CALLBACK_FRAMES * 2);
+    for (size_t i = 0; i < block.size(); ++i) {
+        block[i] = static_cast<float>(sin(i * 0.01) * 0.5);
+    }
+
+    RingBuffer<float> ring(BLOCK_FRAMES * 2);
+    vector<float> out(block.size());
+    double seconds = bestTime(options.repeat, [&]() {
+        for (uint64_t frame = 0; frame < frames; frame += CALLBACK_FRAMES) {
+            ring.write(block.data(), block.size());
+            ring.read(out.data(), out.size());
+        }
+        g_sink = out[0];
+    });
+    results.push_back({"ring buffer", 0, 2, seconds * 1e9 / frames, "ns/frame"});
+
+    // only the time spent in push() counts, the writer thread runs alongside
+    string fileName = (directory / "bench_capture.wav").string();
+    seconds = numeric_limits<double>::max();
+    for (int i = 0; i < options.repeat; ++i) {
+        CaptureWriter capture;
+        capture.open(fileName, SAMPLE_RATE, 2, 24);
+        double pushSeconds = 0;
+        for (uint64_t frame = 0; frame < frames; frame += CALLBACK_FRAMES) {
+            auto start = chrono::steady_clock::now();
+            capture.push(block.data(), CALLBACK_FRAMES);
+            pushSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        capture.close();
+        seconds = min(seconds, pushSeconds);
+    }
+    results.push_back({"capture push", 24, 2, seconds * 1e9 / frames, "ns/frame"});
+    filesystem::remove(fileName);
+}
+
+// times cataloging a small library, opening every file against probing
+// only its headers, one file at a time and on the shared pool
+void benchProbe(const BenchOptions &options, const filesystem::path &directory,
+                vector<BenchResult> &results) {
+    const int N_FILES = 256;
+    filesystem::path library = directory / "library";
+    WaveFile wave(SAMPLE_RATE, SAMPLE_RATE, 2, 16);
+    fillSine(wave);
+    vector<string> fileNames;
+    for (int i = 0; i < N_FILES; ++i) {
+        filesystem::path folder = library / to_string(i % 16);
+        filesystem::create_directories(folder);
+        fileNames.push_back((folder / ("sample_" + to_string(i) + ".wav")).string());
+        wave.write(fileNames.back());
+    }
+
+    double seconds = bestTime(options.repeat, [&]() {
+        for (const string &fileName : fileNames) {
+            WaveFile file(fileName);
+            g_sink = static_cast<float>(file.length());
+        }
+    });
+    results.push_back({"open 256 files", 16, 2, seconds * 1e6 / N_FILES, "us/file"});
+
+    seconds = bestTime(options.repeat, [&]() {
+        WaveInfo info;
+        for (const string &fileName : fileNames) {
+            WaveFile::probe(fileName, info);
+            g_sink = static_cast<float>(info.length);
+        }
+    });
+    results.push_back({"probe 256 files", 16, 2, seconds * 1e6 / N_FILES, "us/file"});
+
+    WaveScanner scanner;
+    WaveCatalog catalog;
+    seconds = bestTime(options.repeat, [&]() {
+        scanner.scan(library.string(), catalog);
+        g_sink = static_cast<float>(catalog.size());
+    });
+    results.push_back({"scan 256 files", 16, 2, seconds * 1e6 / N_FILES, "us/file"});
+
+    filesystem::remove_all(library);
+}
+
+void printCsv(ostream &out, const vector<BenchResult> &results) {
+    out << "benchmark,bit_depth,channels,value,unit" << endl;
+    for (const BenchResult &result : results) {
+        out << result.name << "," << result.bitDepth << "," << result.nChannels << ","
+            << result.value << "," << result.unit << endl;
+    }
+}
+
+void printJson(ostream &out, const BenchOptions &options, const vector<BenchResult> &results) {
+    out << "{" << endl;
+    out << "  \"kernels\": \"" << conversionKernelName() << "\"," << endl;
+    out << "  \"seconds\": " << options.seconds << "," << endl;
+    out << "  \"threads\": " << ThreadPool::shared().size() << "," << endl;
+    out << "  \"results\": [" << endl;
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &result = results[i];
+        out << "    {\"benchmark\": \"" << result.name << "\", \"bit_depth\": " << result.bitDepth
+            << ", \"channels\": " << result.nChannels << ", \"value\": " << result.value
+            << ", \"unit\": \"" << result.unit << "\"}" << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    out << "  ]" << endl;
+    out << "}" << endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            options.seconds = max(atoi(argv[++i]), 1);
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            options.repeat = max(atoi(argv[++i]), 1);
+        } else if (arg == "--out" && i + 1 < argc) {
+            options.outFileName = argv[++i];
+        } else {
+            cerr << "usage: wave_bench [--json] [--seconds n] [--repeat n] [--out file]" << endl;
+            return 1;
+        }
+    }
+
+    // the library logs what it reads and writes on cout, which would get
+    // mixed into the results, so the log is turned off while they are collected
+    filesystem::path directory = filesystem::temp_directory_path() / "wave_bench";
+    filesystem::create_directories(directory);
+
+    vector<BenchResult> results;
+    setLogLevel(LogLevel::Off);
+    for (uint16_t bitDepth : {8, 16, 24, 32}) {
+        for (uint16_t nChannels : {1, 2}) {
+            benchFormat(options, directory, bitDepth, nChannels, results);
+        }
+    }
+    benchAudioSample(options, results);
+    benchErrors(options, results);
+    benchResample(options, results);
+    benchBitDepth(options, results);
+    benchStreams(options, directory, results);
+    benchMixer(options, results);
+    benchConvolver(options, results);
+    benchGenerator(options, results);
+    benchCapture(options, directory, results);
+    benchProbe(options, directory, results);
+    setLogLevel(LogLevel::Info);
+
+    filesystem::remove_all(directory);
+
+    ofstream outFile;
+    if (!options.outFileName.empty()) {
+        outFile.open(options.outFileName);
+        if (!outFile) {
+            cerr << "Cannot create file: " << options.outFileName << endl;
+            return 1;
+        }
+    }
+    ostream &out = outFile.is_open() ? outFile : cout;
+
+    if (options.json) {
+        printJson(out, options, results);
+    } else {
+        printCsv(out, results);
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+#ifndef ASYNCFILE_H_INCLUDED
+#define ASYNCFILE_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- AsyncFile --
+
+    Positional reads and writes that run in the background, so a
+    caller can keep several requests in flight and convert one block
+    while the next ones are still being read or written.  Requests are
+    submitted with a tag and their completions are collected with
+    wait(), not necessarily in the order they were submitted.
+
+    On Linux io_uring is used when the kernel supports it, talking to
+    the kernel through its system calls directly so no extra library
+    is needed.  Otherwise a few threads run pread() and pwrite().
+
+    Files can be opened with O_DIRECT to bypass the page cache, in
+    which case buffers, offsets and lengths must all be multiples of
+    DIRECT_ALIGNMENT.  If the file system does not support it the file
+    is opened normally, isDirect() tells which happened.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SIMPLE_WAVE_HAS_ASYNC_FILE 1
+#else
+#define SIMPLE_WAVE_HAS_ASYNC_FILE 0
+#endif
+
+enum class AsyncBackend {
+    Auto,       // io_uring if available, otherwise threads
+    IoUring,
+    Threads
+};
+
+enum class AsyncMode {
+    Read,
+    Write       // the file is created, or truncated if it exists
+};
+
+struct AsyncCompletion {
+    uint64_t tag;
+    int64_t result;     // bytes transferred, or a negative errno
+};
+
+class AsyncFile {
+private:
+    struct Ring;
+    struct Workers;
+
+    int m_fd;
+    bool m_direct;
+    unsigned m_depth;
+    unsigned m_pending;
+    AsyncBackend m_backend;
+
+    unique_ptr<Ring> m_ring;
+    unique_ptr<Workers> m_workers;
+
+public:
+    static constexpr size_t DIRECT_ALIGNMENT = 4096;
+
+    AsyncFile();
+    ~AsyncFile();
+    AsyncFile(const AsyncFile &other) = delete;
+    AsyncFile& operator=(const AsyncFile &other) = delete;
+
+    // opens a file with room for depth requests in flight, returns true if successful
+    bool open(string fileName, AsyncMode mode, unsigned depth = 8, bool direct = false,
+              AsyncBackend backend = AsyncBackend::Auto);
+
+    // waits for every request in flight and closes the file
+    void close();
+
+    // queues a read into or a write from buffer, which must stay valid until
+    // the request completes, returns false if depth requests are already in flight
+    bool submitRead(void *buffer, size_t length, uint64_t offset, uint64_t tag);
+    bool submitWrite(const void *buffer, size_t length, uint64_t offset, uint64_t tag);
+
+    // waits for the next request to complete, returns false if none are in flight
+    bool wait(AsyncCompletion &completion);
+
+    // changes the length of the file, e.g. to cut off padding after direct writes
+    bool truncate(uint64_t length);
+
+    // allocates and frees memory aligned for direct I/O
+    static void* allocate(size_t size);
+    static void release(void *buffer);
+
+    bool isOpen() const { return m_fd >= 0; }
+    bool isDirect() const { return m_direct; }
+    unsigned pending() const { return m_pending; }
+    unsigned depth() const { return m_depth; }
+    AsyncBackend backend() const { return m_backend; }
+
+private:
+    bool submit(bool write, void *buffer, size_t length, uint64_t offset, uint64_t tag);
+};
+
+#endif // ASYNCFILE_H_INCLUDED
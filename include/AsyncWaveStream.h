@@ -0,0 +1,191 @@
+#ifndef ASYNCWAVESTREAM_H_INCLUDED
+#define ASYNCWAVESTREAM_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- AsyncWaveStream --
+
+    AsyncWaveReader and AsyncWaveWriter work like WaveStreamReader and
+    WaveStreamWriter, but the file is read and written through an
+    AsyncFile with several blocks in flight.  While one block is being
+    converted the next ones are already on their way to or from the
+    disk, so conversion and I/O overlap instead of taking turns.
+
+    The reader can open the file with O_DIRECT, its blocks are then
+    aligned to the start of the file rather than to the audio data,
+    so frames may straddle two blocks.  The writer always goes through
+    the page cache since the audio data follows the headers at an
+    unaligned offset.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "AsyncFile.h"
+#include "WaveFileHeaders.h"
+#include "SampleConversion.h"
+
+using namespace std;
+
+class AsyncWaveReader {
+private:
+    struct Block {
+        uint8_t *data;
+        uint64_t offset;    // position of the block in the file
+        uint64_t filled;    // bytes actually read
+        bool inFlight;
+    };
+
+    AsyncFile m_file;
+
+    // header info
+    RiffHeader m_riffHeader;
+    Ds64Chunk m_ds64Chunk;
+    WaveFormatHeader m_formatHeader;
+    WaveDataHeader m_dataHeader;
+
+    // blocks are read in turn, m_head is the one being converted and
+    // m_queued blocks from there on have been submitted
+    vector<Block> m_blocks;
+    size_t m_blockBytes;
+    size_t m_head;
+    size_t m_queued;
+    uint64_t m_nextOffset;
+    bool m_endOfData;
+
+    // part of a frame left at the end of a block
+    vector<uint8_t> m_carry;
+    size_t m_carryBytes;
+
+    uint64_t m_dataStart;
+    uint64_t m_dataEnd;
+    uint64_t m_readOffset;
+    uint64_t m_position;
+
+    // the core attributes of an audio file
+    uint64_t m_length;
+    uint32_t m_sampleRate;
+    uint16_t m_nChannels;
+    uint16_t m_bitDepth;
+    SampleFormat m_sampleFormat;
+
+public:
+    static constexpr unsigned DEFAULT_DEPTH = 4;
+    static constexpr size_t DEFAULT_BLOCK_BYTES = 1 << 20;
+
+    AsyncWaveReader(unsigned depth = DEFAULT_DEPTH, size_t blockBytes = DEFAULT_BLOCK_BYTES);
+    ~AsyncWaveReader();
+    AsyncWaveReader(const AsyncWaveReader &other) = delete;
+    AsyncWaveReader& operator=(const AsyncWaveReader &other) = delete;
+
+    // opens a wave file, reads its headers and starts reading ahead,
+    // returns true if successful
+    bool open(string inFileName, bool direct = false, AsyncBackend backend = AsyncBackend::Auto);
+    void close();
+
+    // reads up to frames frames of interleaved floats into out,
+    // returns the number of frames read, 0 at the end of the file
+    uint32_t read(float *out, uint32_t frames);
+
+    // moves to a frame within the file, returns true if successful
+    bool seek(uint64_t frame);
+
+    // get methods
+    bool isOpen() const { return m_file.isOpen(); }
+    bool isDirect() const { return m_file.isDirect(); }
+    AsyncBackend backend() const { return m_file.backend(); }
+    uint64_t position() const { return m_position; }
+    uint64_t length() const { return m_length; }
+    uint32_t sampleRate() const { return m_sampleRate; }
+    uint16_t nChannels() const { return m_nChannels; }
+    uint16_t bitDepth() const { return m_bitDepth; }
+    SampleFormat sampleFormat() const { return m_sampleFormat; }
+
+private:
+    // starts reading ahead from m_nextOffset into every idle block
+    void fill();
+
+    // forgets the blocks read so far and starts again at a frame
+    void restart(uint64_t frame);
+
+    // waits until the head block has been read, returns false on an error
+    bool waitForHead();
+};
+
+class AsyncWaveWriter {
+private:
+    struct Block {
+        uint8_t *data;
+        size_t length;      // bytes submitted
+        bool inFlight;
+    };
+
+    AsyncFile m_file;
+    string m_fileName;
+
+    // header info
+    RiffHeader m_riffHeader;
+    Ds64Chunk m_ds64Chunk;
+    WaveFormatHeader m_formatHeader;
+    WaveDataHeader m_dataHeader;
+
+    // blocks are filled in turn, m_current is the one being filled
+    // and already holds m_filled frames
+    vector<Block> m_blocks;
+    size_t m_blockBytes;
+    size_t m_blockFrames;
+    size_t m_current;
+    size_t m_filled;
+    uint64_t m_nextOffset;
+    bool m_failed;
+
+    // the core attributes of an audio file
+    uint64_t m_length;
+    uint32_t m_sampleRate;
+    uint16_t m_nChannels;
+    uint16_t m_bitDepth;
+    SampleFormat m_sampleFormat;
+
+public:
+    static constexpr unsigned DEFAULT_DEPTH = 4;
+    static constexpr size_t DEFAULT_BLOCK_BYTES = 1 << 20;
+
+    AsyncWaveWriter(unsigned depth = DEFAULT_DEPTH, size_t blockBytes = DEFAULT_BLOCK_BYTES);
+    ~AsyncWaveWriter();
+    AsyncWaveWriter(const AsyncWaveWriter &other) = delete;
+    AsyncWaveWriter& operator=(const AsyncWaveWriter &other) = delete;
+
+    // creates a new wave file, returns true if successful
+    bool open(string outFileName, uint32_t sampleRate = 44100, uint16_t nChannels = 2,
+              uint16_t bitDepth = 16, SampleFormat sampleFormat = SampleFormat::PCM,
+              AsyncBackend backend = AsyncBackend::Auto);
+
+    // waits for the blocks in flight, writes the headers and closes the
+    // file, returns true if everything was written
+    bool close();
+
+    // appends frames frames of interleaved floats, PCM values are clamped
+    // between 1 and -1, returns the number of frames accepted
+    uint32_t write(const float *in, uint32_t frames);
+
+    // get methods
+    bool isOpen() const { return m_file.isOpen(); }
+    AsyncBackend backend() const { return m_file.backend(); }
+    uint64_t length() const { return m_length; }
+    uint32_t sampleRate() const { return m_sampleRate; }
+    uint16_t nChannels() const { return m_nChannels; }
+    uint16_t bitDepth() const { return m_bitDepth; }
+    SampleFormat sampleFormat() const { return m_sampleFormat; }
+
+private:
+    // submits the current block and moves on to the next one
+    void submitCurrent();
+
+    // collects one completion, noting a failed write
+    bool collect();
+};
+
+#endif // ASYNCWAVESTREAM_H_INCLUDED
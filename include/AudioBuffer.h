@@ -0,0 +1,71 @@
+#ifndef AUDIOBUFFER_H_INCLUDED
+#define AUDIOBUFFER_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- AudioBuffer --
+
+    An AudioBuffer holds any number of channels of float audio.
+    Unlike AudioSample, which keeps the left and right values of a
+    single frame together, each channel here is its own contiguous
+    array (planar layout), so a loop over one channel reads memory
+    in a straight line.  Every channel starts on a 64 byte boundary
+    to keep vector loads aligned and channels off each other's cache
+    lines.
+
+    WaveFile::readBuffer() and writeBuffer() convert directly between
+    a buffer and the interleaved bytes of a wave file.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+class AudioBuffer {
+private:
+    // frees memory allocated with an alignment
+    struct AlignedDelete {
+        void operator()(float *data) const;
+    };
+
+    // all channels share one allocation, channel n starts at n * m_stride
+    unique_ptr<float[], AlignedDelete> m_data;
+    size_t m_stride;
+    size_t m_length;
+    uint16_t m_nChannels;
+
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    AudioBuffer();
+    AudioBuffer(uint16_t nChannels, size_t length);
+    AudioBuffer(const AudioBuffer &other);
+    AudioBuffer(AudioBuffer &&other) noexcept;
+    AudioBuffer& operator=(const AudioBuffer &other);
+    AudioBuffer& operator=(AudioBuffer &&other) noexcept;
+
+    // changes the size of the buffer, the contents are cleared to zero
+    void resize(uint16_t nChannels, size_t length);
+
+    // sets every sample to zero
+    void clear();
+
+    // copies frames frames of interleaved floats in and out of the buffer
+    // starting at frame offset within the buffer
+    void deinterleave(const float *in, size_t frames, size_t offset = 0);
+    void interleave(float *out, size_t frames, size_t offset = 0) const;
+
+    // pointers to the start of a channel
+    float* channel(uint16_t channel) { return m_data.get() + channel * m_stride; }
+    const float* channel(uint16_t channel) const { return m_data.get() + channel * m_stride; }
+
+    // get methods
+    size_t length() const { return m_length; }
+    uint16_t nChannels() const { return m_nChannels; }
+};
+
+#endif // AUDIOBUFFER_H_INCLUDED
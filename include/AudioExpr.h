@@ -0,0 +1,180 @@
+#ifndef AUDIOEXPR_H_INCLUDED
+#define AUDIOEXPR_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- AudioExpr --
+
+    Lazy arithmetic for AudioSamples and blocks of floats.  The
+    AudioSample operators clamp after every step, so in a chain like
+    (a + b) * g - c a sum that goes past 1 is clipped before it is
+    scaled back down.  Wrapping the first operand in lazy() builds an
+    expression instead, nothing is computed until it is stored, and
+    it is only clamped once, at the end.
+
+        AudioSample out = (lazy(a) + b) * 0.8 - c;
+
+    The same operators work on blocks, e.g. the channels of an
+    AudioBuffer, where store() runs the whole chain in a single loop
+    the compiler can vectorize, without any temporary blocks.
+
+        store(out, n, (lazy(x) + lazy(y)) * 0.5f);
+
+    Expressions keep references to their operands, so they should be
+    stored in the statement that builds them.  Division by zero gives
+    zero, the same as the AudioSample operators but without a message.
+*/
+
+#include <cstddef>
+#include <type_traits>
+#include <algorithm>
+#include "AudioSample.h"
+
+using namespace std;
+
+// the base of every expression, E is the expression type itself
+template <typename E>
+class AudioExpr {
+public:
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+// the left (0) and right (1) values of an AudioSample
+class SampleTerm : public AudioExpr<SampleTerm> {
+private:
+    const AudioSample &m_sample;
+
+public:
+    using value_type = double;
+
+    explicit SampleTerm(const AudioSample &sample): m_sample(sample) {}
+    double operator[](size_t i) const { return i == 0 ? m_sample.left : m_sample.right; }
+};
+
+// a block of samples, such as one channel of an AudioBuffer
+class BlockTerm : public AudioExpr<BlockTerm> {
+private:
+    const float *m_data;
+
+public:
+    using value_type = float;
+
+    explicit BlockTerm(const float *data): m_data(data) {}
+    float operator[](size_t i) const { return m_data[i]; }
+};
+
+// the same value everywhere, stored in the type of the other operand
+// so float blocks are not promoted to double by a constant
+template <typename T>
+class ScalarTerm : public AudioExpr<ScalarTerm<T>> {
+private:
+    T m_value;
+
+public:
+    using value_type = T;
+
+    explicit ScalarTerm(T value): m_value(value) {}
+    T operator[](size_t) const { return m_value; }
+};
+
+struct AddOp {
+    template <typename T> static T apply(T a, T b) { return a + b; }
+};
+
+struct SubtractOp {
+    template <typename T> static T apply(T a, T b) { return a - b; }
+};
+
+struct MultiplyOp {
+    template <typename T> static T apply(T a, T b) { return a * b; }
+};
+
+struct DivideOp {
+    template <typename T> static T apply(T a, T b) { return b == 0 ? T(0) : a / b; }
+};
+
+template <typename L, typename R, typename Op>
+class BinaryExpr : public AudioExpr<BinaryExpr<L, R, Op>> {
+private:
+    L m_left;
+    R m_right;
+
+public:
+    using value_type = common_type_t<typename L::value_type, typename R::value_type>;
+
+    BinaryExpr(const L &left, const R &right): m_left(left), m_right(right) {}
+    value_type operator[](size_t i) const {
+        return Op::apply(static_cast<value_type>(m_left[i]), static_cast<value_type>(m_right[i]));
+    }
+};
+
+// starts an expression
+inline SampleTerm lazy(const AudioSample &sample) { return SampleTerm(sample); }
+inline BlockTerm lazy(const float *data) { return BlockTerm(data); }
+
+// evaluates an expression, clamping once between 1 and -1
+// the clamp is written out here rather than calling clampValues(), so
+// it is inlined along with the rest of the chain
+template <typename E>
+AudioSample::AudioSample(const AudioExpr<E> &expr):
+    left(min(max(static_cast<double>(expr.self()[0]), -1.0), 1.0)),
+    right(min(max(static_cast<double>(expr.self()[1]), -1.0), 1.0))
+{
+}
+
+// evaluates a block expression into n floats, clamped between 1 and -1
+template <typename E>
+void store(float *out, size_t n, const AudioExpr<E> &expr) {
+    const E &e = expr.self();
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = min(max(static_cast<float>(e[i]), -1.0f), 1.0f);
+    }
+}
+
+// the same without clamping, for float output or intermediate mixes
+template <typename E>
+void storeUnclamped(float *out, size_t n, const AudioExpr<E> &expr) {
+    const E &e = expr.self();
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<float>(e[i]);
+    }
+}
+
+// the operators take an expression on at least one side, the other side
+// may also be an AudioSample or a number
+#define AUDIO_EXPR_OPERATOR(symbol, Op)                                                             \
+template <typename L, typename R>                                                                   \
+BinaryExpr<L, R, Op> operator symbol(const AudioExpr<L> &a, const AudioExpr<R> &b) {                \
+    return BinaryExpr<L, R, Op>(a.self(), b.self());                                                \
+}                                                                                                   \
+template <typename L>                                                                               \
+BinaryExpr<L, SampleTerm, Op> operator symbol(const AudioExpr<L> &a, const AudioSample &b) {        \
+    return BinaryExpr<L, SampleTerm, Op>(a.self(), SampleTerm(b));                                  \
+}                                                                                                   \
+template <typename R>                                                                               \
+BinaryExpr<SampleTerm, R, Op> operator symbol(const AudioSample &a, const AudioExpr<R> &b) {        \
+    return BinaryExpr<SampleTerm, R, Op>(SampleTerm(a), b.self());                                  \
+}                                                                                                   \
+template <typename L>                                                                               \
+BinaryExpr<L, ScalarTerm<typename L::value_type>, Op> operator symbol(const AudioExpr<L> &a,       \
+                                                                        double b) {                 \
+    using Scalar = ScalarTerm<typename L::value_type>;                                              \
+    return BinaryExpr<L, Scalar, Op>(a.self(), Scalar(static_cast<typename L::value_type>(b)));     \
+}                                                                                                   \
+template <typename R>                                                                               \
+BinaryExpr<ScalarTerm<typename R::value_type>, R, Op> operator symbol(double a,                    \
+                                                                        const AudioExpr<R> &b) {    \
+    using Scalar = ScalarTerm<typename R::value_type>;                                              \
+    return BinaryExpr<Scalar, R, Op>(Scalar(static_cast<typename R::value_type>(a)), b.self());     \
+}
+
+AUDIO_EXPR_OPERATOR(+, AddOp)
+AUDIO_EXPR_OPERATOR(-, SubtractOp)
+AUDIO_EXPR_OPERATOR(*, MultiplyOp)
+AUDIO_EXPR_OPERATOR(/, DivideOp)
+
+#undef AUDIO_EXPR_OPERATOR
+
+#endif // AUDIOEXPR_H_INCLUDED
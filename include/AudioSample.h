@@ -16,8 +16,11 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cstdint>
 using namespace std;
 
+template <typename E> class AudioExpr;
+
 struct AudioSample {
     double left{};
     double right{};
@@ -26,14 +29,22 @@ struct AudioSample {
     AudioSample(double mono);
     AudioSample(double left, double right);
 
+    // evaluates a lazy expression from AudioExpr.h, clamping once at the end
+    template <typename E> AudioSample(const AudioExpr<E> &expr);
+
     // this method is used to clamp between 1 and -1
     AudioSample& clampValues();
 
     // easy way to invert the sample values
     AudioSample& invert();
+
+    // the number of divisions by zero so far, in every thread, only the
+    // first one is logged so a loop that keeps dividing by zero stays fast
+    static uint64_t zeroDivisions();
 };
 
-// these overloaded operators are for convenience when doing processing
+// these overloaded operators are for convenience when doing processing,
+// each result is clamped, see AudioExpr.h to clamp a whole chain only once
 AudioSample operator+(const AudioSample &a, const AudioSample &b);
 AudioSample operator+(const AudioSample &a, double b);
 AudioSample operator+(double a, const AudioSample &b);
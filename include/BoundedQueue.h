@@ -0,0 +1,88 @@
+#ifndef BOUNDEDQUEUE_H_INCLUDED
+#define BOUNDEDQUEUE_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- BoundedQueue --
+
+    A thread safe first in, first out queue holding at most a fixed
+    number of items, used to connect the stages of a pipeline.  push()
+    waits while the queue is full, so a fast stage cannot run far
+    ahead of a slow one and the memory in flight stays bounded.
+
+    Once close() is called no more items can be pushed, and pop()
+    returns false when the remaining items have been taken, which
+    tells the next stage that its input has finished.
+*/
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+template <typename T>
+class BoundedQueue {
+private:
+    deque<T> m_items;
+    size_t m_capacity;
+    bool m_closed;
+
+    mutex m_lock;
+    condition_variable m_notFull;
+    condition_variable m_notEmpty;
+
+public:
+    explicit BoundedQueue(size_t capacity): m_items{}, m_capacity(capacity > 0 ? capacity : 1), m_closed{false}
+    {
+    }
+
+    BoundedQueue(const BoundedQueue &other) = delete;
+    BoundedQueue& operator=(const BoundedQueue &other) = delete;
+
+    // waits for space and adds an item, returns false if the queue was closed
+    bool push(T item) {
+        unique_lock<mutex> guard(m_lock);
+        m_notFull.wait(guard, [this]() { return m_items.size() < m_capacity || m_closed; });
+        if (m_closed) {
+            return false;
+        }
+        m_items.push_back(move(item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    // waits for an item and takes it, returns false once the queue
+    // is closed and empty
+    bool pop(T &item) {
+        unique_lock<mutex> guard(m_lock);
+        m_notEmpty.wait(guard, [this]() { return !m_items.empty() || m_closed; });
+        if (m_items.empty()) {
+            return false;
+        }
+        item = move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    // no more items will be pushed, waiting threads are woken
+    void close() {
+        lock_guard<mutex> guard(m_lock);
+        m_closed = true;
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+    size_t size() {
+        lock_guard<mutex> guard(m_lock);
+        return m_items.size();
+    }
+
+    size_t capacity() const { return m_capacity; }
+};
+
+#endif // BOUNDEDQUEUE_H_INCLUDED
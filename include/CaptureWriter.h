@@ -0,0 +1,101 @@
+#ifndef CAPTUREWRITER_H_INCLUDED
+#define CAPTUREWRITER_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- CaptureWriter --
+
+    Records live audio to a wave file.  push() is called from the audio
+    callback and only copies the frames into a RingBuffer, it never
+    blocks, waits or allocates.  A background thread takes the frames
+    out of the ring and appends them to a WaveStreamWriter, which
+    patches the header sizes when close() is called, so capture can
+    run for hours in a fixed amount of memory.
+
+    If the disk falls behind and the ring fills up, the frames that do
+    not fit are dropped rather than making the callback wait.  Every
+    push() that drops frames counts as an overflow, and the counters
+    can be read from any thread while capture is running.  maxFill()
+    is the fullest the ring has been, which shows how close capture
+    came to dropping frames.
+
+    open() and close() allocate and join the writer thread, so they
+    should be called outside the callback, while it is not running.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RingBuffer.h"
+#include "WaveStream.h"
+
+using namespace std;
+
+class CaptureWriter {
+private:
+    WaveStreamWriter m_writer;
+    unique_ptr<RingBuffer<float>> m_ring;
+    thread m_thread;
+    atomic<bool> m_running;
+
+    uint32_t m_bufferFrames;
+    uint16_t m_nChannels;
+
+    // how long the writer thread sleeps when the ring is empty
+    chrono::microseconds m_pollInterval;
+
+    // counters
+    atomic<uint64_t> m_framesPushed;
+    atomic<uint64_t> m_framesDropped;
+    atomic<uint64_t> m_overflows;
+    atomic<uint64_t> m_framesWritten;
+    atomic<uint64_t> m_maxFill;
+    atomic<bool> m_failed;
+
+public:
+    // about three seconds at 44.1kHz
+    static constexpr uint32_t DEFAULT_BUFFER_FRAMES = 131072;
+
+    CaptureWriter(uint32_t bufferFrames = DEFAULT_BUFFER_FRAMES);
+    ~CaptureWriter();
+    CaptureWriter(const CaptureWriter &other) = delete;
+    CaptureWriter& operator=(const CaptureWriter &other) = delete;
+
+    // creates a new wave file and starts the writer thread, returns true if successful
+    bool open(string outFileName, uint32_t sampleRate = 44100, uint16_t nChannels = 2,
+              uint16_t bitDepth = 16, SampleFormat sampleFormat = SampleFormat::PCM);
+
+    // writes everything still in the ring, patches the header sizes and
+    // closes the file, returns true if every frame pushed was written
+    bool close();
+
+    // queues frames frames of interleaved floats, safe to call from a
+    // real-time thread, returns the number of frames queued
+    uint32_t push(const float *in, uint32_t frames);
+
+    // get methods
+    bool isOpen() const { return m_running.load(memory_order_relaxed); }
+    uint16_t nChannels() const { return m_nChannels; }
+    uint32_t bufferFrames() const { return m_bufferFrames; }
+    uint64_t framesPushed() const { return m_framesPushed.load(memory_order_relaxed); }
+    uint64_t framesDropped() const { return m_framesDropped.load(memory_order_relaxed); }
+    uint64_t overflows() const { return m_overflows.load(memory_order_relaxed); }
+    uint64_t framesWritten() const { return m_framesWritten.load(memory_order_relaxed); }
+    uint64_t maxFill() const { return m_maxFill.load(memory_order_relaxed); }
+    bool failed() const { return m_failed.load(memory_order_relaxed); }
+
+private:
+    // the writer thread
+    void run();
+
+    // moves everything in the ring to the file
+    void drain(vector<float> &block);
+};
+
+#endif // CAPTUREWRITER_H_INCLUDED
@@ -0,0 +1,56 @@
+#ifndef CHUNKINDEX_H_INCLUDED
+#define CHUNKINDEX_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- ChunkIndex --
+
+    A wave file is a RIFF file, which is a list of chunks that each
+    start with a 4-letter id and a 32-bit size.  The ChunkIndex walks
+    that list by seeking from one chunk header to the next, so
+    building it costs one small read per chunk no matter how big the
+    chunks are.  Only the position of each chunk is stored, chunks
+    that the library does not use (LIST, bext, iXML...) can be read
+    later with readChunk().
+
+    In an RF64 file the size of the data chunk is stored as 0xFFFFFFFF
+    and the real size is taken from the ds64 chunk, so sizes in the
+    index are always 64-bit.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using namespace std;
+
+struct ChunkInfo {
+    char     id[4]{};                   // the 4-letter chunk id
+    uint64_t size{};                    // size of the chunk data, excluding the pad byte
+    uint64_t offset{};                  // position of the chunk data within the file
+};
+
+class ChunkIndex {
+private:
+    vector<ChunkInfo> m_chunks;
+
+public:
+    // walks every chunk after the RIFF header, inFile must be at the first chunk
+    // returns true if at least one chunk was found
+    bool build(istream &inFile);
+    void clear() { m_chunks.clear(); }
+
+    // returns the first chunk with a matching id or nullptr
+    const ChunkInfo* find(string id) const;
+
+    // reads the data of a chunk, returns true if successful
+    static bool readChunk(istream &inFile, const ChunkInfo &chunk, vector<uint8_t> &out);
+
+    const vector<ChunkInfo>& chunks() const { return m_chunks; }
+    size_t size() const { return m_chunks.size(); }
+};
+
+#endif // CHUNKINDEX_H_INCLUDED
@@ -0,0 +1,102 @@
+#ifndef CONVOLVER_H_INCLUDED
+#define CONVOLVER_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- Convolver --
+
+    Convolves audio with an impulse response, such as a reverb or a
+    room correction filter, using uniformly partitioned overlap-save
+    FFT convolution.  The impulse response is cut into partitions of
+    one block each and every partition is transformed once, up front.
+    Each block of input is transformed once as well and kept in a
+    delay line of spectra, then every output block is the sum of the
+    products of the partitions with the matching past input spectra
+    and one inverse transform.  The work per block grows with the
+    length of the impulse response divided by the block size, rather
+    than with the product of the two lengths.
+
+    process() is the streaming mode, it takes exactly blockFrames()
+    frames at a time and returns the same number, with no latency
+    beyond the block itself.  convolve() processes a whole WaveFile,
+    including the tail of the impulse response after the input ends.
+
+    The impulse response may have the same number of channels as the
+    input, one for each channel, or a single channel used for every
+    input channel.  A mono input with a multichannel impulse response,
+    such as a stereo reverb, gives one output channel per impulse
+    response channel.  Output blocks are not clamped.  The unsigned
+    samples of 8-bit waves are centered on 0 before they are convolved.
+*/
+
+#include <iostream>
+#include <cstdint>
+#include <vector>
+#include "FFT.h"
+#include "WaveFile.h"
+
+using namespace std;
+
+class Convolver {
+private:
+    // the spectra of the partitions of one channel, or of the recent
+    // input of one channel, one after the other, bins() apart
+    struct Spectra {
+        vector<float> re;
+        vector<float> im;
+    };
+
+    RealFFT m_fft;
+    uint32_t m_blockFrames;
+    size_t m_nPartitions;
+
+    uint16_t m_nChannels;
+    uint16_t m_nOutChannels;
+    uint16_t m_nImpulseChannels;
+
+    // the partitions of each impulse response channel
+    vector<Spectra> m_impulse;
+
+    // for each input channel, the last two blocks of input and the
+    // delay line of their spectra, m_current is the newest slot
+    vector<vector<float>> m_history;
+    vector<Spectra> m_delayLine;
+    size_t m_current;
+
+    // scratch for one transform
+    vector<float> m_time;
+    Spectra m_sum;
+
+public:
+    static constexpr uint32_t DEFAULT_BLOCK_FRAMES = 1024;
+
+    // blockFrames is rounded up to a power of two
+    explicit Convolver(uint32_t blockFrames = DEFAULT_BLOCK_FRAMES);
+
+    // sets the impulse response for input with nChannels channels and
+    // clears the input history, returns true if successful
+    bool setImpulse(const WaveFile &impulse, uint16_t nChannels);
+
+    // clears the input history, as if only silence had been processed
+    void reset();
+
+    // convolves blockFrames() frames of interleaved floats with nChannels()
+    // channels into nOutChannels() channels, returns true if successful
+    bool process(const float *in, float *out);
+
+    // convolves a whole wave, the output has the bit depth and format of
+    // the input and is longer by the length of the impulse response less
+    // one frame, PCM output is clamped, returns true if successful
+    static bool convolve(const WaveFile &in, const WaveFile &impulse, WaveFile &out,
+                         uint32_t blockFrames = 4096);
+
+    // get methods
+    uint32_t blockFrames() const { return m_blockFrames; }
+    size_t nPartitions() const { return m_nPartitions; }
+    uint16_t nChannels() const { return m_nChannels; }
+    uint16_t nOutChannels() const { return m_nOutChannels; }
+};
+
+#endif // CONVOLVER_H_INCLUDED
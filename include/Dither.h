@@ -0,0 +1,72 @@
+#ifndef DITHER_H_INCLUDED
+#define DITHER_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- Dither --
+
+    Quantizes floats to a lower PCM bit depth with dither.  Simply
+    cutting off the extra bits, as floatToPcm() does, leaves an error
+    that follows the signal and is heard as distortion on quiet parts.
+    Adding triangular (TPDF) noise of one step either side before
+    rounding turns that error into a constant, signal independent hiss.
+
+    Noise shaping also feeds the error of each sample back into the
+    next ones, which moves the hiss up towards the top of the spectrum
+    where the ear is least sensitive.  It works one sample after the
+    other, so only the plain triangular dither is vectorized.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+enum class DitherMode {
+    None,           // values are truncated, as by floatToPcm()
+    Triangular,     // TPDF dither, then rounded to the nearest step
+    NoiseShaped     // TPDF dither with noise shaping
+};
+
+class Ditherer {
+public:
+    // random number generators run side by side, one per vector lane
+    static constexpr size_t LANES = 8;
+
+private:
+    DitherMode m_mode;
+    uint16_t m_nChannels;
+
+    // xorshift states, two numbers are drawn for each triangular value
+    uint32_t m_stateA[LANES];
+    uint32_t m_stateB[LANES];
+
+    // the last errors of each channel for noise shaping
+    vector<float> m_errors;
+
+    // quantized values before they are packed
+    vector<int32_t> m_values;
+
+public:
+    Ditherer(DitherMode mode = DitherMode::Triangular, uint16_t nChannels = 2, uint32_t seed = 1);
+
+    // quantizes frames frames of interleaved floats to packed PCM samples,
+    // returns false for an unsupported bit depth, state carries over
+    // between calls so a file can be processed a block at a time
+    // the floats are scaled like pcmToFloat(), so from 0 to 1 for 8 bits
+    bool quantize(const float *in, uint8_t *out, size_t frames, uint16_t bitDepth);
+
+    // starts again from the seed with no noise shaping errors
+    void reset(uint32_t seed = 1);
+
+    DitherMode mode() const { return m_mode; }
+
+private:
+    void triangular(const float *in, int32_t *out, size_t n, float scale, float lo, float hi);
+    void noiseShaped(const float *in, int32_t *out, size_t frames, float scale, float lo, float hi);
+};
+
+#endif // DITHER_H_INCLUDED
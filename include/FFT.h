@@ -0,0 +1,60 @@
+#ifndef FFT_H_INCLUDED
+#define FFT_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- FFT --
+
+    A fast Fourier transform of real signals whose size is a power of
+    two.  The signal is packed into a complex transform of half the
+    size, which is done with iterative radix-2 butterflies, and the
+    result is unpacked into the size / 2 + 1 bins of the spectrum.
+
+    Spectra are kept as separate arrays of real and imaginary parts,
+    so loops over the bins of several spectra vectorize easily.  The
+    inverse transform is scaled by 1 / size, so forward() followed by
+    inverse() gives back the original signal.
+*/
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+class RealFFT {
+private:
+    size_t m_size;
+
+    // the complex transform of half the size
+    vector<size_t> m_bitReverse;
+    vector<complex<float>> m_twiddles;
+
+    // the factors that unpack the half size transform
+    vector<complex<float>> m_unpack;
+
+    // scratch for the complex transform
+    vector<complex<float>> m_work;
+
+public:
+    // a transform of size samples, rounded up to a power of two of at least 4
+    explicit RealFFT(size_t size);
+
+    // transforms size() samples into bins() bins
+    void forward(const float *in, float *re, float *im);
+
+    // transforms bins() bins back into size() samples
+    void inverse(const float *re, const float *im, float *out);
+
+    size_t size() const { return m_size; }
+    size_t bins() const { return m_size / 2 + 1; }
+
+private:
+    // an unscaled complex transform of m_work in place, inverse uses
+    // the conjugate twiddles
+    void transform(bool inverse);
+};
+
+#endif // FFT_H_INCLUDED
@@ -0,0 +1,74 @@
+#ifndef LOG_H_INCLUDED
+#define LOG_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- Log --
+
+    Every message the library reports goes through logMessage(), which
+    passes it to a handler that can be replaced, e.g. to send it to a
+    service log instead of cout.  Messages below the log level are
+    dropped before their text is put together, so a disabled message
+    costs one relaxed atomic load.  Building with SIMPLE_WAVE_LOGGING
+    off removes every message at compile time.
+
+    The default handler writes to cout, at level Info, which is what the
+    library has always printed.  Errors in per-sample methods, which can
+    happen millions of times in a loop, are counted by the WaveFile and
+    only the first one of each kind is logged.
+*/
+
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+// messages below this level are compiled out, see SIMPLE_WAVE_LOGGING
+#ifndef SIMPLE_WAVE_MIN_LOG_LEVEL
+#define SIMPLE_WAVE_MIN_LOG_LEVEL 0
+#endif
+
+enum class LogLevel {
+    Debug,
+    Info,       // files opened and written
+    Warning,    // problems the library worked around
+    Error,      // calls that failed
+    Off
+};
+
+using LogHandler = function<void(LogLevel level, const string &message)>;
+
+// replaces the handler, nullptr restores the default one, the handler may
+// be called from several threads at once and may log messages itself
+void setLogHandler(LogHandler handler);
+
+// messages below level are dropped
+void setLogLevel(LogLevel level);
+LogLevel logLevel();
+
+// passes a finished message to the handler
+void writeLog(LogLevel level, const string &message);
+
+extern atomic<int> g_logLevel;
+
+inline bool logEnabled(LogLevel level) {
+    return static_cast<int>(level) >= SIMPLE_WAVE_MIN_LOG_LEVEL
+        && static_cast<int>(level) >= g_logLevel.load(memory_order_relaxed);
+}
+
+// logs the arguments written one after the other, as with <<
+template <typename... Args>
+void logMessage(LogLevel level, const Args &...args) {
+    if (!logEnabled(level)) {
+        return;
+    }
+    ostringstream message;
+    (message << ... << args);
+    writeLog(level, message.str());
+}
+
+#endif // LOG_H_INCLUDED
@@ -0,0 +1,76 @@
+#ifndef MAPPEDFILE_H_INCLUDED
+#define MAPPEDFILE_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- MappedFile --
+
+    A small RAII wrapper around mmap() used by WaveFile::map().  The
+    whole file is mapped either read only or as a private copy on
+    write mapping, so writes never reach the file on disk.  Pages are
+    only loaded when they are touched, and madvise() hints can be
+    given to tell the kernel how the data will be accessed.
+
+    Memory mapping is only available on POSIX systems, elsewhere
+    open() always fails and callers should fall back to reading.
+*/
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SIMPLE_WAVE_HAS_MMAP 1
+#else
+#define SIMPLE_WAVE_HAS_MMAP 0
+#endif
+
+enum class MapMode {
+    ReadOnly,       // samples can be read but not changed
+    CopyOnWrite     // changed pages are copied privately, the file is untouched
+};
+
+enum class AccessHint {
+    Normal,
+    Sequential,     // read ahead aggressively, e.g. a single pass over the file
+    Random,         // no read ahead, e.g. seeking around in an editor
+    WillNeed        // start loading the pages now
+};
+
+class MappedFile {
+private:
+    uint8_t *m_data;
+    size_t m_size;
+    bool m_writable;
+    // identifies the mapped file, so it can be recognized by another name
+    uint64_t m_device;
+    uint64_t m_inode;
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile& operator=(const MappedFile &other) = delete;
+
+    // maps the whole file, returns true if successful
+    bool open(string fileName, MapMode mode);
+    void close();
+
+    // passes an access hint on to the kernel for a byte range,
+    // a length of 0 means until the end of the file
+    bool advise(AccessHint hint, size_t offset = 0, size_t length = 0);
+
+    uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    bool writable() const { return m_writable; }
+    bool isOpen() const { return m_data != nullptr; }
+
+    // true if fileName names the mapped file, through any path or link
+    bool isSameFile(const string &fileName) const;
+};
+
+#endif // MAPPEDFILE_H_INCLUDED
@@ -0,0 +1,122 @@
+#ifndef MIXER_H_INCLUDED
+#define MIXER_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- Mixer --
+
+    Sums any number of tracks into one wave, a block at a time.  Each
+    track starts at an offset on the timeline of the mix and has a
+    gain, and optionally a gain envelope of points the gain moves
+    between in straight lines, for fades and ramps.
+
+    Tracks are added in one of two ways: a WaveView of a wave that is
+    already read or mapped, or the name of a file that is streamed
+    with a WaveStreamReader, so mixing files from disk only keeps one
+    block of each track in memory however long the files are.
+
+    The tracks are summed into a float buffer with vector multiply-adds
+    and nothing is clamped until the block is handed out, so tracks
+    that go past 1 together keep their headroom as long as the final
+    mix does not.  A track has either the same number of channels as
+    the mix, or a single channel that is sent to every channel.  The
+    unsigned samples of 8-bit tracks are centered on 0 like the others,
+    and moved back when the mix is rendered to an 8-bit file.
+*/
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "WaveView.h"
+#include "WaveStream.h"
+
+using namespace std;
+
+class Mixer {
+private:
+    struct GainPoint {
+        uint64_t frame;
+        float gain;
+    };
+
+    struct Track {
+        // a track is either a view or a stream from a file
+        WaveView view;
+        unique_ptr<WaveStreamReader> stream;
+
+        uint64_t offset;
+        uint64_t length;
+        uint16_t nChannels;
+        float gain;
+
+        // 8-bit samples are read from 0 to 1, they are centered on 0
+        // before they are mixed
+        bool isUnsigned;
+
+        // the gain envelope, sorted by frame, the gain is multiplied by it
+        vector<GainPoint> envelope;
+    };
+
+    vector<Track> m_tracks;
+
+    // the sum of the tracks for one block, and one block of a single track
+    vector<float> m_mix;
+    vector<float> m_input;
+
+    uint32_t m_blockFrames;
+    uint64_t m_position;
+    uint64_t m_length;
+
+    // the format of the mix
+    uint32_t m_sampleRate;
+    uint16_t m_nChannels;
+
+public:
+    static constexpr uint32_t DEFAULT_BLOCK_FRAMES = 4096;
+
+    Mixer(uint32_t sampleRate = 44100, uint16_t nChannels = 2, uint32_t blockFrames = DEFAULT_BLOCK_FRAMES);
+
+    // adds a track starting at frame offset of the mix, tracks are
+    // numbered in the order they are added, returns true if successful
+    bool addTrack(const WaveView &view, uint64_t offset = 0, float gain = 1.0f);
+
+    // the same for a file, which is streamed while mixing
+    bool addTrack(string fileName, uint64_t offset = 0, float gain = 1.0f);
+
+    // adds a point to the gain envelope of a track at a frame of the mix,
+    // before the first point and after the last the gain stays level
+    bool addGainPoint(size_t track, uint64_t frame, float gain);
+
+    // mixes the next frames frames into out as interleaved floats clamped
+    // between 1 and -1, returns the number of frames mixed, 0 at the end
+    uint32_t process(float *out, uint32_t frames);
+
+    // moves to a frame of the mix, returns true if successful
+    bool seek(uint64_t frame);
+
+    // mixes everything from the start to a new wave file, returns true if successful
+    bool render(string outFileName, uint16_t bitDepth = 16, SampleFormat sampleFormat = SampleFormat::PCM);
+
+    // get methods
+    size_t nTracks() const { return m_tracks.size(); }
+    uint64_t position() const { return m_position; }
+    uint64_t length() const { return m_length; }
+    uint32_t sampleRate() const { return m_sampleRate; }
+    uint16_t nChannels() const { return m_nChannels; }
+
+private:
+    // checks the format of a new track and adds it
+    bool add(Track track, uint32_t sampleRate);
+
+    // adds frames frames of a track from frame start of the mix to m_mix at mixIndex
+    void mixTrack(Track &track, uint64_t start, size_t frames, size_t mixIndex);
+
+    // the envelope of a track at a frame of the mix
+    static float envelopeAt(const Track &track, uint64_t frame);
+};
+
+#endif // MIXER_H_INCLUDED
@@ -0,0 +1,113 @@
+#ifndef PARALLELPROCESSOR_H_INCLUDED
+#define PARALLELPROCESSOR_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- ParallelProcessor --
+
+    Runs a kernel over a whole WaveFile on a ThreadPool.  The file is
+    split into blocks which are converted to an AudioBuffer, passed to
+    the kernel along with the frame they start at, and converted back.
+    Each worker reuses its own buffer, and idle workers steal blocks
+    from busy ones.
+
+    Stateless kernels only see the block.  Kernels that keep state,
+    e.g. to find the peak of a file, get a State object of their own
+    for each worker, so no locking is needed, and the states are
+    returned to be combined once every block is done.  Blocks are not
+    processed in order, so kernels must not depend on the block before.
+
+    Kernels always see samples from -1 to 1, the unsigned samples of an
+    8-bit wave are moved there before the kernel and back after it.
+
+    Kernels must not start parallel work on the same pool themselves.
+*/
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "ThreadPool.h"
+#include "AudioBuffer.h"
+#include "WaveFile.h"
+
+using namespace std;
+
+class ParallelProcessor {
+public:
+    static constexpr size_t DEFAULT_BLOCK_FRAMES = 65536;
+
+    // a kernel gets a block of audio and the frame it starts at
+    using Kernel = function<void(AudioBuffer &block, uint64_t start)>;
+    using ReadKernel = function<void(const AudioBuffer &block, uint64_t start)>;
+
+private:
+    ThreadPool &m_pool;
+    size_t m_blockFrames;
+
+    // the block function also gets the index of the worker running it
+    using WorkerKernel = function<void(unsigned worker, AudioBuffer &block, uint64_t start)>;
+
+public:
+    explicit ParallelProcessor(ThreadPool &pool = ThreadPool::shared(),
+                               size_t blockFrames = DEFAULT_BLOCK_FRAMES);
+
+    // runs a kernel that changes the samples, returns true if successful
+    bool process(WaveFile &wave, const Kernel &kernel);
+
+    // runs a kernel that only reads the samples, returns true if successful
+    bool analyze(const WaveFile &wave, const ReadKernel &kernel) const;
+
+    // stateful versions, kernel(state, block, start) is given the state of
+    // the worker running it, every state starts as a copy of initial and
+    // they are all returned, or none if processing failed
+    template <typename State, typename F>
+    vector<State> process(WaveFile &wave, const State &initial, F kernel);
+
+    template <typename State, typename F>
+    vector<State> analyze(const WaveFile &wave, const State &initial, F kernel) const;
+
+    // common operations, these return true if successful
+    bool gain(WaveFile &wave, float gain);
+    bool invert(WaveFile &wave);
+
+    // scales the samples so the largest is level, silence is left as it is
+    bool normalize(WaveFile &wave, float level = 1.0f);
+
+    // the largest absolute sample value in the file
+    float peak(const WaveFile &wave) const;
+
+    // replaces out with a copy of in stored with another bit depth or format,
+    // this is done by WaveFile::convertBitDepth() on the calling thread
+    bool convert(const WaveFile &in, WaveFile &out, uint16_t bitDepth,
+                 SampleFormat format = SampleFormat::PCM) const;
+
+    ThreadPool& pool() const { return m_pool; }
+    size_t blockFrames() const { return m_blockFrames; }
+
+private:
+    // reads each block of in, runs the kernel and writes the block to
+    // out unless out is nullptr, returns true if successful
+    bool run(const WaveFile &in, WaveFile *out, const WorkerKernel &kernel) const;
+};
+
+template <typename State, typename F>
+vector<State> ParallelProcessor::process(WaveFile &wave, const State &initial, F kernel) {
+    vector<State> states(m_pool.size() + 1, initial);
+    bool ok = run(wave, &wave, [&](unsigned worker, AudioBuffer &block, uint64_t start) {
+        kernel(states[worker], block, start);
+    });
+    return ok ? states : vector<State>();
+}
+
+template <typename State, typename F>
+vector<State> ParallelProcessor::analyze(const WaveFile &wave, const State &initial, F kernel) const {
+    vector<State> states(m_pool.size() + 1, initial);
+    bool ok = run(wave, nullptr, [&](unsigned worker, AudioBuffer &block, uint64_t start) {
+        kernel(states[worker], static_cast<const AudioBuffer &>(block), start);
+    });
+    return ok ? states : vector<State>();
+}
+
+#endif // PARALLELPROCESSOR_H_INCLUDED
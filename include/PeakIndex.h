@@ -0,0 +1,103 @@
+#ifndef PEAKINDEX_H_INCLUDED
+#define PEAKINDEX_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- PeakIndex --
+
+    A multi-resolution overview of a WaveFile for drawing waveforms.
+    Level 0 holds the minimum, maximum and sum of squares of every
+    channel for each BASE_FRAMES frames, and each level above it
+    combines pairs of buckets from the one below, up to a single
+    bucket for the whole file.
+
+    The index is built in one pass over the samples, on the shared
+    ThreadPool by default.  A query for any range of frames picks the
+    level whose buckets are just smaller than a pixel, so it reads a
+    few buckets per pixel however long the range is.  Pixels narrower
+    than BASE_FRAMES get the bucket they fall in, at that zoom the
+    samples themselves are better read with readBuffer().
+
+    open() keeps the index in a sidecar file next to the wave file,
+    named fileName + ".peaks", along with the size and modification
+    time of the wave file.  Reopening an unchanged file loads the
+    sidecar instead of scanning the samples again.  Sidecars are
+    written in the byte order of the machine that made them.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "WaveFile.h"
+
+using namespace std;
+
+// the overview of the frames drawn in one pixel column
+struct PeakValue {
+    float min;
+    float max;
+    float rms;
+};
+
+class PeakIndex {
+public:
+    static constexpr uint32_t BASE_FRAMES = 256;
+
+private:
+    struct Bucket {
+        float min;
+        float max;
+        float sumSquares;
+    };
+
+    // m_levels[level][bucket * m_nChannels + channel]
+    vector<vector<Bucket>> m_levels;
+
+    uint64_t m_length;
+    uint16_t m_nChannels;
+
+public:
+    PeakIndex();
+
+    // scans the samples of a wave file, returns true if successful
+    bool build(const WaveFile &wave, bool parallel = true);
+
+    // loads the sidecar of the file wave was read from if it is up to
+    // date, otherwise builds the index and saves a new sidecar, a wave
+    // that was not read from a file, or only partly, is just built,
+    // returns true if successful
+    // the sidecar describes the file on disk, use build() after changing samples
+    bool open(const WaveFile &wave, bool parallel = true);
+
+    // reads or writes a sidecar file, load() fails unless the wave file
+    // it was made for still has the given size and modification time
+    bool load(string sidecarName, uint64_t fileSize, int64_t modifiedTime);
+    bool save(string sidecarName, uint64_t fileSize, int64_t modifiedTime) const;
+
+    // fills out with one value per pixel for frames start to end of a
+    // channel, returns false for an invalid channel or range
+    bool query(uint16_t channel, uint64_t start, uint64_t end, size_t pixels,
+               vector<PeakValue> &out) const;
+
+    // get methods
+    bool isEmpty() const { return m_levels.empty(); }
+    uint64_t length() const { return m_length; }
+    uint16_t nChannels() const { return m_nChannels; }
+    size_t nLevels() const { return m_levels.size(); }
+
+    // the name of the sidecar kept for a wave file
+    static string sidecarName(const string &fileName);
+
+private:
+    // sizes the levels for a file and fills in every level above 0
+    void allocate(uint64_t length, uint16_t nChannels);
+    void combineLevels();
+
+    // the frames covered by a bucket, only the last one of a level is short
+    uint64_t bucketFrames(size_t level, size_t bucket) const;
+};
+
+#endif // PEAKINDEX_H_INCLUDED
@@ -0,0 +1,92 @@
+#ifndef RINGBUFFER_H_INCLUDED
+#define RINGBUFFER_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- RingBuffer --
+
+    A lock-free ring buffer for exactly one producer thread and one
+    consumer thread, such as an audio callback and a thread writing
+    to disk.  write() and read() never block, wait or allocate, they
+    copy as many items as fit or are available and return how many
+    that was, so they are safe to call from a real-time thread.
+
+    The capacity is rounded up to a power of two and all the memory is
+    allocated by the constructor.  The producer only moves the write
+    position and the consumer only moves the read position, each on a
+    cache line of its own so the two threads do not keep taking the
+    line from each other.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+using namespace std;
+
+template <typename T>
+class RingBuffer {
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    unique_ptr<T[]> m_items;
+    size_t m_capacity;
+    size_t m_mask;
+
+    // the total number of items ever written and read, the
+    // positions in m_items are these masked by m_mask
+    alignas(CACHE_LINE) atomic<size_t> m_writePosition;
+    alignas(CACHE_LINE) atomic<size_t> m_readPosition;
+
+public:
+    explicit RingBuffer(size_t capacity): m_items{}, m_capacity(1), m_mask(0), m_writePosition{0},
+                                          m_readPosition{0}
+    {
+        while (m_capacity < capacity) {
+            m_capacity <<= 1;
+        }
+        m_mask = m_capacity - 1;
+        m_items.reset(new T[m_capacity]());
+    }
+
+    RingBuffer(const RingBuffer &other) = delete;
+    RingBuffer& operator=(const RingBuffer &other) = delete;
+
+    // producer side, copies up to n items from in, returns the number copied
+    size_t write(const T *in, size_t n) {
+        size_t position = m_writePosition.load(memory_order_relaxed);
+        size_t count = min(n, m_capacity - (position - m_readPosition.load(memory_order_acquire)));
+        size_t start = position & m_mask;
+        size_t first = min(count, m_capacity - start);
+        copy(in, in + first, m_items.get() + start);
+        copy(in + first, in + count, m_items.get());
+        m_writePosition.store(position + count, memory_order_release);
+        return count;
+    }
+
+    // consumer side, copies up to n items into out, returns the number copied
+    size_t read(T *out, size_t n) {
+        size_t position = m_readPosition.load(memory_order_relaxed);
+        size_t count = min(n, m_writePosition.load(memory_order_acquire) - position);
+        size_t start = position & m_mask;
+        size_t first = min(count, m_capacity - start);
+        copy(m_items.get() + start, m_items.get() + start + first, out);
+        copy(m_items.get(), m_items.get() + (count - first), out + first);
+        m_readPosition.store(position + count, memory_order_release);
+        return count;
+    }
+
+    // the items waiting to be read and the space left to write, each is
+    // exact or an underestimate on the side that uses it
+    size_t readAvailable() const {
+        return m_writePosition.load(memory_order_acquire) - m_readPosition.load(memory_order_acquire);
+    }
+    size_t writeAvailable() const { return m_capacity - readAvailable(); }
+
+    size_t capacity() const { return m_capacity; }
+};
+
+#endif // RINGBUFFER_H_INCLUDED
@@ -0,0 +1,55 @@
+#ifndef SAMPLEBUFFER_H_INCLUDED
+#define SAMPLEBUFFER_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SampleBuffer --
+
+    The storage behind the audio data of a WaveFile, either a block
+    of memory on the heap or a memory mapped file.  WaveFile objects
+    share a SampleBuffer through a shared_ptr, so copying a WaveFile
+    only copies the headers.  The samples are copied the first time
+    one of the copies is changed (copy on write), which makes copies
+    that are only read, e.g. snapshots kept for undo, almost free.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "MappedFile.h"
+
+using namespace std;
+
+class SampleBuffer {
+private:
+    // data either points into m_heap or into m_mapping
+    uint8_t *m_data;
+    size_t m_size;
+    unique_ptr<uint8_t[]> m_heap;
+    unique_ptr<MappedFile> m_mapping;
+
+public:
+    // allocates size zeroed bytes on the heap
+    explicit SampleBuffer(size_t size = 0);
+
+    // takes over a mapping, the samples are size bytes starting at offset
+    SampleBuffer(unique_ptr<MappedFile> mapping, size_t offset, size_t size);
+
+    SampleBuffer(const SampleBuffer &other) = delete;
+    SampleBuffer& operator=(const SampleBuffer &other) = delete;
+
+    // returns a private copy of the samples on the heap
+    shared_ptr<SampleBuffer> clone() const;
+
+    uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    // the mapping the samples come from, or nullptr if they are on the heap
+    MappedFile* mapping() const { return m_mapping.get(); }
+    bool isMapped() const { return m_mapping != nullptr; }
+    bool writable() const { return m_mapping == nullptr || m_mapping->writable(); }
+};
+
+#endif // SAMPLEBUFFER_H_INCLUDED
@@ -0,0 +1,206 @@
+#ifndef SAMPLECODEC_H_INCLUDED
+#define SAMPLECODEC_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SampleCodec --
+
+    Sample conversion specialized at compile time on the bit depth,
+    sample format and channel count of a wave.  SampleCodec packs and
+    unpacks a single sample, FrameCodec works on frames and blocks,
+    and a CodecTable holds pointers to every kernel for one format so
+    WaveFile only looks up the format once, when it changes, instead
+    of switching on the bit depth for every sample.
+
+    Samples can be converted to and from three types: float and double
+    values are scaled like getSample() and getSamples(), and int32_t
+    values are the integers stored in a PCM wave, unscaled, so PCM
+    samples can be processed without any rounding.
+
+    The float kernels in SampleConversion are still used for blocks of
+    floats, as they are vectorized by hand.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "SampleConversion.h"
+
+using namespace std;
+
+template <uint16_t BitDepth, SampleFormat Format>
+struct SampleCodec;
+
+// PCM samples are read as an integer, shifted left by SHIFT bits and
+// divided by SCALE, the unsigned 8-bit samples are never negative
+template <uint16_t BitDepth, typename Derived>
+struct PcmCodec {
+    static constexpr size_t BYTES = BitDepth / 8;
+    static constexpr bool HAS_INTEGERS = true;
+
+    template <typename T>
+    static T read(const uint8_t *in) {
+        int32_t raw = Derived::readRaw(in);
+        if constexpr (is_integral<T>::value) {
+            return static_cast<T>(raw);
+        } else {
+            return static_cast<T>(static_cast<int32_t>(static_cast<uint32_t>(raw) << Derived::SHIFT)
+                                  / static_cast<T>(Derived::SCALE));
+        }
+    }
+
+    template <typename T>
+    static void write(uint8_t *out, T value) {
+        if constexpr (is_integral<T>::value) {
+            Derived::writeRaw(out, static_cast<int32_t>(value));
+        } else {
+            double v = static_cast<double>(value);
+            v = v < Derived::LOWEST ? Derived::LOWEST : (v > 1.0 ? 1.0 : v);
+            Derived::writeRaw(out, static_cast<int32_t>(v * Derived::SCALE) >> Derived::SHIFT);
+        }
+    }
+};
+
+template <>
+struct SampleCodec<8, SampleFormat::PCM> : PcmCodec<8, SampleCodec<8, SampleFormat::PCM>> {
+    static constexpr int SHIFT = 0;
+    static constexpr double SCALE = numeric_limits<uint8_t>::max();
+    static constexpr double LOWEST = 0.0;
+
+    static int32_t readRaw(const uint8_t *in) { return in[0]; }
+    static void writeRaw(uint8_t *out, int32_t value) { out[0] = static_cast<uint8_t>(value); }
+};
+
+template <>
+struct SampleCodec<16, SampleFormat::PCM> : PcmCodec<16, SampleCodec<16, SampleFormat::PCM>> {
+    static constexpr int SHIFT = 0;
+    static constexpr double SCALE = numeric_limits<int16_t>::max();
+    static constexpr double LOWEST = -1.0;
+
+    static int32_t readRaw(const uint8_t *in) {
+        return static_cast<int16_t>(in[0] | (in[1] << 8));
+    }
+    static void writeRaw(uint8_t *out, int32_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+};
+
+// 24-bit samples are scaled as the top three bytes of a 32-bit sample
+template <>
+struct SampleCodec<24, SampleFormat::PCM> : PcmCodec<24, SampleCodec<24, SampleFormat::PCM>> {
+    static constexpr int SHIFT = 8;
+    static constexpr double SCALE = numeric_limits<int32_t>::max();
+    static constexpr double LOWEST = -1.0;
+
+    static int32_t readRaw(const uint8_t *in) {
+        return static_cast<int32_t>(static_cast<uint32_t>(in[0] << 8 | in[1] << 16 | in[2] << 24)) >> 8;
+    }
+    static void writeRaw(uint8_t *out, int32_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        out[2] = static_cast<uint8_t>(value >> 16);
+    }
+};
+
+template <>
+struct SampleCodec<32, SampleFormat::PCM> : PcmCodec<32, SampleCodec<32, SampleFormat::PCM>> {
+    static constexpr int SHIFT = 0;
+    static constexpr double SCALE = numeric_limits<int32_t>::max();
+    static constexpr double LOWEST = -1.0;
+
+    static int32_t readRaw(const uint8_t *in) {
+        return static_cast<int32_t>(static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8
+                                    | static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24);
+    }
+    static void writeRaw(uint8_t *out, int32_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        out[2] = static_cast<uint8_t>(value >> 16);
+        out[3] = static_cast<uint8_t>(value >> 24);
+    }
+};
+
+// float samples already hold the values and are not clamped
+template <typename Stored>
+struct FloatCodec {
+    static constexpr size_t BYTES = sizeof(Stored);
+    static constexpr bool HAS_INTEGERS = false;
+
+    template <typename T>
+    static T read(const uint8_t *in) {
+        Stored value;
+        memcpy(&value, in, sizeof(value));
+        return static_cast<T>(value);
+    }
+
+    template <typename T>
+    static void write(uint8_t *out, T value) {
+        Stored stored = static_cast<Stored>(value);
+        memcpy(out, &stored, sizeof(stored));
+    }
+};
+
+template <>
+struct SampleCodec<32, SampleFormat::Float> : FloatCodec<float> {};
+
+template <>
+struct SampleCodec<64, SampleFormat::Float> : FloatCodec<double> {};
+
+// Channels is 1, 2, or 0 for any other number of channels, a frame of
+// an AudioSample holds the first two channels of a stereo wave, only
+// the first channel otherwise, just like getSample() always has
+template <uint16_t BitDepth, SampleFormat Format, uint16_t Channels>
+struct FrameCodec {
+    using Codec = SampleCodec<BitDepth, Format>;
+
+    static void readFrame(const uint8_t *in, double &left, double &right) {
+        left = Codec::template read<double>(in);
+        right = Channels == 2 ? Codec::template read<double>(in + Codec::BYTES) : 0.0;
+    }
+
+    static void writeFrame(uint8_t *out, double left, double right) {
+        Codec::write(out, left);
+        if (Channels == 2) {
+            Codec::write(out + Codec::BYTES, right);
+        }
+    }
+
+    // n interleaved samples
+    template <typename T>
+    static void read(const uint8_t *in, T *out, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = Codec::template read<T>(in + i * Codec::BYTES);
+        }
+    }
+
+    template <typename T>
+    static void write(const T *in, uint8_t *out, size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            Codec::write(out + i * Codec::BYTES, in[i]);
+        }
+    }
+};
+
+// every kernel for one format, the integer kernels are nullptr for float waves
+struct CodecTable {
+    uint16_t bitDepth;
+    SampleFormat format;
+    uint16_t channels;
+
+    void (*readFrame)(const uint8_t *in, double &left, double &right);
+    void (*writeFrame)(uint8_t *out, double left, double right);
+    void (*readDouble)(const uint8_t *in, double *out, size_t n);
+    void (*writeDouble)(const double *in, uint8_t *out, size_t n);
+    void (*readInt)(const uint8_t *in, int32_t *out, size_t n);
+    void (*writeInt)(const int32_t *in, uint8_t *out, size_t n);
+};
+
+// the kernels for a format, or nullptr if it is not supported
+const CodecTable* findCodec(uint16_t bitDepth, SampleFormat format, uint16_t nChannels);
+
+#endif // SAMPLECODEC_H_INCLUDED
@@ -0,0 +1,75 @@
+#ifndef SAMPLECONVERSION_H_INCLUDED
+#define SAMPLECONVERSION_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SampleConversion --
+
+    Block conversion kernels between the packed little endian PCM
+    bytes stored in a wave file and interleaved floats.  These are
+    the workhorses behind WaveFile::getSamples() and setSamples().
+    SSE2/SSSE3/AVX2 versions are used when the compiler targets
+    them, otherwise a plain scalar loop is used.
+
+    The scaling matches getSample() and setSample() so the block
+    and per-sample paths can be mixed freely.
+
+    IEEE float files are supported as well.  32-bit float samples are
+    already in the right format so they are copied as they are, and
+    are not clamped, to keep the headroom that float files allow.
+
+    The planar versions convert to and from separate channel arrays,
+    as used by AudioBuffer.  They work through the file in small
+    chunks that stay in the L1 cache, converting and then
+    (de)interleaving each chunk.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+// how the samples in a wave file are stored
+enum class SampleFormat {
+    PCM,        // signed integers, unsigned for 8-bit
+    Float       // IEEE float, 32 or 64-bit
+};
+
+// true if the bit depth can be used with the sample format
+bool isSupportedFormat(SampleFormat format, uint16_t bitDepth);
+
+// converts n packed samples to floats, returns false for an unsupported bit depth
+bool pcmToFloat(const uint8_t *in, float *out, size_t n, uint16_t bitDepth,
+                SampleFormat format = SampleFormat::PCM);
+
+// converts n floats to packed samples, PCM values are clamped between 1 and -1
+// returns false for an unsupported bit depth
+bool floatToPcm(const float *in, uint8_t *out, size_t n, uint16_t bitDepth,
+                SampleFormat format = SampleFormat::PCM);
+
+// splits interleaved floats into nChannels separate arrays, and back again
+void deinterleave(const float *in, float *const *out, size_t frames, uint16_t nChannels);
+void interleave(const float *const *in, float *out, size_t frames, uint16_t nChannels);
+
+// converts frames frames of packed samples straight to separate channel arrays and back
+bool pcmToPlanar(const uint8_t *in, float *const *out, size_t frames, uint16_t nChannels,
+                 uint16_t bitDepth, SampleFormat format = SampleFormat::PCM);
+bool planarToPcm(const float *const *in, uint8_t *out, size_t frames, uint16_t nChannels,
+                 uint16_t bitDepth, SampleFormat format = SampleFormat::PCM);
+
+// the number of values past full scale, which the PCM kernels clamp
+size_t countClipped(const float *in, size_t n);
+size_t countClipped(const double *in, size_t n);
+
+// 8-bit samples are unsigned and converted from 0 to 1, with 128 as
+// silence, these move n of them to -1 to 1 with silence at 0 and back,
+// the same centering the integer samples get when they are widened
+void unsignedToSigned(float *samples, size_t n);
+void unsignedToSigned(double *samples, size_t n);
+void signedToUnsigned(float *samples, size_t n);
+void signedToUnsigned(double *samples, size_t n);
+
+// the name of the instruction set the kernels were compiled for
+const char* conversionKernelName();
+
+#endif // SAMPLECONVERSION_H_INCLUDED
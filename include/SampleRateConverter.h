@@ -0,0 +1,109 @@
+#ifndef SAMPLERATECONVERTER_H_INCLUDED
+#define SAMPLERATECONVERTER_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SampleRateConverter --
+
+    Changes the sample rate of planar audio with a polyphase windowed
+    sinc filter.  The ratio between the two rates is reduced to L/M,
+    and a bank of L filters, one for each position an output sample
+    can fall between two input samples, is worked out once in setup().
+    Every output sample is then a single dot product of one filter
+    with the input around it, which is vectorized.
+
+    Ratios with more than MAX_PHASES positions, e.g. 44100 to 44101,
+    use MAX_PHASES filters and interpolate between the two nearest.
+
+    The converter can be used in a streaming mode, passing blocks of
+    any size to process() and calling flush() at the end, or on a
+    whole WaveFile at once with convert().  The output is aligned with
+    the input, the filter delay is removed.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "AudioBuffer.h"
+#include "WaveFile.h"
+
+using namespace std;
+
+// quality and speed presets, from the shortest filter to the longest
+enum class ResampleQuality {
+    Fast,       // 16 taps, for previews
+    Standard,   // 32 taps
+    High,       // 64 taps
+    Best        // 128 taps, for mastering
+};
+
+class SampleRateConverter {
+private:
+    uint32_t m_inRate;
+    uint32_t m_outRate;
+    uint16_t m_nChannels;
+
+    // the ratio in lowest terms, L output samples for every M input samples
+    uint64_t m_up;
+    uint64_t m_down;
+
+    // the filter bank, m_nPhases filters of m_taps coefficients each, with
+    // an extra filter at the end when interpolating between filters
+    vector<float> m_filters;
+    size_t m_taps;
+    size_t m_nPhases;
+    bool m_interpolate;
+
+    // input not yet used up for each channel, starting from input frame
+    // m_historyStart, which is negative before the start of the input
+    vector<vector<float>> m_history;
+    int64_t m_historyStart;
+
+    uint64_t m_inputFrames;
+    uint64_t m_outputFrames;
+
+public:
+    static constexpr size_t MAX_PHASES = 1024;
+
+    SampleRateConverter();
+
+    // prepares the filter bank, returns false for an invalid rate or channel count
+    bool setup(uint32_t inRate, uint32_t outRate, uint16_t nChannels,
+               ResampleQuality quality = ResampleQuality::Standard);
+
+    // forgets all input, ready to start a new stream
+    void reset();
+
+    // streaming mode, converts the first frames frames of in and returns the
+    // number of frames put at the start of out, out is resized if it is too
+    // short, flush() returns the last frames once all input has been given
+    size_t process(const AudioBuffer &in, size_t frames, AudioBuffer &out);
+    size_t flush(AudioBuffer &out);
+
+    // the number of frames the whole of inFrames input frames converts to
+    uint64_t outputLength(uint64_t inFrames) const;
+
+    // converts a whole wave file, out is replaced, returns true if successful
+    static bool convert(const WaveFile &in, WaveFile &out, uint32_t sampleRate,
+                        ResampleQuality quality = ResampleQuality::Standard);
+
+    uint32_t inRate() const { return m_inRate; }
+    uint32_t outRate() const { return m_outRate; }
+    uint16_t nChannels() const { return m_nChannels; }
+    size_t taps() const { return m_taps; }
+
+private:
+    // the most frames one call to process() or flush() can return for frames input frames
+    size_t maxOutput(size_t frames) const;
+
+    // computes output frames while the input they need is available,
+    // up to outputLimit output frames in total
+    size_t produce(AudioBuffer &out, uint64_t outputLimit);
+
+    // drops input no output frame needs any more
+    void trimHistory();
+};
+
+#endif // SAMPLERATECONVERTER_H_INCLUDED
@@ -0,0 +1,117 @@
+#ifndef SIGNALGENERATOR_H_INCLUDED
+#define SIGNALGENERATOR_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SignalGenerator --
+
+    Test signals a block at a time: sine waves, logarithmic sweeps,
+    band limited square and sawtooth waves, white and pink noise, and
+    sums of sines (multitones).
+
+    Periodic signals keep their phase in turns (cycles) in a double,
+    so a tone stays in tune however long it runs.  For each block the
+    phases of all the samples are worked out from it first, then a
+    polynomial sine turns them into samples, several at a time with
+    SSE or AVX, instead of calling sin() for every sample.  The sine
+    is accurate to about 1e-7, below the resolution of 24-bit audio.
+
+    Square and sawtooth waves are smoothed around each jump (PolyBLEP)
+    so they do not alias.  Noise comes from a xorshift generator with
+    a fixed seed, so the same seed always gives the same signal, and
+    pink noise is white noise through Paul Kellet's filter.
+
+    The state carries over between calls, so a signal can be generated
+    in blocks of any size and streamed to disk.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "WaveFile.h"
+
+using namespace std;
+
+enum class Waveform {
+    Sine,
+    Square,
+    Saw,
+    LogSweep,
+    WhiteNoise,
+    PinkNoise,
+    Multitone
+};
+
+class SignalGenerator {
+private:
+    Waveform m_waveform;
+    uint32_t m_sampleRate;
+    float m_amplitude;
+
+    // the phase of each tone in turns, and how far it moves per sample
+    vector<double> m_phases;
+    vector<double> m_increments;
+
+    // the frequency of a sweep at frame n is startFrequency * ratio^n,
+    // and its phase, the integral of that, is scale * (ratio^n - 1) turns
+    double m_sweepRatio;
+    double m_sweepScale;
+    uint64_t m_sweepFrames;
+    uint64_t m_position;
+
+    // noise state
+    uint32_t m_seed;
+    uint32_t m_random;
+    float m_pink[7];
+
+    // the phases of one block
+    vector<float> m_block;
+
+public:
+    SignalGenerator(uint32_t sampleRate = 44100, uint32_t seed = 1);
+
+    // choose the signal, amplitude is the peak value, these also reset
+    // the phase and the noise to the start
+    void setSine(double frequency, float amplitude = 1.0f);
+    void setSquare(double frequency, float amplitude = 1.0f);
+    void setSaw(double frequency, float amplitude = 1.0f);
+    void setWhiteNoise(float amplitude = 1.0f);
+    void setPinkNoise(float amplitude = 1.0f);
+
+    // a sweep from startFrequency to endFrequency in seconds seconds,
+    // spending the same time on each octave, followed by silence
+    void setSweep(double startFrequency, double endFrequency, double seconds, float amplitude = 1.0f);
+
+    // a sum of sines of equal level, the sum never goes past amplitude
+    void setMultitone(const vector<double> &frequencies, float amplitude = 1.0f);
+
+    // back to the start of the signal
+    void reset();
+
+    // writes the next frames samples of the signal to out
+    void generate(float *out, size_t frames);
+
+    // writes the next frames of the signal to every channel of a wave from
+    // frame start, cut short at its end, returns true if successful
+    bool fill(WaveFile &wave, uint64_t start = 0, uint64_t frames = numeric_limits<uint64_t>::max());
+
+    // get methods
+    Waveform waveform() const { return m_waveform; }
+    uint32_t sampleRate() const { return m_sampleRate; }
+    uint64_t position() const { return m_position; }
+
+private:
+    // sets up tones at the given frequencies
+    void setTones(Waveform waveform, const vector<double> &frequencies, float amplitude);
+
+    // the phases of the next n samples of a tone, between -0.5 and 0.5 turns
+    void tonePhases(size_t tone, float *phases, size_t n);
+
+    void generateSweep(float *out, size_t n);
+    void generateNoise(float *out, size_t n);
+};
+
+#endif // SIGNALGENERATOR_H_INCLUDED
@@ -0,0 +1,86 @@
+#ifndef THREADPOOL_H_INCLUDED
+#define THREADPOOL_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- ThreadPool --
+
+    A fixed set of worker threads with a task queue each.  A worker
+    takes the newest task from its own queue, and when that is empty
+    it steals the oldest task from another worker, so uneven blocks
+    of work even out without a single shared queue every thread
+    fights over.
+
+    parallelFor() splits a range into chunks and waits for all of them
+    to finish.  A worker that calls it runs tasks while it waits, so
+    tasks can start parallel work of their own without deadlocking.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class ThreadPool {
+private:
+    struct Queue {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<Queue>> m_queues;
+    vector<thread> m_threads;
+
+    // sleeping workers wait here until there are queued tasks
+    mutex m_sleepLock;
+    condition_variable m_wake;
+    size_t m_queued;
+    bool m_stopping;
+
+    // the queue that tasks from outside the pool are added to next
+    atomic<unsigned> m_nextQueue;
+
+public:
+    // a pool of nThreads workers, 0 uses one per hardware thread
+    explicit ThreadPool(unsigned nThreads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &other) = delete;
+    ThreadPool& operator=(const ThreadPool &other) = delete;
+
+    // a pool shared by the library, with one worker per hardware thread
+    static ThreadPool& shared();
+
+    // queues a task to run on one of the workers
+    void submit(function<void()> task);
+
+    // calls body(first, last) for chunks of at most grain items
+    // covering [begin, end), and returns once all of them are done
+    void parallelFor(uint64_t begin, uint64_t end, uint64_t grain,
+                     const function<void(uint64_t, uint64_t)> &body);
+
+    // the number of worker threads
+    unsigned size() const { return static_cast<unsigned>(m_queues.size()); }
+
+    // the index of the worker of this pool running the calling thread,
+    // between 0 and size() - 1, or size() for any other thread
+    unsigned workerIndex() const;
+
+private:
+    // runs one queued task, from the worker's own queue if it has one,
+    // otherwise stolen from another queue, returns false if none were found
+    bool runOne(unsigned index);
+
+    void workerLoop(unsigned index);
+};
+
+#endif // THREADPOOL_H_INCLUDED
@@ -0,0 +1,56 @@
+#ifndef WAVEERROR_H_INCLUDED
+#define WAVEERROR_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- WaveError --
+
+    Why a call failed.  Methods still return true or false, or the
+    number of frames copied, and a WaveFile keeps the error of the last
+    call that failed so a program can tell what went wrong without
+    reading the log.  WaveCounters tally the problems in per-sample and
+    block methods, to be checked once a batch is done.
+*/
+
+#include <cstdint>
+
+enum class WaveError {
+    None,
+    CannotOpen,         // the file could not be opened or created
+    ReadFailed,         // the file ended early or could not be read
+    WriteFailed,        // the file could not be written
+    FormatError,        // the file is not a valid wave file
+    UnsupportedFormat,  // a valid wave file in a format that is not supported
+    FormatMismatch,     // another file or buffer has a different format
+    OutOfRange,         // a frame or range past the end of the audio
+    ReadOnly,           // the samples are mapped read only
+    NotSupported        // the system cannot memory map files
+};
+
+// a short description of an error
+inline const char* errorMessage(WaveError error) {
+    switch (error) {
+        case WaveError::None:               return "no error";
+        case WaveError::CannotOpen:         return "cannot open file";
+        case WaveError::ReadFailed:         return "error reading file";
+        case WaveError::WriteFailed:        return "error writing file";
+        case WaveError::FormatError:        return "file format error";
+        case WaveError::UnsupportedFormat:  return "unsupported format";
+        case WaveError::FormatMismatch:     return "format mismatch";
+        case WaveError::OutOfRange:         return "out of range";
+        case WaveError::ReadOnly:           return "read only";
+        case WaveError::NotSupported:       return "not supported on this system";
+    }
+    return "unknown error";
+}
+
+// problems counted by a WaveFile since it was created or the counters were reset
+struct WaveCounters {
+    uint64_t clipped{};                 // PCM samples clamped to full scale by the block set methods
+    uint64_t outOfRange{};              // get and set calls that start past the end
+    uint64_t invalid{};                 // other calls that failed, e.g. on the format or a read only file
+};
+
+#endif // WAVEERROR_H_INCLUDED
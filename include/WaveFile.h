@@ -12,64 +12,275 @@
     be created by opening and reading a wave file into memory, or
     by creating a new empty wave file.  The audio data in a wave
     file can be manipulated using the getSample() and setSample()
-    methods.  After processing, a WaveFile object can be written to
-    a new wave file using the write method.
+    methods, or a block at a time with getSamples() and setSamples().
+    After processing, a WaveFile object can be written to a new
+    wave file using the write method.
+
+    AudioSample only holds two channels, files with more channels can
+    be processed with readBuffer() and writeBuffer().
+
+    Both PCM and IEEE float waves are supported, including waves in
+    the extensible format, which are written back as plain waves.
+
+    For large files, map() can be used instead of read().  The audio
+    data is then memory mapped straight from the file rather than
+    copied, so opening is almost instant and pages are only loaded
+    when their samples are used.  When only a part of a long file is
+    needed, read() and write() can also be given a range of frames,
+    then only that part of the data is read, or overwritten in place.
+    probe() reads just the headers, to catalog files without their audio.
+
+    Methods that fail log why and leave the reason in lastError().  The
+    get and set methods, which may be called for every sample, count
+    their errors and the samples they clamp in counters() instead, and
+    only log the first error of each kind.
+
+    Copies of a WaveFile share their samples until one of them is
+    changed, only then are the samples copied (copy on write).  As
+    with the standard containers, one WaveFile object should not be
+    copied on one thread while it is changed on another.
 */
 
 #include <iostream>
 #include <fstream>
+#include <atomic>
 #include <string>
 #include <cstdint>
+#include <limits>
 #include <memory>
+#include <vector>
 #include "WaveFileHeaders.h"
+#include "MappedFile.h"
+#include "SampleBuffer.h"
+#include "ChunkIndex.h"
 #include "AudioSample.h"
+#include "AudioBuffer.h"
+#include "SampleConversion.h"
+#include "SampleCodec.h"
+#include "Dither.h"
+#include "Log.h"
+#include "WaveError.h"
 
 using namespace std;
 
+// the core attributes of a wave file on disk, as found by WaveFile::probe()
+struct WaveInfo {
+    uint64_t length{};                  // number of frames
+    uint64_t dataOffset{};              // position of the audio data within the file
+    uint32_t sampleRate{};
+    uint16_t nChannels{};
+    uint16_t bitDepth{};
+    SampleFormat sampleFormat{SampleFormat::PCM};
+};
+
 class WaveFile {
+    friend class WaveView;
+
 private:
     // header info
     RiffHeader m_riffHeader;
+    Ds64Chunk m_ds64Chunk;
     WaveFormatHeader m_formatHeader;
     WaveDataHeader m_dataHeader;
 
-    // audio data
-    unique_ptr<uint8_t[]> m_data;
+    // every chunk in the file the headers were read from, other chunks
+    // such as LIST or bext are only read when asked for
+    ChunkIndex m_chunks;
+    string m_fileName;
+
+    // true if only a range of frames was read from the file
+    bool m_partial;
+
+    // audio data, m_data points into m_samples which may be shared
+    // with copies of this object until one of them is changed
+    uint8_t *m_data;
+    shared_ptr<SampleBuffer> m_samples;
+    bool m_readOnly;
+    // true once floatData() or doubleData() has handed out a pointer the
+    // samples can be changed through, copies and views then copy them
+    bool m_exposed;
 
     // the core attributes of an audio file
-    uint32_t m_length;
+    uint64_t m_length;
     uint32_t m_sampleRate;
     uint16_t m_nChannels;
     uint16_t m_bitDepth;
+    SampleFormat m_sampleFormat;
+
+    // the conversion kernels for the format, looked up whenever it changes
+    const CodecTable *m_codec;
+
+    // the error of the last call that failed and the problems counted so
+    // far, these change in const methods too and are safe to change from
+    // several threads at once
+    mutable atomic<WaveError> m_lastError;
+    mutable atomic<uint64_t> m_clipped;
+    mutable atomic<uint64_t> m_outOfRange;
+    mutable atomic<uint64_t> m_invalid;
 
 public:
     WaveFile();
-    WaveFile(uint32_t length, uint32_t sampleRate = 44100, uint16_t nChannels = 2, uint16_t bitDepth = 16);
+    WaveFile(uint64_t length, uint32_t sampleRate = 44100, uint16_t nChannels = 2, uint16_t bitDepth = 16,
+             SampleFormat sampleFormat = SampleFormat::PCM);
     WaveFile(const WaveFile &other);
+    WaveFile(WaveFile &&other) noexcept;
     WaveFile(string fileName);
     WaveFile& operator=(const WaveFile &other);
+    WaveFile& operator=(WaveFile &&other) noexcept;
 
     // read and write, returns true if successful
+    // files over 4GB are written as RF64 files automatically
     bool read(string inFileName);
     bool write(string outFileName);
 
+    // reads frameCount frames starting at startFrame, the count is cut
+    // short at the end of the file, returns true if successful
+    bool read(string inFileName, uint64_t startFrame, uint64_t frameCount);
+
+    // overwrites the frames of an existing wave file from startFrame on
+    // with the samples of this one, the file must have the same format
+    // and be long enough, returns true if successful
+    bool write(string outFileName, uint64_t startFrame);
+
+    // memory maps a wave file instead of reading it, returns true if successful
+    // a ReadOnly mapping rejects setSample(), a CopyOnWrite mapping never
+    // changes the file on disk, changes must still be saved with write(),
+    // which may save them over the mapped file itself
+    bool map(string inFileName, MapMode mode = MapMode::CopyOnWrite,
+             AccessHint hint = AccessHint::Sequential);
+
+    // reads only the headers of a wave file, the same way read() does but
+    // with one small read of the start of the file and another for each
+    // chunk header further on, the audio data is never touched and
+    // nothing is printed, returns true if read() would accept the headers
+    static bool probe(string fileName, WaveInfo &info);
+
+    // changes the access hint for a mapped file, returns false if not mapped
+    bool advise(AccessHint hint);
+
+    // reads the data of any chunk in the file this was read from,
+    // e.g. "LIST" or "bext", returns true if successful
+    bool readChunk(string id, vector<uint8_t> &out) const;
+    const ChunkIndex& chunks() const { return m_chunks; }
+
     // get and set methods for an audio sample
-    AudioSample getSample(uint32_t sample);
-    void setSample(uint32_t sample, const AudioSample &audio);
+    AudioSample getSample(uint64_t sample);
+    void setSample(uint64_t sample, const AudioSample &audio);
+
+    // block get and set methods, these work on count frames of interleaved
+    // floats (count * nChannels values) and return the number of frames copied
+    uint32_t getSamples(uint64_t start, uint32_t count, float *out) const;
+    uint32_t setSamples(uint64_t start, uint32_t count, const float *in);
+
+    // the same for doubles, scaled like floats, and for the integers stored
+    // in a PCM wave, unscaled, the integer versions fail for float waves
+    uint32_t getSamples(uint64_t start, uint32_t count, double *out) const;
+    uint32_t setSamples(uint64_t start, uint32_t count, const double *in);
+    uint32_t getSamples(uint64_t start, uint32_t count, int32_t *out) const;
+    uint32_t setSamples(uint64_t start, uint32_t count, const int32_t *in);
+
+    // planar block methods, these work for any number of channels
+    // the buffer must have nChannels() channels, up to frames frames
+    // (by default buffer.length()) are copied and the number copied is returned
+    size_t readBuffer(uint64_t start, AudioBuffer &buffer,
+                      size_t frames = numeric_limits<size_t>::max()) const;
+    size_t writeBuffer(uint64_t start, const AudioBuffer &buffer,
+                       size_t frames = numeric_limits<size_t>::max());
+
+    // converts the samples to another bit depth or sample format, with dither
+    // when the resolution is reduced, the conversion is done in place when
+    // the samples get smaller, returns true if successful
+    // PCM is widened exactly, by shifting the integers, and narrowing it
+    // again without dither gives back the same samples
+    bool convertBitDepth(uint16_t bitDepth, SampleFormat sampleFormat = SampleFormat::PCM,
+                         DitherMode dither = DitherMode::Triangular);
+
+    // direct views of the samples of a 32-bit or 64-bit float wave,
+    // these return nullptr if the samples are not stored in that type
+    // a pointer is valid until the samples are replaced by read(), map(),
+    // convertBitDepth() or an assignment, copies and views made after a
+    // non-const call get their own samples, so writing through it never
+    // changes them
+    float* floatData();
+    const float* floatData() const;
+    double* doubleData();
+    const double* doubleData() const;
 
     // print methods
     void print();
     void printHeaderInfo();
 
     // get methods
-    uint32_t length() const { return m_length; }
+    uint64_t length() const { return m_length; }
+    uint64_t dataSize() const { return m_ds64Chunk.dataSize; }
     uint32_t sampleRate() const { return m_sampleRate; }
     uint16_t nChannels() const { return m_nChannels; }
     uint16_t bitDepth() const { return m_bitDepth; }
+    SampleFormat sampleFormat() const { return m_sampleFormat; }
+    const string& fileName() const { return m_fileName; }
+    bool isPartial() const { return m_partial; }
+    bool isMapped() const { return m_samples != nullptr && m_samples->isMapped(); }
+    bool isRF64() const { return m_riffHeader.chunkID[0] == 'R' && m_riffHeader.chunkID[1] == 'F'; }
+    bool isReadOnly() const { return m_readOnly; }
+
+    // the error of the last call that failed, calls that succeed leave it as it is
+    WaveError lastError() const { return m_lastError.load(memory_order_relaxed); }
+    void clearError() { m_lastError.store(WaveError::None, memory_order_relaxed); }
+
+    // the problems counted by the get and set methods, so a batch can be
+    // checked once it is done rather than logging every bad sample
+    WaveCounters counters() const;
+    void resetCounters();
+
+    // true if the samples are shared with a copy of this object
+    bool isShared() const { return m_samples != nullptr && m_samples.use_count() > 1; }
+
+    // copies the samples if they are shared or mapped read only, this is
+    // done by every set method, but calling it first lets separate ranges
+    // be set from several threads at once, returns false if read only
+    bool detach();
 
 private:
     // used to recalculate header values
     void setHeaders();
+
+    // reads the headers up to the start of the audio data and stores the core attributes
+    bool readHeaders(ifstream &inFile);
+
+    // allocates a zeroed buffer for the audio data
+    void allocate(uint64_t size);
+    // the samples for a copy or a view, copied if they may be changed
+    // through a pointer from floatData() or doubleData()
+    shared_ptr<SampleBuffer> shareSamples() const;
+
+    // records why a call failed and logs the message, returns false
+    template <typename... Args>
+    bool fail(WaveError error, const Args &...message) const;
+
+    // records an error in a method that may be called for every sample,
+    // it is counted but only the first of each kind is logged
+    void sampleError(WaveError error, const char *message) const;
+
+    // counts the values a block set method is about to clamp
+    template <typename T>
+    void countClips(const T *in, size_t n) const;
 };
 
+template <typename... Args>
+bool WaveFile::fail(WaveError error, const Args &...message) const {
+    m_lastError.store(error, memory_order_relaxed);
+    logMessage(LogLevel::Error, message...);
+    return false;
+}
+
+template <typename T>
+void WaveFile::countClips(const T *in, size_t n) const {
+    if (m_sampleFormat == SampleFormat::PCM) {
+        size_t clipped = countClipped(in, n);
+        if (clipped != 0) {
+            m_clipped.fetch_add(clipped, memory_order_relaxed);
+        }
+    }
+}
+
 #endif // WAVEFILE_H
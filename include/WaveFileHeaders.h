@@ -10,10 +10,20 @@
     These three structs hold the header information for a wave file.
     The default values here are meant to be overwritten with the exception
     of the char[]s which remain constant in every wave file.
+
+    Files larger than 4GB use the RF64 (or BW64) format instead.  The
+    RIFF id becomes "RF64", the 32-bit sizes are set to 0xFFFFFFFF
+    and the real 64-bit sizes are kept in a ds64 chunk that comes
+    right after the RIFF header.
 */
 
 #include <cstdint>
 
+// values for audioFormat
+static constexpr uint16_t WAVE_FORMAT_PCM = 1;
+static constexpr uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+static constexpr uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
 // The default values for these headers are for a 44100Hz, 16-bit, stereo, PCM Wave
 struct RiffHeader {
     /* RIFF header */
@@ -26,7 +36,7 @@ struct WaveFormatHeader {
     /* Format */
     char     subChunk1ID[4]{'f', 'm', 't', ' '};        // "fmt "
     uint32_t subChunk1Size{16};                         // 16 for PCM
-    uint16_t audioFormat{1};                            // PCM = 1
+    uint16_t audioFormat{1};                            // PCM = 1, IEEE float = 3
     uint16_t numChannels{2};                            // number of channels, 1 = mono, 2 = stereo
     uint32_t sampleRate{44100};                         // sample rate in Hz
     uint32_t byteRate{176400};                          // sampleRate * numChannels * bitsPerSample/8
@@ -36,6 +46,15 @@ struct WaveFormatHeader {
     // format may contain other info
 };
 
+// WAVE_FORMAT_EXTENSIBLE files continue the format chunk with this,
+// the first two bytes of subFormat hold the real audioFormat
+struct WaveFormatExtension {
+    uint16_t cbSize{22};                                // size of the rest of this extension
+    uint16_t validBitsPerSample{};                      // may be less than bitsPerSample
+    uint32_t channelMask{};                             // speaker positions of the channels
+    uint8_t  subFormat[16]{};                           // GUID, starts with the audioFormat
+};
+
 struct WaveDataHeader {
     /* Data */
     char     subChunk2ID[4]{'d', 'a', 't', 'a'};        // "data"
@@ -44,6 +63,22 @@ struct WaveDataHeader {
     // data comes after this header
 };
 
+// the ds64 chunk is packed so it can be read and written in one go
+#pragma pack(push, 1)
+struct Ds64Chunk {
+    /* RF64 sizes */
+    char     chunkID[4]{'d', 's', '6', '4'};            // "ds64", or "JUNK" when only reserving space
+    uint32_t chunkSize{28};                             // 28 without a table
+    uint64_t riffSize{};                                // 64-bit RIFF chunk size
+    uint64_t dataSize{};                                // 64-bit data chunk size
+    uint64_t sampleCount{};                             // number of sample frames
+    uint32_t tableLength{};                             // no table of other large chunks
+};
+#pragma pack(pop)
+
+// a 32-bit size field holding this value means the real size is in the ds64 chunk
+static constexpr uint32_t RF64_SIZE_MARKER = 0xFFFFFFFF;
+
 // total size of all of the headers
 static constexpr int WAVE_HEADER_SIZE = sizeof(RiffHeader) + sizeof(WaveFormatHeader)
     + sizeof(WaveDataHeader);
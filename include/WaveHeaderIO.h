@@ -0,0 +1,52 @@
+#ifndef WAVEHEADERIO_H_INCLUDED
+#define WAVEHEADERIO_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- WaveHeaderIO --
+
+    Reading and filling in the wave headers.  These are shared
+    by WaveFile and the streaming reader and writer so every part of
+    the library agrees on how a wave file is laid out.
+*/
+
+#include <iostream>
+#include <cstdint>
+#include "WaveFileHeaders.h"
+#include "ChunkIndex.h"
+#include "WaveError.h"
+
+using namespace std;
+
+// reads the riff, format and data headers, leaving inFile at the
+// start of the audio data, returns true if successful
+// ds64Chunk always receives the 64-bit sizes, even for a plain RIFF file
+bool readWaveHeaders(istream &inFile, RiffHeader &riffHeader, Ds64Chunk &ds64Chunk,
+                     WaveFormatHeader &formatHeader, WaveDataHeader &dataHeader);
+
+// the same as above, but also keeps the index of every chunk in the file,
+// and says why the headers were rejected if error is not null, the
+// reason is only logged if quiet is false
+bool readWaveHeaders(istream &inFile, RiffHeader &riffHeader, Ds64Chunk &ds64Chunk,
+                     WaveFormatHeader &formatHeader, WaveDataHeader &dataHeader,
+                     ChunkIndex &chunks, WaveError *error = nullptr, bool quiet = false);
+
+// writes the headers in the order they appear in a wave file,
+// the ds64 chunk is only written if ds64Chunk is not null
+void writeWaveHeaders(ostream &outFile, const RiffHeader &riffHeader, const Ds64Chunk *ds64Chunk,
+                      const WaveFormatHeader &formatHeader, const WaveDataHeader &dataHeader);
+
+// recalculates every size and rate in the headers from the core attributes,
+// the audioFormat is left as it is
+// returns true if the sizes need 64 bits, in which case the RIFF header
+// becomes an RF64 header and the ds64 chunk must be written
+// reserveDs64 is for writers that always write the ds64 chunk, as JUNK
+// while the file is small, so it can be upgraded to RF64 in place later
+bool fillWaveHeaders(uint64_t length, uint32_t sampleRate, uint16_t nChannels, uint16_t bitDepth,
+                     RiffHeader &riffHeader, Ds64Chunk &ds64Chunk,
+                     WaveFormatHeader &formatHeader, WaveDataHeader &dataHeader,
+                     bool reserveDs64 = false);
+
+#endif // WAVEHEADERIO_H_INCLUDED
@@ -0,0 +1,68 @@
+#ifndef WAVESCANNER_H_INCLUDED
+#define WAVESCANNER_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- WaveScanner --
+
+    Catalogs large libraries of wave files.  Every .wav file in a
+    directory and its subdirectories is found and probed with
+    WaveFile::probe(), which reads only the headers, so the time a
+    scan takes depends on the number of files rather than on how much
+    audio they hold.
+
+    Listing the directories is done on the calling thread, opening the
+    files and reading their headers is split over a ThreadPool.  Most
+    of the time is spent waiting for the disk, so a pool with more
+    threads than cores can help on slow or network storage.
+
+    The result is a WaveCatalog, a table with one row per file in the
+    order the files were found, and a list of the files that are not
+    waves the library can read.
+*/
+
+#include <iostream>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+#include "WaveFile.h"
+
+using namespace std;
+
+struct WaveCatalog {
+    vector<string> paths;
+    vector<WaveInfo> info;              // the attributes of paths[i]
+
+    // files with a .wav extension that could not be probed
+    vector<string> failed;
+
+    size_t size() const { return paths.size(); }
+    void clear();
+};
+
+class WaveScanner {
+private:
+    ThreadPool &m_pool;
+    size_t m_grain;
+
+public:
+    // the number of files probed by one task
+    static constexpr size_t DEFAULT_GRAIN = 64;
+
+    explicit WaveScanner(ThreadPool &pool = ThreadPool::shared(), size_t grain = DEFAULT_GRAIN);
+
+    // probes every .wav file in a directory, and in its subdirectories if
+    // recursive, replacing the contents of catalog
+    // returns false if the directory could not be read
+    bool scan(string directory, WaveCatalog &catalog, bool recursive = true) const;
+
+    // probes a list of files, replacing the contents of catalog
+    void probe(const vector<string> &fileNames, WaveCatalog &catalog) const;
+
+    ThreadPool& pool() const { return m_pool; }
+};
+
+#endif // WAVESCANNER_H_INCLUDED
@@ -0,0 +1,137 @@
+#ifndef WAVESTREAM_H_INCLUDED
+#define WAVESTREAM_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- WaveStream --
+
+    WaveStreamReader and WaveStreamWriter process a wave file a block
+    at a time instead of holding all of it in memory like a WaveFile.
+    Audio is passed in and out as interleaved floats, and only one
+    fixed size block of raw bytes is kept at any time, so memory use
+    stays the same no matter how long the file is.
+
+    The writer fills in placeholder headers when it is opened and
+    patches the sizes once it is closed.  It is also closed by the
+    destructor, but calling close() lets errors be checked.  Space for
+    a ds64 chunk is reserved as a JUNK chunk, so if more than 4GB of
+    audio is written the file is upgraded to RF64 in place on close.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "WaveFileHeaders.h"
+#include "SampleConversion.h"
+
+using namespace std;
+
+class WaveStreamReader {
+private:
+    ifstream m_file;
+
+    // header info
+    RiffHeader m_riffHeader;
+    Ds64Chunk m_ds64Chunk;
+    WaveFormatHeader m_formatHeader;
+    WaveDataHeader m_dataHeader;
+
+    // raw bytes for a single block
+    vector<uint8_t> m_block;
+    uint32_t m_blockFrames;
+
+    streampos m_dataStart;
+    uint64_t m_position;
+
+    // the core attributes of an audio file
+    uint64_t m_length;
+    uint32_t m_sampleRate;
+    uint16_t m_nChannels;
+    uint16_t m_bitDepth;
+    SampleFormat m_sampleFormat;
+
+public:
+    static constexpr uint32_t DEFAULT_BLOCK_FRAMES = 4096;
+
+    WaveStreamReader(uint32_t blockFrames = DEFAULT_BLOCK_FRAMES);
+    WaveStreamReader(string fileName, uint32_t blockFrames = DEFAULT_BLOCK_FRAMES);
+
+    // opens a wave file and reads its headers, returns true if successful
+    bool open(string inFileName);
+    void close();
+
+    // reads up to frames frames of interleaved floats into out,
+    // returns the number of frames read, 0 at the end of the file
+    uint32_t read(float *out, uint32_t frames);
+
+    // moves to a frame within the file, returns true if successful
+    bool seek(uint64_t frame);
+
+    // get methods
+    bool isOpen() const { return m_file.is_open(); }
+    uint64_t position() const { return m_position; }
+    uint64_t length() const { return m_length; }
+    uint32_t sampleRate() const { return m_sampleRate; }
+    uint16_t nChannels() const { return m_nChannels; }
+    uint16_t bitDepth() const { return m_bitDepth; }
+    SampleFormat sampleFormat() const { return m_sampleFormat; }
+};
+
+class WaveStreamWriter {
+private:
+    ofstream m_file;
+    string m_fileName;
+
+    // header info
+    RiffHeader m_riffHeader;
+    Ds64Chunk m_ds64Chunk;
+    WaveFormatHeader m_formatHeader;
+    WaveDataHeader m_dataHeader;
+
+    // raw bytes for a single block
+    vector<uint8_t> m_block;
+    uint32_t m_blockFrames;
+
+    // the core attributes of an audio file
+    uint64_t m_length;
+    uint32_t m_sampleRate;
+    uint16_t m_nChannels;
+    uint16_t m_bitDepth;
+    SampleFormat m_sampleFormat;
+
+public:
+    static constexpr uint32_t DEFAULT_BLOCK_FRAMES = 4096;
+
+    WaveStreamWriter(uint32_t blockFrames = DEFAULT_BLOCK_FRAMES);
+    WaveStreamWriter(string fileName, uint32_t sampleRate = 44100, uint16_t nChannels = 2,
+                     uint16_t bitDepth = 16, SampleFormat sampleFormat = SampleFormat::PCM,
+                     uint32_t blockFrames = DEFAULT_BLOCK_FRAMES);
+    ~WaveStreamWriter();
+    WaveStreamWriter(const WaveStreamWriter &other) = delete;
+    WaveStreamWriter& operator=(const WaveStreamWriter &other) = delete;
+
+    // creates a new wave file, returns true if successful
+    bool open(string outFileName, uint32_t sampleRate = 44100, uint16_t nChannels = 2,
+              uint16_t bitDepth = 16, SampleFormat sampleFormat = SampleFormat::PCM);
+
+    // patches the header sizes and closes the file, returns true if successful
+    bool close();
+
+    // appends frames frames of interleaved floats, PCM values are clamped
+    // between 1 and -1, returns the number of frames written
+    uint32_t write(const float *in, uint32_t frames);
+
+    // get methods
+    bool isOpen() const { return m_file.is_open(); }
+    uint64_t length() const { return m_length; }
+    uint32_t sampleRate() const { return m_sampleRate; }
+    uint16_t nChannels() const { return m_nChannels; }
+    uint16_t bitDepth() const { return m_bitDepth; }
+    SampleFormat sampleFormat() const { return m_sampleFormat; }
+};
+
+#endif // WAVESTREAM_H_INCLUDED
@@ -0,0 +1,154 @@
+#ifndef WAVEVIEW_H_INCLUDED
+#define WAVEVIEW_H_INCLUDED
+
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- WaveView --
+
+    A WaveView is a range of frames and a choice of channels of a
+    WaveFile, read or mapped, without copying any samples.  Views can
+    be sliced, split into segments and narrowed to some of the
+    channels, and they are read with the same methods as a WaveFile
+    or written straight to a new wave file.
+
+    A view shares the SampleBuffer of the wave it was made from, like
+    a copy of the WaveFile does, so it stays valid after the wave is
+    changed or destroyed and always sees the samples as they were
+    when it was made.  Changing the wave while views of it are kept
+    copies its samples first, the same as changing a copy would.
+
+    A WaveViewList joins views of the same format end to end, so a
+    file can be put together from pieces of others and written out
+    without building it in memory first.
+*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include "WaveFile.h"
+
+using namespace std;
+
+class WaveView {
+    friend class WaveViewList;
+
+private:
+    // keeps the samples alive, m_data points to the first frame of the view
+    shared_ptr<SampleBuffer> m_samples;
+    const uint8_t *m_data;
+
+    // the channels of the wave in the view, in order, and the size of
+    // a frame of the wave, which is the step between frames of the view
+    vector<uint16_t> m_channels;
+    size_t m_stride;
+    bool m_contiguous;
+
+    // the core attributes of the view
+    uint64_t m_length;
+    uint32_t m_sampleRate;
+    uint16_t m_bitDepth;
+    SampleFormat m_sampleFormat;
+    const CodecTable *m_codec;
+
+public:
+    WaveView();
+    WaveView(const WaveFile &wave);
+    WaveView(const WaveFile &wave, uint64_t start, uint64_t length);
+
+    // a view of part of this view, cut short at its end
+    WaveView slice(uint64_t start, uint64_t length) const;
+
+    // a view of some of the channels of this view, given by their index
+    // in this view, returns an empty view if a channel does not exist
+    WaveView select(const vector<uint16_t> &channels) const;
+
+    // cuts the view into segments of segmentFrames frames, the last one
+    // holds whatever is left
+    vector<WaveView> split(uint64_t segmentFrames) const;
+
+    // the same read methods as WaveFile
+    AudioSample getSample(uint64_t sample) const;
+    uint32_t getSamples(uint64_t start, uint32_t count, float *out) const;
+    size_t readBuffer(uint64_t start, AudioBuffer &buffer,
+                      size_t frames = numeric_limits<size_t>::max()) const;
+
+    // writes the view to a new wave file, returns true if successful
+    bool write(string outFileName) const;
+
+    // appends the packed samples of the view to a stream, returns true if successful
+    bool writeData(ostream &outFile) const;
+
+    // copies the view into a WaveFile of its own
+    WaveFile toWaveFile() const;
+
+    // get methods
+    bool isEmpty() const { return m_length == 0; }
+    uint64_t length() const { return m_length; }
+    uint64_t dataSize() const { return m_length * frameBytes(); }
+    uint32_t sampleRate() const { return m_sampleRate; }
+    uint16_t nChannels() const { return static_cast<uint16_t>(m_channels.size()); }
+    uint16_t bitDepth() const { return m_bitDepth; }
+    SampleFormat sampleFormat() const { return m_sampleFormat; }
+
+    // true if the frames of the view are stored one after the other,
+    // then they are read and written without being gathered first
+    bool isContiguous() const { return m_contiguous; }
+
+private:
+    size_t frameBytes() const { return m_channels.size() * (m_bitDepth / 8); }
+
+    // the packed samples of count frames from start, either straight from
+    // the wave or gathered into scratch when only some channels are used
+    const uint8_t* packed(uint64_t start, size_t count, vector<uint8_t> &scratch) const;
+
+    // reads up to frames frames into separate channel arrays, returns the number read
+    size_t readPlanar(uint64_t start, float *const *out, size_t frames) const;
+};
+
+class WaveViewList {
+private:
+    vector<WaveView> m_views;
+
+    // the first frame of each view within the list
+    vector<uint64_t> m_starts;
+    uint64_t m_length;
+
+public:
+    WaveViewList();
+
+    // adds a view to the end, returns false unless it has the same
+    // sample rate, channels, bit depth and format as the views before it
+    bool append(const WaveView &view);
+    void clear();
+
+    // the same read methods as WaveFile, across the joins between views
+    uint32_t getSamples(uint64_t start, uint32_t count, float *out) const;
+    size_t readBuffer(uint64_t start, AudioBuffer &buffer,
+                      size_t frames = numeric_limits<size_t>::max()) const;
+
+    // writes every view in turn to a new wave file, returns true if successful
+    bool write(string outFileName) const;
+
+    // get methods
+    const vector<WaveView>& views() const { return m_views; }
+    bool isEmpty() const { return m_length == 0; }
+    uint64_t length() const { return m_length; }
+    uint64_t dataSize() const;
+    uint32_t sampleRate() const { return m_views.empty() ? 0 : m_views.front().sampleRate(); }
+    uint16_t nChannels() const { return m_views.empty() ? 0 : m_views.front().nChannels(); }
+    uint16_t bitDepth() const { return m_views.empty() ? 0 : m_views.front().bitDepth(); }
+    SampleFormat sampleFormat() const {
+        return m_views.empty() ? SampleFormat::PCM : m_views.front().sampleFormat();
+    }
+
+private:
+    // the index of the view holding a frame
+    size_t find(uint64_t frame) const;
+};
+
+#endif // WAVEVIEW_H_INCLUDED
@@ -14,7 +14,9 @@
 #include <iostream>
 #include <string>
 
-bool wordCompare(char *charArray, string word) {
+using namespace std;
+
+inline bool wordCompare(const char *charArray, string word) {
     for (int i = 0; i < 4; ++i) {
         if (charArray[i] != word[i]) {
             return false;
@@ -23,7 +25,7 @@ bool wordCompare(char *charArray, string word) {
     return true;
 }
 
-void printWord(char *text) {
+inline void printWord(const char *text) {
     for (int i = 0; i < 4; ++i) {
         cout << text[i];
     }
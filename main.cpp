@@ -13,32 +13,40 @@
 */
 
 #include <iostream>
-#include <cmath>
+#include <vector>
+#include "SignalGenerator.h"
 #include "WaveFile.h"
+#include "WaveStream.h"
 using namespace std;
 
-static const double PI = 3.141592653589793238463;
-
 int main()
 {
-    // parameters for creating a new wave file
-    // (length in samples, sample rate = 44100, channels = 2, bit depth = 16)
-    WaveFile wave(44100 * 5, 44100, 1, 16);
+    // parameters for streaming a new wave file to disk
+    // (file name, sample rate = 44100, channels = 2, bit depth = 16)
+    WaveStreamWriter writer("hello_sine.wav", 44100, 1, 16);
 
+    uint32_t length{44100 * 5};
     double freq{440};
-    double amp{0.6};
+    float amp{0.6f};
+
+    SignalGenerator generator(writer.sampleRate());
+    generator.setSine(freq, amp);
+
+    // only one block of audio is held in memory at a time
+    vector<float> block(WaveStreamWriter::DEFAULT_BLOCK_FRAMES * writer.nChannels());
 
-    for (uint32_t i = 0; i < wave.length(); ++i){
-        //AudioSample sample = wave.getSample(i);
+    for (uint32_t start = 0; start < length; start += WaveStreamWriter::DEFAULT_BLOCK_FRAMES) {
+        uint32_t frames = min(length - start, WaveStreamWriter::DEFAULT_BLOCK_FRAMES);
 
+        generator.generate(block.data(), frames);
         // *** Processing goes here *** //
-        AudioSample sineWave = sin(2 * PI * i * (freq) / wave.sampleRate()) * amp;
 
-        wave.setSample(i, sineWave);
+        writer.write(block.data(), frames);
     }
 
-    wave.write("hello_sine.wav");
+    writer.close();
 
+    WaveFile wave("hello_sine.wav");
     wave.print();
 
     return 0;
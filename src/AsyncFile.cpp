@@ -0,0 +1,422 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- AsyncFile --
+
+    Background positional I/O through io_uring or a small set of
+    threads.  The io_uring backend sets up the submission and
+    completion rings itself with io_uring_setup() and mmap(), and
+    submits every request as soon as it is queued.
+*/
+
+#include "AsyncFile.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if SIMPLE_WAVE_HAS_ASYNC_FILE
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if SIMPLE_WAVE_HAS_ASYNC_FILE && defined(__linux__) && defined(__NR_io_uring_setup) \
+        && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define SIMPLE_WAVE_HAS_IO_URING 1
+#endif
+#endif
+
+#ifndef SIMPLE_WAVE_HAS_IO_URING
+#define SIMPLE_WAVE_HAS_IO_URING 0
+#endif
+
+#if SIMPLE_WAVE_HAS_ASYNC_FILE && !defined(O_DIRECT)
+#define O_DIRECT 0
+#endif
+
+/* io_uring backend */
+
+struct AsyncFile::Ring {
+#if SIMPLE_WAVE_HAS_IO_URING
+    int fd{-1};
+
+    void *sqRing{MAP_FAILED};
+    size_t sqRingSize{0};
+    void *cqRing{MAP_FAILED};
+    size_t cqRingSize{0};
+    io_uring_sqe *sqes{static_cast<io_uring_sqe *>(MAP_FAILED)};
+    size_t sqesSize{0};
+
+    unsigned *sqTail{nullptr};
+    unsigned *sqMask{nullptr};
+    unsigned *sqArray{nullptr};
+    unsigned *cqHead{nullptr};
+    unsigned *cqTail{nullptr};
+    unsigned *cqMask{nullptr};
+    io_uring_cqe *cqes{nullptr};
+
+    // each request needs an iovec that lives until it completes,
+    // the request's slot is passed to the kernel as its user data
+    vector<iovec> iovecs;
+    vector<uint64_t> tags;
+    vector<unsigned> freeSlots;
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqesSize);
+        }
+        if (cqRing != MAP_FAILED && cqRing != sqRing) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != MAP_FAILED) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool setup(unsigned depth) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+        if (fd < 0) {
+            return false;
+        }
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMap) {
+            sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            return false;
+        }
+        cqRing = singleMap ? sqRing
+                           : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                  fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                                                MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (sqes == MAP_FAILED) {
+            return false;
+        }
+
+        uint8_t *sq = static_cast<uint8_t *>(sqRing);
+        uint8_t *cq = static_cast<uint8_t *>(cqRing);
+        sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+        iovecs.resize(depth);
+        tags.resize(depth);
+        for (unsigned slot = depth; slot > 0; --slot) {
+            freeSlots.push_back(slot - 1);
+        }
+        return true;
+    }
+
+    bool submit(int fileFd, bool write, void *buffer, size_t length, uint64_t offset, uint64_t tag) {
+        if (freeSlots.empty()) {
+            return false;
+        }
+        unsigned slot = freeSlots.back();
+        freeSlots.pop_back();
+        iovecs[slot].iov_base = buffer;
+        iovecs[slot].iov_len = length;
+        tags[slot] = tag;
+
+        // only this thread adds entries, so the tail can be read plainly
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        io_uring_sqe &sqe = sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+        sqe.fd = fileFd;
+        sqe.addr = reinterpret_cast<uint64_t>(&iovecs[slot]);
+        sqe.len = 1;
+        sqe.off = offset;
+        sqe.user_data = slot;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        while (syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0) < 0) {
+            if (errno != EINTR && errno != EAGAIN) {
+                // take the entry back, the kernel has not seen it
+                __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+                freeSlots.push_back(slot);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void wait(AsyncCompletion &completion) {
+        while (true) {
+            unsigned head = *cqHead;
+            if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                const io_uring_cqe &cqe = cqes[head & *cqMask];
+                unsigned slot = static_cast<unsigned>(cqe.user_data);
+                completion.tag = tags[slot];
+                completion.result = cqe.res;
+                freeSlots.push_back(slot);
+                __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                return;
+            }
+            syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        }
+    }
+#endif
+};
+
+/* thread backend */
+
+struct AsyncFile::Workers {
+    struct Request {
+        bool write;
+        void *buffer;
+        size_t length;
+        uint64_t offset;
+        uint64_t tag;
+    };
+
+    int fd{-1};
+    vector<thread> threads;
+    mutex lock;
+    condition_variable requested;
+    condition_variable completed;
+    deque<Request> requests;
+    deque<AsyncCompletion> completions;
+    bool stopping{false};
+
+    ~Workers() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        requested.notify_all();
+        for (thread &worker : threads) {
+            worker.join();
+        }
+    }
+
+    void start(int fileFd, unsigned nThreads) {
+        fd = fileFd;
+        for (unsigned i = 0; i < nThreads; ++i) {
+            threads.emplace_back(&Workers::run, this);
+        }
+    }
+
+    void run() {
+        while (true) {
+            Request request;
+            {
+                unique_lock<mutex> guard(lock);
+                requested.wait(guard, [this]() { return !requests.empty() || stopping; });
+                if (requests.empty()) {
+                    return;
+                }
+                request = requests.front();
+                requests.pop_front();
+            }
+
+            int64_t result = 0;
+#if SIMPLE_WAVE_HAS_ASYNC_FILE
+            do {
+                result = request.write
+                       ? pwrite(fd, request.buffer, request.length, static_cast<off_t>(request.offset))
+                       : pread(fd, request.buffer, request.length, static_cast<off_t>(request.offset));
+            } while (result < 0 && errno == EINTR);
+            if (result < 0) {
+                result = -errno;
+            }
+#endif
+
+            {
+                lock_guard<mutex> guard(lock);
+                completions.push_back({request.tag, result});
+            }
+            completed.notify_one();
+        }
+    }
+
+    void submit(bool write, void *buffer, size_t length, uint64_t offset, uint64_t tag) {
+        {
+            lock_guard<mutex> guard(lock);
+            requests.push_back({write, buffer, length, offset, tag});
+        }
+        requested.notify_one();
+    }
+
+    void wait(AsyncCompletion &completion) {
+        unique_lock<mutex> guard(lock);
+        completed.wait(guard, [this]() { return !completions.empty(); });
+        completion = completions.front();
+        completions.pop_front();
+    }
+};
+
+/* AsyncFile */
+
+AsyncFile::AsyncFile():
+    m_fd{-1}, m_direct{false}, m_depth{}, m_pending{}, m_backend{AsyncBackend::Threads},
+    m_ring{}, m_workers{}
+{
+}
+
+AsyncFile::~AsyncFile() {
+    close();
+}
+
+// opens a file with room for depth requests in flight, returns true if successful
+bool AsyncFile::open(string fileName, AsyncMode mode, unsigned depth, bool direct, AsyncBackend backend) {
+    close();
+
+#if SIMPLE_WAVE_HAS_ASYNC_FILE
+    int flags = mode == AsyncMode::Write ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+    m_fd = direct && O_DIRECT != 0 ? ::open(fileName.c_str(), flags | O_DIRECT, 0644) : -1;
+    m_direct = m_fd >= 0;
+    if (m_fd < 0) {
+        m_fd = ::open(fileName.c_str(), flags, 0644);
+    }
+    if (m_fd < 0) {
+        logMessage(LogLevel::Error, (mode == AsyncMode::Write ? "Cannot create file: " : "Cannot open file: "), fileName);
+        return false;
+    }
+
+    m_depth = max(depth, 1u);
+    m_pending = 0;
+
+#if SIMPLE_WAVE_HAS_IO_URING
+    if (backend != AsyncBackend::Threads) {
+        m_ring.reset(new Ring());
+        if (m_ring->setup(m_depth)) {
+            m_backend = AsyncBackend::IoUring;
+            return true;
+        }
+        m_ring.reset();
+    }
+#endif
+
+    // the thread backend is used when io_uring is not available,
+    // even if it was asked for, since the requests work the same way
+    m_workers.reset(new Workers());
+    m_workers->start(m_fd, min(m_depth, 4u));
+    m_backend = AsyncBackend::Threads;
+    return true;
+#else
+    (void) mode;
+    (void) depth;
+    (void) direct;
+    (void) backend;
+    logMessage(LogLevel::Error, "Asynchronous I/O is not supported on this system: ", fileName);
+    return false;
+#endif
+}
+
+// waits for every request in flight and closes the file
+void AsyncFile::close() {
+    AsyncCompletion completion;
+    while (wait(completion)) {
+    }
+
+    m_ring.reset();
+    m_workers.reset();
+#if SIMPLE_WAVE_HAS_ASYNC_FILE
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+    m_fd = -1;
+    m_direct = false;
+}
+
+bool AsyncFile::submitRead(void *buffer, size_t length, uint64_t offset, uint64_t tag) {
+    return submit(false, buffer, length, offset, tag);
+}
+
+bool AsyncFile::submitWrite(const void *buffer, size_t length, uint64_t offset, uint64_t tag) {
+    return submit(true, const_cast<void *>(buffer), length, offset, tag);
+}
+
+bool AsyncFile::submit(bool write, void *buffer, size_t length, uint64_t offset, uint64_t tag) {
+    if (m_fd < 0 || m_pending >= m_depth) {
+        return false;
+    }
+
+#if SIMPLE_WAVE_HAS_IO_URING
+    if (m_ring) {
+        if (!m_ring->submit(m_fd, write, buffer, length, offset, tag)) {
+            return false;
+        }
+        ++m_pending;
+        return true;
+    }
+#endif
+
+    m_workers->submit(write, buffer, length, offset, tag);
+    ++m_pending;
+    return true;
+}
+
+// waits for the next request to complete, returns false if none are in flight
+bool AsyncFile::wait(AsyncCompletion &completion) {
+    if (m_pending == 0) {
+        return false;
+    }
+
+#if SIMPLE_WAVE_HAS_IO_URING
+    if (m_ring) {
+        m_ring->wait(completion);
+        --m_pending;
+        return true;
+    }
+#endif
+
+    m_workers->wait(completion);
+    --m_pending;
+    return true;
+}
+
+bool AsyncFile::truncate(uint64_t length) {
+#if SIMPLE_WAVE_HAS_ASYNC_FILE
+    return m_fd >= 0 && ftruncate(m_fd, static_cast<off_t>(length)) == 0;
+#else
+    (void) length;
+    return false;
+#endif
+}
+
+void* AsyncFile::allocate(size_t size) {
+    size = (size + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+    return ::operator new(max<size_t>(size, DIRECT_ALIGNMENT), align_val_t(DIRECT_ALIGNMENT));
+}
+
+void AsyncFile::release(void *buffer) {
+    ::operator delete(buffer, align_val_t(DIRECT_ALIGNMENT));
+}
@@ -0,0 +1,373 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- AsyncWaveStream --
+
+    AsyncWaveReader and AsyncWaveWriter stream a wave file through an
+    AsyncFile, a ring of blocks is kept in flight while the caller
+    converts the one at the head.
+*/
+
+#include "AsyncWaveStream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "Log.h"
+#include "WaveHeaderIO.h"
+
+/* AsyncWaveReader */
+
+AsyncWaveReader::AsyncWaveReader(unsigned depth, size_t blockBytes):
+    m_file{}, m_riffHeader{}, m_ds64Chunk{}, m_formatHeader{}, m_dataHeader{},
+    m_blocks(max(depth, 1u), Block{nullptr, 0, 0, false}),
+    m_blockBytes((max<size_t>(blockBytes, 1) + AsyncFile::DIRECT_ALIGNMENT - 1)
+                 / AsyncFile::DIRECT_ALIGNMENT * AsyncFile::DIRECT_ALIGNMENT),
+    m_head{}, m_queued{}, m_nextOffset{}, m_endOfData{false}, m_carry{}, m_carryBytes{},
+    m_dataStart{}, m_dataEnd{}, m_readOffset{}, m_position{},
+    m_length{}, m_sampleRate{}, m_nChannels{}, m_bitDepth{}, m_sampleFormat{SampleFormat::PCM}
+{
+}
+
+AsyncWaveReader::~AsyncWaveReader() {
+    close();
+}
+
+// opens a wave file, reads its headers and starts reading ahead,
+// returns true if successful
+bool AsyncWaveReader::open(string inFileName, bool direct, AsyncBackend backend) {
+    close();
+
+    // the headers are small and read once, so they are read normally
+    ifstream headerFile(inFileName, ios::binary);
+    if (!headerFile) {
+        logMessage(LogLevel::Error, "Cannot open file: ", inFileName);
+        return false;
+    }
+    if (!readWaveHeaders(headerFile, m_riffHeader, m_ds64Chunk, m_formatHeader, m_dataHeader)) {
+        return false;
+    }
+    m_dataStart = static_cast<uint64_t>(headerFile.tellg());
+    headerFile.close();
+
+    m_nChannels = m_formatHeader.numChannels;
+    m_sampleRate = m_formatHeader.sampleRate;
+    m_bitDepth = m_formatHeader.bitsPerSample;
+    m_sampleFormat = m_formatHeader.audioFormat == WAVE_FORMAT_IEEE_FLOAT ? SampleFormat::Float : SampleFormat::PCM;
+    m_length = m_ds64Chunk.sampleCount;
+    m_dataEnd = m_dataStart + m_length * m_formatHeader.blockAlign;
+
+    if (!m_file.open(inFileName, AsyncMode::Read, static_cast<unsigned>(m_blocks.size()), direct, backend)) {
+        return false;
+    }
+
+    for (Block &block : m_blocks) {
+        block.data = static_cast<uint8_t *>(AsyncFile::allocate(m_blockBytes));
+    }
+    m_carry.resize(m_formatHeader.blockAlign);
+
+    restart(0);
+    return true;
+}
+
+void AsyncWaveReader::close() {
+    m_file.close();
+    for (Block &block : m_blocks) {
+        if (block.data) {
+            AsyncFile::release(block.data);
+        }
+        block = Block{nullptr, 0, 0, false};
+    }
+    m_queued = 0;
+    m_position = 0;
+    m_length = 0;
+}
+
+// reads up to frames frames of interleaved floats into out,
+// returns the number of frames read, 0 at the end of the file
+uint32_t AsyncWaveReader::read(float *out, uint32_t frames) {
+    if (!m_file.isOpen()) {
+        return 0;
+    }
+    frames = static_cast<uint32_t>(min<uint64_t>(frames, m_length - m_position));
+
+    const size_t blockAlign = m_formatHeader.blockAlign;
+    uint32_t framesRead = 0;
+    while (framesRead < frames && waitForHead()) {
+        Block &block = m_blocks[m_head];
+        uint64_t end = min(block.offset + block.filled, m_dataEnd);
+
+        if (m_readOffset < end) {
+            const uint8_t *bytes = block.data + (m_readOffset - block.offset);
+            size_t available = static_cast<size_t>(end - m_readOffset);
+            float *samples = out + static_cast<size_t>(framesRead) * m_nChannels;
+
+            if (m_carryBytes > 0 || available < blockAlign) {
+                // a frame that straddles two blocks is put together in m_carry
+                size_t count = min(available, blockAlign - m_carryBytes);
+                memcpy(m_carry.data() + m_carryBytes, bytes, count);
+                m_carryBytes += count;
+                m_readOffset += count;
+                if (m_carryBytes == blockAlign) {
+                    pcmToFloat(m_carry.data(), samples, m_nChannels, m_bitDepth, m_sampleFormat);
+                    m_carryBytes = 0;
+                    ++framesRead;
+                }
+            } else {
+                uint32_t count = static_cast<uint32_t>(min<size_t>(available / blockAlign, frames - framesRead));
+                pcmToFloat(bytes, samples, static_cast<size_t>(count) * m_nChannels, m_bitDepth, m_sampleFormat);
+                m_readOffset += static_cast<uint64_t>(count) * blockAlign;
+                framesRead += count;
+            }
+            continue;
+        }
+
+        // a block that came back short before the end of the data means
+        // the file is truncated, only the frames that were there are read
+        if (block.offset + block.filled < min(block.offset + m_blockBytes, m_dataEnd)) {
+            m_endOfData = true;
+        }
+        m_head = (m_head + 1) % m_blocks.size();
+        --m_queued;
+        fill();
+    }
+
+    m_position += framesRead;
+    return framesRead;
+}
+
+// moves to a frame within the file, returns true if successful
+bool AsyncWaveReader::seek(uint64_t frame) {
+    if (!m_file.isOpen() || frame > m_length) {
+        return false;
+    }
+
+    restart(frame);
+    return true;
+}
+
+void AsyncWaveReader::restart(uint64_t frame) {
+    // the blocks in flight are collected before they can be reused
+    AsyncCompletion completion;
+    while (m_file.wait(completion)) {
+    }
+    for (Block &block : m_blocks) {
+        block.inFlight = false;
+    }
+
+    // reads start on an aligned offset before the frame, so they also
+    // suit a file opened with O_DIRECT
+    m_readOffset = m_dataStart + frame * m_formatHeader.blockAlign;
+    m_nextOffset = m_readOffset / AsyncFile::DIRECT_ALIGNMENT * AsyncFile::DIRECT_ALIGNMENT;
+    m_head = 0;
+    m_queued = 0;
+    m_carryBytes = 0;
+    m_endOfData = false;
+    m_position = frame;
+
+    fill();
+}
+
+// starts reading ahead from m_nextOffset into every idle block
+void AsyncWaveReader::fill() {
+    while (m_queued < m_blocks.size() && m_nextOffset < m_dataEnd && !m_endOfData) {
+        size_t index = (m_head + m_queued) % m_blocks.size();
+        Block &block = m_blocks[index];
+        if (!m_file.submitRead(block.data, m_blockBytes, m_nextOffset, index)) {
+            break;
+        }
+        block.offset = m_nextOffset;
+        block.filled = 0;
+        block.inFlight = true;
+        m_nextOffset += m_blockBytes;
+        ++m_queued;
+    }
+}
+
+// waits until the head block has been read, returns false on an error
+bool AsyncWaveReader::waitForHead() {
+    if (m_queued == 0 || m_endOfData) {
+        return false;
+    }
+
+    while (m_blocks[m_head].inFlight) {
+        AsyncCompletion completion;
+        if (!m_file.wait(completion)) {
+            return false;
+        }
+        Block &block = m_blocks[completion.tag];
+        block.inFlight = false;
+        block.filled = completion.result > 0 ? static_cast<uint64_t>(completion.result) : 0;
+        if (completion.result < 0) {
+            logMessage(LogLevel::Error, "Error reading file: ", strerror(static_cast<int>(-completion.result)));
+        }
+    }
+    return true;
+}
+
+/* AsyncWaveWriter */
+
+AsyncWaveWriter::AsyncWaveWriter(unsigned depth, size_t blockBytes):
+    m_file{}, m_fileName{}, m_riffHeader{}, m_ds64Chunk{}, m_formatHeader{}, m_dataHeader{},
+    m_blocks(max(depth, 1u), Block{nullptr, 0, false}), m_blockBytes(max<size_t>(blockBytes, 1)),
+    m_blockFrames{}, m_current{}, m_filled{}, m_nextOffset{}, m_failed{false},
+    m_length{}, m_sampleRate{}, m_nChannels{}, m_bitDepth{}, m_sampleFormat{SampleFormat::PCM}
+{
+}
+
+AsyncWaveWriter::~AsyncWaveWriter() {
+    close();
+}
+
+// creates a new wave file, returns true if successful
+bool AsyncWaveWriter::open(string outFileName, uint32_t sampleRate, uint16_t nChannels,
+                           uint16_t bitDepth, SampleFormat sampleFormat, AsyncBackend backend) {
+    close();
+
+    if (!isSupportedFormat(sampleFormat, bitDepth)) {
+        logMessage(LogLevel::Error, "Invalid bit depth");
+        return false;
+    }
+    if (nChannels == 0) {
+        logMessage(LogLevel::Error, "Invalid number of channels");
+        return false;
+    }
+
+    // one more request than there are blocks, for the headers
+    if (!m_file.open(outFileName, AsyncMode::Write, static_cast<unsigned>(m_blocks.size()) + 1, false, backend)) {
+        return false;
+    }
+
+    logMessage(LogLevel::Info, "Writing to file: ", outFileName);
+
+    m_fileName = outFileName;
+    m_length = 0;
+    m_sampleRate = sampleRate;
+    m_nChannels = nChannels;
+    m_bitDepth = bitDepth;
+    m_sampleFormat = sampleFormat;
+    m_formatHeader.audioFormat = sampleFormat == SampleFormat::Float ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+
+    // the headers are written by close() once the sizes are known, the
+    // reserved ds64 chunk keeps them the same size whatever the length
+    fillWaveHeaders(m_length, m_sampleRate, m_nChannels, m_bitDepth,
+                    m_riffHeader, m_ds64Chunk, m_formatHeader, m_dataHeader, true);
+    ostringstream headers;
+    writeWaveHeaders(headers, m_riffHeader, &m_ds64Chunk, m_formatHeader, m_dataHeader);
+    m_nextOffset = headers.str().size();
+
+    m_blockFrames = max<size_t>(m_blockBytes / m_formatHeader.blockAlign, 1);
+    for (Block &block : m_blocks) {
+        block.data = static_cast<uint8_t *>(AsyncFile::allocate(m_blockFrames * m_formatHeader.blockAlign));
+    }
+    m_current = 0;
+    m_filled = 0;
+    m_failed = false;
+
+    return true;
+}
+
+// waits for the blocks in flight, writes the headers and closes the
+// file, returns true if everything was written
+bool AsyncWaveWriter::close() {
+    if (!m_file.isOpen()) {
+        return true;
+    }
+
+    submitCurrent();
+    while (collect()) {
+    }
+
+    fillWaveHeaders(m_length, m_sampleRate, m_nChannels, m_bitDepth,
+                    m_riffHeader, m_ds64Chunk, m_formatHeader, m_dataHeader, true);
+    ostringstream stream;
+    writeWaveHeaders(stream, m_riffHeader, &m_ds64Chunk, m_formatHeader, m_dataHeader);
+    string headers = stream.str();
+
+    AsyncCompletion completion;
+    if (!m_file.submitWrite(headers.data(), headers.size(), 0, m_blocks.size())
+            || !m_file.wait(completion) || completion.result != static_cast<int64_t>(headers.size())) {
+        m_failed = true;
+    }
+    m_file.close();
+
+    for (Block &block : m_blocks) {
+        AsyncFile::release(block.data);
+        block = Block{nullptr, 0, false};
+    }
+
+    if (m_failed) {
+        logMessage(LogLevel::Error, "Error closing file: ", m_fileName);
+        return false;
+    }
+
+    return true;
+}
+
+// appends frames frames of interleaved floats, PCM values are clamped
+// between 1 and -1, returns the number of frames accepted
+uint32_t AsyncWaveWriter::write(const float *in, uint32_t frames) {
+    if (!m_file.isOpen() || m_failed) {
+        return 0;
+    }
+
+    const size_t blockAlign = m_formatHeader.blockAlign;
+    uint32_t framesWritten = 0;
+    while (framesWritten < frames) {
+        // the block is free again once its last write has completed
+        Block &block = m_blocks[m_current];
+        while (block.inFlight && collect()) {
+        }
+
+        uint32_t count = static_cast<uint32_t>(min<size_t>(frames - framesWritten, m_blockFrames - m_filled));
+        floatToPcm(in + static_cast<size_t>(framesWritten) * m_nChannels, block.data + m_filled * blockAlign,
+                   static_cast<size_t>(count) * m_nChannels, m_bitDepth, m_sampleFormat);
+        m_filled += count;
+        framesWritten += count;
+
+        if (m_filled == m_blockFrames) {
+            submitCurrent();
+            if (m_failed) {
+                break;
+            }
+        }
+    }
+
+    m_length += framesWritten;
+    return framesWritten;
+}
+
+// submits the current block and moves on to the next one
+void AsyncWaveWriter::submitCurrent() {
+    if (m_filled == 0) {
+        return;
+    }
+
+    Block &block = m_blocks[m_current];
+    block.length = m_filled * m_formatHeader.blockAlign;
+    if (!m_file.submitWrite(block.data, block.length, m_nextOffset, m_current)) {
+        m_failed = true;
+        return;
+    }
+    block.inFlight = true;
+    m_nextOffset += block.length;
+    m_current = (m_current + 1) % m_blocks.size();
+    m_filled = 0;
+}
+
+// collects one completion, noting a failed write
+bool AsyncWaveWriter::collect() {
+    AsyncCompletion completion;
+    if (!m_file.wait(completion)) {
+        return false;
+    }
+
+    Block &block = m_blocks[completion.tag];
+    block.inFlight = false;
+    if (completion.result != static_cast<int64_t>(block.length)) {
+        m_failed = true;
+    }
+    return true;
+}
@@ -0,0 +1,129 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- AudioBuffer --
+
+    An AudioBuffer holds any number of channels of float audio, with
+    each channel stored as its own aligned, contiguous array.
+*/
+
+#include "AudioBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
+#include "SampleConversion.h"
+
+void AudioBuffer::AlignedDelete::operator()(float *data) const {
+    ::operator delete(data, align_val_t(ALIGNMENT));
+}
+
+AudioBuffer::AudioBuffer(): m_data{nullptr}, m_stride{}, m_length{}, m_nChannels{}
+{
+}
+
+AudioBuffer::AudioBuffer(uint16_t nChannels, size_t length): AudioBuffer()
+{
+    resize(nChannels, length);
+}
+
+// the copy constructor performs a deep copy
+AudioBuffer::AudioBuffer(const AudioBuffer &other): AudioBuffer()
+{
+    *this = other;
+}
+
+AudioBuffer::AudioBuffer(AudioBuffer &&other) noexcept:
+    m_data(move(other.m_data)), m_stride(other.m_stride),
+    m_length(other.m_length), m_nChannels(other.m_nChannels)
+{
+    other.m_stride = 0;
+    other.m_length = 0;
+    other.m_nChannels = 0;
+}
+
+// the overloaded assignment operator performs a deep copy
+AudioBuffer& AudioBuffer::operator=(const AudioBuffer &other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    resize(other.m_nChannels, other.m_length);
+    if (m_data) {
+        memcpy(m_data.get(), other.m_data.get(), m_stride * m_nChannels * sizeof(float));
+    }
+    return *this;
+}
+
+AudioBuffer& AudioBuffer::operator=(AudioBuffer &&other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+
+    m_data = move(other.m_data);
+    m_stride = other.m_stride;
+    m_length = other.m_length;
+    m_nChannels = other.m_nChannels;
+
+    other.m_stride = 0;
+    other.m_length = 0;
+    other.m_nChannels = 0;
+    return *this;
+}
+
+// changes the size of the buffer, the contents are cleared to zero
+void AudioBuffer::resize(uint16_t nChannels, size_t length) {
+    // round each channel up to a whole number of aligned blocks
+    const size_t floatsPerBlock = ALIGNMENT / sizeof(float);
+    size_t stride = (length + floatsPerBlock - 1) / floatsPerBlock * floatsPerBlock;
+
+    if (stride * nChannels != m_stride * m_nChannels) {
+        m_data.reset();
+        if (stride * nChannels > 0) {
+            void *memory = ::operator new(stride * nChannels * sizeof(float), align_val_t(ALIGNMENT));
+            m_data.reset(static_cast<float *>(memory));
+        }
+    }
+
+    m_stride = stride;
+    m_length = length;
+    m_nChannels = nChannels;
+    clear();
+}
+
+// sets every sample to zero
+void AudioBuffer::clear() {
+    if (m_data) {
+        memset(m_data.get(), 0, m_stride * m_nChannels * sizeof(float));
+    }
+}
+
+// copies frames frames of interleaved floats into the buffer
+void AudioBuffer::deinterleave(const float *in, size_t frames, size_t offset) {
+    if (offset >= m_length) {
+        return;
+    }
+    frames = min(frames, m_length - offset);
+
+    vector<float *> channels(m_nChannels);
+    for (uint16_t c = 0; c < m_nChannels; ++c) {
+        channels[c] = channel(c) + offset;
+    }
+    ::deinterleave(in, channels.data(), frames, m_nChannels);
+}
+
+// copies frames frames out of the buffer as interleaved floats
+void AudioBuffer::interleave(float *out, size_t frames, size_t offset) const {
+    if (offset >= m_length) {
+        return;
+    }
+    frames = min(frames, m_length - offset);
+
+    vector<const float *> channels(m_nChannels);
+    for (uint16_t c = 0; c < m_nChannels; ++c) {
+        channels[c] = channel(c) + offset;
+    }
+    ::interleave(channels.data(), out, frames, m_nChannels);
+}
@@ -12,6 +12,22 @@
 */
 
 #include "AudioSample.h"
+#include "Log.h"
+
+#include <atomic>
+
+namespace {
+
+atomic<uint64_t> g_zeroDivisions{0};
+
+// counts a division by zero, logging only the first one
+void zeroDivisionError() {
+    if (g_zeroDivisions.fetch_add(1, memory_order_relaxed) == 0) {
+        logMessage(LogLevel::Warning, "Zero division error, further errors are only counted");
+    }
+}
+
+} // namespace
 
 AudioSample::AudioSample(): left(0), right(0) {}
 
@@ -39,32 +55,38 @@ AudioSample& AudioSample::invert() {
     return *this;
 }
 
-// these overloaded operators are for convenience when doing processing
+// the number of divisions by zero so far
+uint64_t AudioSample::zeroDivisions() {
+    return g_zeroDivisions.load(memory_order_relaxed);
+}
+
+// these overloaded operators are for convenience when doing processing,
+// the constructor clamps the result so there is no need to clamp again
 AudioSample operator+(const AudioSample &a, const AudioSample &b) {
-    return AudioSample(a.left + b.left, a.right + b.right).clampValues();
+    return AudioSample(a.left + b.left, a.right + b.right);
 }
 AudioSample operator+(const AudioSample &a, double b) {
-    return AudioSample(a.left + b, a.right + b).clampValues();
+    return AudioSample(a.left + b, a.right + b);
 }
 AudioSample operator+(double a, const AudioSample &b){
     return b + a;
 }
 
 AudioSample operator-(const AudioSample &a, const AudioSample &b) {
-    return AudioSample(a.left - b.left, a.right - b.right).clampValues();
+    return AudioSample(a.left - b.left, a.right - b.right);
 }
 AudioSample operator-(const AudioSample &a, double b){
-    return AudioSample(a.left - b, a.right - b).clampValues();
+    return AudioSample(a.left - b, a.right - b);
 }
 AudioSample operator-(double a, const AudioSample &b){
-    return b - a;
+    return AudioSample(a - b.left, a - b.right);
 }
 
 AudioSample operator*(const AudioSample &a, const AudioSample &b) {
-    return AudioSample(a.left * b.left, a.right * b.right).clampValues();
+    return AudioSample(a.left * b.left, a.right * b.right);
 }
 AudioSample operator*(const AudioSample &a, double b){
-    return AudioSample(a.left * b, a.right * b).clampValues();
+    return AudioSample(a.left * b, a.right * b);
 }
 AudioSample operator*(double a, const AudioSample &b){
     return b * a;
@@ -76,19 +98,24 @@ AudioSample operator*(double a, const AudioSample &b){
 AudioSample operator/(const AudioSample &a, const AudioSample &b) {
     // return an empty audio sample rather than ending the program
     if (b.left == 0 || b.right == 0) {
-        cout << "Zero division error" << endl;
+        zeroDivisionError();
         return AudioSample();
     }
-    return AudioSample(a.left / b.left, a.right / b.right).clampValues();
+    return AudioSample(a.left / b.left, a.right / b.right);
 }
 AudioSample operator/(const AudioSample &a, double b) {
     // return an empty audio sample rather than ending the program
     if (b == 0) {
-        cout << "Zero division error" << endl;
+        zeroDivisionError();
         return AudioSample();
     }
-    return AudioSample(a.left / b, a.right / b).clampValues();
+    return AudioSample(a.left / b, a.right / b);
 }
 AudioSample operator/(double a, const AudioSample &b) {
-    return b / a;
+    // return an empty audio sample rather than ending the program
+    if (b.left == 0 || b.right == 0) {
+        zeroDivisionError();
+        return AudioSample();
+    }
+    return AudioSample(a / b.left, a / b.right);
 }
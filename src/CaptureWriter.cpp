@@ -0,0 +1,131 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- CaptureWriter --
+
+    Records live audio to a wave file through a lock-free ring buffer.
+*/
+
+#include "CaptureWriter.h"
+#include "Log.h"
+
+#include <algorithm>
+
+CaptureWriter::CaptureWriter(uint32_t bufferFrames):
+    m_writer{}, m_ring{}, m_thread{}, m_running{false}, m_bufferFrames(max(bufferFrames, 1u)),
+    m_nChannels{}, m_pollInterval{}, m_framesPushed{0}, m_framesDropped{0}, m_overflows{0},
+    m_framesWritten{0}, m_maxFill{0}, m_failed{false}
+{
+}
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+// creates a new wave file and starts the writer thread, returns true if successful
+bool CaptureWriter::open(string outFileName, uint32_t sampleRate, uint16_t nChannels,
+                         uint16_t bitDepth, SampleFormat sampleFormat) {
+    close();
+
+    if (!m_writer.open(outFileName, sampleRate, nChannels, bitDepth, sampleFormat)) {
+        return false;
+    }
+
+    size_t capacity = static_cast<size_t>(m_bufferFrames) * nChannels;
+    if (!m_ring || m_nChannels != nChannels || m_ring->capacity() < capacity) {
+        m_ring.reset(new RingBuffer<float>(capacity));
+    }
+    m_nChannels = nChannels;
+
+    // wake up four times in the time it takes to fill the ring, often
+    // enough that it never gets close to full while the disk keeps up
+    uint64_t microseconds = static_cast<uint64_t>(m_bufferFrames) * 250000 / max(sampleRate, 1u);
+    m_pollInterval = chrono::microseconds(min<uint64_t>(max<uint64_t>(microseconds, 1000), 20000));
+
+    m_framesPushed = 0;
+    m_framesDropped = 0;
+    m_overflows = 0;
+    m_framesWritten = 0;
+    m_maxFill = 0;
+    m_failed = false;
+
+    m_running = true;
+    m_thread = thread(&CaptureWriter::run, this);
+
+    return true;
+}
+
+// writes everything still in the ring, patches the header sizes and
+// closes the file, returns true if every frame pushed was written
+bool CaptureWriter::close() {
+    if (!m_thread.joinable()) {
+        return true;
+    }
+
+    m_running = false;
+    m_thread.join();
+
+    if (!m_writer.close()) {
+        m_failed = true;
+    }
+    if (m_framesDropped > 0) {
+        logMessage(LogLevel::Warning, "Capture dropped ", m_framesDropped, " frames in ", m_overflows, " overflows");
+    }
+
+    return !m_failed && m_framesDropped == 0;
+}
+
+// queues frames frames of interleaved floats, safe to call from a
+// real-time thread, returns the number of frames queued
+uint32_t CaptureWriter::push(const float *in, uint32_t frames) {
+    if (!m_running.load(memory_order_relaxed)) {
+        return 0;
+    }
+
+    // only whole frames are queued, so the writer never sees part of one
+    uint32_t count = static_cast<uint32_t>(min<size_t>(frames, m_ring->writeAvailable() / m_nChannels));
+    m_ring->write(in, static_cast<size_t>(count) * m_nChannels);
+
+    m_framesPushed.fetch_add(count, memory_order_relaxed);
+    if (count < frames) {
+        m_framesDropped.fetch_add(frames - count, memory_order_relaxed);
+        m_overflows.fetch_add(1, memory_order_relaxed);
+    }
+    return count;
+}
+
+// the writer thread
+void CaptureWriter::run() {
+    vector<float> block(static_cast<size_t>(WaveStreamWriter::DEFAULT_BLOCK_FRAMES) * m_nChannels);
+
+    while (m_running.load(memory_order_acquire)) {
+        if (m_ring->readAvailable() == 0) {
+            this_thread::sleep_for(m_pollInterval);
+            continue;
+        }
+        drain(block);
+    }
+
+    // push() has stopped queueing, so this takes the last frames
+    drain(block);
+}
+
+// moves everything in the ring to the file
+void CaptureWriter::drain(vector<float> &block) {
+    uint64_t fill = m_ring->readAvailable() / m_nChannels;
+    if (fill > m_maxFill.load(memory_order_relaxed)) {
+        m_maxFill.store(fill, memory_order_relaxed);
+    }
+
+    size_t count;
+    while ((count = m_ring->read(block.data(), block.size())) > 0) {
+        uint32_t frames = static_cast<uint32_t>(count / m_nChannels);
+        uint32_t framesWritten = m_failed ? 0 : m_writer.write(block.data(), frames);
+        if (framesWritten < frames && !m_failed) {
+            logMessage(LogLevel::Error, "Capture cannot write to the file");
+            m_failed = true;
+        }
+        m_framesWritten.fetch_add(framesWritten, memory_order_relaxed);
+    }
+}
@@ -0,0 +1,83 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- ChunkIndex --
+
+    Walks the chunks of a RIFF file by following their sizes.
+*/
+
+#include "ChunkIndex.h"
+
+#include "WaveFileHeaders.h"
+#include "util.h"
+
+// walks every chunk after the RIFF header, inFile must be at the first chunk
+// returns true if at least one chunk was found
+bool ChunkIndex::build(istream &inFile) {
+    m_chunks.clear();
+
+    uint64_t offset = static_cast<uint64_t>(inFile.tellg());
+    Ds64Chunk ds64;
+    bool hasDs64{false};
+
+    while (true) {
+        ChunkInfo chunk;
+        uint32_t size{};
+        inFile.read(chunk.id, sizeof(chunk.id));
+        inFile.read(reinterpret_cast<char *>(&size), sizeof(size));
+        if (!inFile) {
+            break;
+        }
+
+        chunk.size = size;
+        chunk.offset = offset + sizeof(chunk.id) + sizeof(size);
+
+        // the ds64 chunk of an RF64 file holds the real size of the data chunk
+        if (wordCompare(chunk.id, "ds64") && size >= sizeof(Ds64Chunk) - 8) {
+            inFile.read(reinterpret_cast<char *>(&ds64.riffSize), sizeof(Ds64Chunk) - 8);
+            hasDs64 = static_cast<bool>(inFile);
+        }
+        if (wordCompare(chunk.id, "data") && size == RF64_SIZE_MARKER && hasDs64) {
+            chunk.size = ds64.dataSize;
+        }
+
+        m_chunks.push_back(chunk);
+
+        // chunks are padded to an even size, the pad byte is not counted in the size
+        offset = chunk.offset + chunk.size + (chunk.size & 1);
+        inFile.seekg(static_cast<streamoff>(offset));
+        if (!inFile) {
+            break;
+        }
+    }
+
+    // running off the end of the file is how the walk finishes
+    inFile.clear();
+    return !m_chunks.empty();
+}
+
+// returns the first chunk with a matching id or nullptr
+const ChunkInfo* ChunkIndex::find(string id) const {
+    for (const ChunkInfo &chunk : m_chunks) {
+        if (wordCompare(chunk.id, id)) {
+            return &chunk;
+        }
+    }
+    return nullptr;
+}
+
+// reads the data of a chunk, returns true if successful
+bool ChunkIndex::readChunk(istream &inFile, const ChunkInfo &chunk, vector<uint8_t> &out) {
+    out.resize(chunk.size);
+    inFile.clear();
+    inFile.seekg(static_cast<streamoff>(chunk.offset));
+    inFile.read(reinterpret_cast<char *>(out.data()), chunk.size);
+
+    if (!inFile) {
+        out.clear();
+        inFile.clear();
+        return false;
+    }
+    return true;
+}
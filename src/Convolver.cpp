@@ -0,0 +1,232 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- Convolver --
+
+    Uniformly partitioned overlap-save FFT convolution with a delay
+    line of input spectra.
+*/
+
+#include "Convolver.h"
+#include "Log.h"
+#include "SampleConversion.h"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// sum += x * h for n complex bins stored as separate real and imaginary parts
+void multiplyAdd(float *sumRe, float *sumIm, const float *xRe, const float *xIm,
+                 const float *hRe, const float *hIm, size_t n) {
+    size_t i = 0;
+#if defined(__AVX__)
+    for (; i + 8 <= n; i += 8) {
+        __m256 xr = _mm256_loadu_ps(xRe + i);
+        __m256 xi = _mm256_loadu_ps(xIm + i);
+        __m256 hr = _mm256_loadu_ps(hRe + i);
+        __m256 hi = _mm256_loadu_ps(hIm + i);
+        __m256 sr = _mm256_loadu_ps(sumRe + i);
+        __m256 si = _mm256_loadu_ps(sumIm + i);
+#if defined(__FMA__)
+        sr = _mm256_fnmadd_ps(xi, hi, _mm256_fmadd_ps(xr, hr, sr));
+        si = _mm256_fmadd_ps(xi, hr, _mm256_fmadd_ps(xr, hi, si));
+#else
+        sr = _mm256_sub_ps(_mm256_add_ps(sr, _mm256_mul_ps(xr, hr)), _mm256_mul_ps(xi, hi));
+        si = _mm256_add_ps(_mm256_add_ps(si, _mm256_mul_ps(xr, hi)), _mm256_mul_ps(xi, hr));
+#endif
+        _mm256_storeu_ps(sumRe + i, sr);
+        _mm256_storeu_ps(sumIm + i, si);
+    }
+#elif defined(__SSE__)
+    for (; i + 4 <= n; i += 4) {
+        __m128 xr = _mm_loadu_ps(xRe + i);
+        __m128 xi = _mm_loadu_ps(xIm + i);
+        __m128 hr = _mm_loadu_ps(hRe + i);
+        __m128 hi = _mm_loadu_ps(hIm + i);
+        __m128 sr = _mm_loadu_ps(sumRe + i);
+        __m128 si = _mm_loadu_ps(sumIm + i);
+        sr = _mm_sub_ps(_mm_add_ps(sr, _mm_mul_ps(xr, hr)), _mm_mul_ps(xi, hi));
+        si = _mm_add_ps(_mm_add_ps(si, _mm_mul_ps(xr, hi)), _mm_mul_ps(xi, hr));
+        _mm_storeu_ps(sumRe + i, sr);
+        _mm_storeu_ps(sumIm + i, si);
+    }
+#endif
+    for (; i < n; ++i) {
+        float re = xRe[i] * hRe[i] - xIm[i] * hIm[i];
+        float im = xRe[i] * hIm[i] + xIm[i] * hRe[i];
+        sumRe[i] += re;
+        sumIm[i] += im;
+    }
+}
+
+} // namespace
+
+// the FFT is two blocks long, so the window of the last two blocks of
+// input can be multiplied by a partition without wrapping around
+Convolver::Convolver(uint32_t blockFrames):
+    m_fft(static_cast<size_t>(max(blockFrames, 2u)) * 2), m_blockFrames{}, m_nPartitions{},
+    m_nChannels{}, m_nOutChannels{}, m_nImpulseChannels{}, m_impulse{}, m_history{}, m_delayLine{},
+    m_current{}, m_time{}, m_sum{}
+{
+    m_blockFrames = static_cast<uint32_t>(m_fft.size() / 2);
+    m_time.resize(m_fft.size());
+    m_sum.re.resize(m_fft.bins());
+    m_sum.im.resize(m_fft.bins());
+}
+
+// sets the impulse response for input with nChannels channels
+// returns true if successful
+bool Convolver::setImpulse(const WaveFile &impulse, uint16_t nChannels) {
+    uint16_t nImpulseChannels = impulse.nChannels();
+    if (impulse.length() == 0 || nImpulseChannels == 0 || nChannels == 0) {
+        logMessage(LogLevel::Error, "Impulse response is empty");
+        return false;
+    }
+    if (nImpulseChannels != nChannels && nImpulseChannels != 1 && nChannels != 1) {
+        logMessage(LogLevel::Error, "Impulse response channel count does not match the input");
+        return false;
+    }
+
+    m_nChannels = nChannels;
+    m_nImpulseChannels = nImpulseChannels;
+    m_nOutChannels = max(nChannels, nImpulseChannels);
+    m_nPartitions = static_cast<size_t>((impulse.length() + m_blockFrames - 1) / m_blockFrames);
+
+    // each partition is one block of the impulse response followed by a
+    // block of silence, transformed
+    size_t bins = m_fft.bins();
+    vector<float> block(static_cast<size_t>(m_blockFrames) * nImpulseChannels);
+    m_impulse.assign(nImpulseChannels, Spectra());
+    for (Spectra &spectra : m_impulse) {
+        spectra.re.resize(m_nPartitions * bins);
+        spectra.im.resize(m_nPartitions * bins);
+    }
+    for (size_t p = 0; p < m_nPartitions; ++p) {
+        uint32_t count = impulse.getSamples(p * m_blockFrames, m_blockFrames, block.data());
+        if (impulse.bitDepth() == 8) {
+            unsignedToSigned(block.data(), static_cast<size_t>(count) * nImpulseChannels);
+        }
+        for (uint16_t c = 0; c < nImpulseChannels; ++c) {
+            fill(m_time.begin(), m_time.end(), 0.0f);
+            for (uint32_t i = 0; i < count; ++i) {
+                m_time[i] = block[static_cast<size_t>(i) * nImpulseChannels + c];
+            }
+            m_fft.forward(m_time.data(), &m_impulse[c].re[p * bins], &m_impulse[c].im[p * bins]);
+        }
+    }
+
+    m_history.assign(nChannels, vector<float>(m_fft.size()));
+    m_delayLine.assign(nChannels, Spectra());
+    for (Spectra &spectra : m_delayLine) {
+        spectra.re.resize(m_nPartitions * bins);
+        spectra.im.resize(m_nPartitions * bins);
+    }
+    reset();
+
+    return true;
+}
+
+// clears the input history
+void Convolver::reset() {
+    for (vector<float> &history : m_history) {
+        fill(history.begin(), history.end(), 0.0f);
+    }
+    for (Spectra &spectra : m_delayLine) {
+        fill(spectra.re.begin(), spectra.re.end(), 0.0f);
+        fill(spectra.im.begin(), spectra.im.end(), 0.0f);
+    }
+    m_current = 0;
+}
+
+// convolves blockFrames() frames of interleaved floats
+// returns true if successful
+bool Convolver::process(const float *in, float *out) {
+    if (m_nPartitions == 0) {
+        logMessage(LogLevel::Error, "No impulse response");
+        return false;
+    }
+
+    // slide the window along by a block and transform it into the
+    // newest slot of the delay line
+    size_t bins = m_fft.bins();
+    m_current = (m_current + 1) % m_nPartitions;
+    for (uint16_t c = 0; c < m_nChannels; ++c) {
+        vector<float> &history = m_history[c];
+        copy(history.begin() + m_blockFrames, history.end(), history.begin());
+        for (uint32_t i = 0; i < m_blockFrames; ++i) {
+            history[m_blockFrames + i] = in[static_cast<size_t>(i) * m_nChannels + c];
+        }
+        m_fft.forward(history.data(), &m_delayLine[c].re[m_current * bins], &m_delayLine[c].im[m_current * bins]);
+    }
+
+    // partition p of the impulse response meets the input from p blocks ago
+    for (uint16_t c = 0; c < m_nOutChannels; ++c) {
+        const Spectra &input = m_delayLine[m_nChannels == 1 ? 0 : c];
+        const Spectra &impulse = m_impulse[m_nImpulseChannels == 1 ? 0 : c];
+
+        fill(m_sum.re.begin(), m_sum.re.end(), 0.0f);
+        fill(m_sum.im.begin(), m_sum.im.end(), 0.0f);
+        for (size_t p = 0; p < m_nPartitions; ++p) {
+            size_t slot = (m_current + m_nPartitions - p) % m_nPartitions;
+            multiplyAdd(m_sum.re.data(), m_sum.im.data(), &input.re[slot * bins], &input.im[slot * bins],
+                        &impulse.re[p * bins], &impulse.im[p * bins], bins);
+        }
+
+        // the first block of the result wrapped around, the second is the output
+        m_fft.inverse(m_sum.re.data(), m_sum.im.data(), m_time.data());
+        for (uint32_t i = 0; i < m_blockFrames; ++i) {
+            out[static_cast<size_t>(i) * m_nOutChannels + c] = m_time[m_blockFrames + i];
+        }
+    }
+
+    return true;
+}
+
+// convolves a whole wave, including the tail of the impulse response
+// returns true if successful
+bool Convolver::convolve(const WaveFile &in, const WaveFile &impulse, WaveFile &out, uint32_t blockFrames) {
+    if (impulse.sampleRate() != in.sampleRate()) {
+        logMessage(LogLevel::Error, "Impulse response sample rate does not match the input");
+        return false;
+    }
+
+    Convolver convolver(blockFrames);
+    if (!convolver.setImpulse(impulse, in.nChannels())) {
+        return false;
+    }
+
+    uint64_t length = in.length() + impulse.length() - 1;
+    WaveFile result(length, in.sampleRate(), convolver.nOutChannels(), in.bitDepth(), in.sampleFormat());
+
+    // past the end of the input the convolver is fed silence to play out
+    // the tail, 8-bit samples are centered on 0 on the way in and moved
+    // back on the way out so an offset is not convolved with the rest
+    bool isUnsigned = in.bitDepth() == 8;
+    uint32_t frames = convolver.blockFrames();
+    vector<float> inBlock(static_cast<size_t>(frames) * in.nChannels());
+    vector<float> outBlock(static_cast<size_t>(frames) * convolver.nOutChannels());
+    for (uint64_t start = 0; start < length; start += frames) {
+        uint32_t count = in.getSamples(start, frames, inBlock.data());
+        if (isUnsigned) {
+            unsignedToSigned(inBlock.data(), static_cast<size_t>(count) * in.nChannels());
+        }
+        fill(inBlock.begin() + static_cast<size_t>(count) * in.nChannels(), inBlock.end(), 0.0f);
+        convolver.process(inBlock.data(), outBlock.data());
+        if (isUnsigned) {
+            signedToUnsigned(outBlock.data(), outBlock.size());
+        }
+        result.setSamples(start, static_cast<uint32_t>(min<uint64_t>(frames, length - start)), outBlock.data());
+    }
+
+    out = move(result);
+    return true;
+}
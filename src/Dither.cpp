@@ -0,0 +1,236 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- Dither --
+
+    Triangular dither and noise shaping for bit depth reduction.  The
+    random numbers come from a xorshift generator for each of LANES
+    lanes, sample i always uses lane i % LANES, so the vector and
+    scalar loops produce identical results.
+*/
+
+#include "Dither.h"
+
+#include <algorithm>
+#include <cmath>
+#include "SampleConversion.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// samples quantized at a time, the values are then packed to bytes
+constexpr size_t CHUNK_SAMPLES = 2048;
+
+// turns the difference of two 24-bit random numbers into a value between -1 and 1
+constexpr float RANDOM_SCALE = 1.0f / 16777216.0f;
+
+// error feedback filter for noise shaping, a three tap approximation of
+// an equal loudness weighting (Wannamaker), most of the noise ends up
+// above 10kHz at 44.1kHz
+constexpr float SHAPING[3] = {1.623f, -0.982f, 0.109f};
+
+inline uint32_t xorshift(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// the step size and range of each bit depth, these match the scaling
+// used by pcmToFloat() so a value read back lands on the same step,
+// which means 8-bit samples are quantized from 0 to 1, not -1 to 1
+struct QuantizeRange {
+    float scale;
+    float lo;
+    float hi;
+};
+
+bool quantizeRange(uint16_t bitDepth, QuantizeRange &range) {
+    switch (bitDepth) {
+        case 8:  range = {255.0f, 0.0f, 255.0f}; return true;
+        case 16: range = {32767.0f, -32768.0f, 32767.0f}; return true;
+        case 24: range = {8388608.0f, -8388608.0f, 8388607.0f}; return true;
+        case 32: range = {2147483648.0f, -2147483648.0f, 2147483520.0f}; return true;
+        default: return false;
+    }
+}
+
+void pack(const int32_t *in, uint8_t *out, size_t n, uint16_t bitDepth) {
+    switch (bitDepth) {
+        case 8:
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = static_cast<uint8_t>(in[i]);
+            }
+            break;
+        case 16:
+            for (size_t i = 0; i < n; ++i) {
+                out[i * 2] = static_cast<uint8_t>(in[i]);
+                out[i * 2 + 1] = static_cast<uint8_t>(in[i] >> 8);
+            }
+            break;
+        case 24:
+            for (size_t i = 0; i < n; ++i) {
+                out[i * 3] = static_cast<uint8_t>(in[i]);
+                out[i * 3 + 1] = static_cast<uint8_t>(in[i] >> 8);
+                out[i * 3 + 2] = static_cast<uint8_t>(in[i] >> 16);
+            }
+            break;
+        case 32:
+            for (size_t i = 0; i < n; ++i) {
+                out[i * 4] = static_cast<uint8_t>(in[i]);
+                out[i * 4 + 1] = static_cast<uint8_t>(in[i] >> 8);
+                out[i * 4 + 2] = static_cast<uint8_t>(in[i] >> 16);
+                out[i * 4 + 3] = static_cast<uint8_t>(in[i] >> 24);
+            }
+            break;
+    }
+}
+
+} // namespace
+
+Ditherer::Ditherer(DitherMode mode, uint16_t nChannels, uint32_t seed):
+    m_mode(mode), m_nChannels(max<uint16_t>(nChannels, 1)), m_stateA{}, m_stateB{},
+    m_errors{}, m_values(CHUNK_SAMPLES)
+{
+    reset(seed);
+}
+
+// starts again from the seed with no noise shaping errors
+void Ditherer::reset(uint32_t seed) {
+    // spread the seed over the lanes, a xorshift state must not be zero
+    uint32_t value = seed ? seed : 1;
+    for (size_t lane = 0; lane < LANES; ++lane) {
+        m_stateA[lane] = value = value * 1664525u + 1013904223u;
+        m_stateB[lane] = value = value * 1664525u + 1013904223u;
+        m_stateA[lane] |= 1;
+        m_stateB[lane] |= 1;
+    }
+    m_errors.assign(static_cast<size_t>(m_nChannels) * 3, 0.0f);
+}
+
+bool Ditherer::quantize(const float *in, uint8_t *out, size_t frames, uint16_t bitDepth) {
+    if (m_mode == DitherMode::None) {
+        return floatToPcm(in, out, frames * m_nChannels, bitDepth);
+    }
+
+    QuantizeRange range;
+    if (!quantizeRange(bitDepth, range)) {
+        return false;
+    }
+
+    const size_t bytesPerSample = bitDepth / 8;
+    const size_t chunkFrames = max<size_t>(CHUNK_SAMPLES / m_nChannels, 1);
+    if (m_values.size() < chunkFrames * m_nChannels) {
+        m_values.resize(chunkFrames * m_nChannels);
+    }
+
+    for (size_t frame = 0; frame < frames; frame += chunkFrames) {
+        size_t count = min(chunkFrames, frames - frame);
+        size_t index = frame * m_nChannels;
+        size_t n = count * m_nChannels;
+
+        if (m_mode == DitherMode::NoiseShaped) {
+            noiseShaped(in + index, m_values.data(), count, range.scale, range.lo, range.hi);
+        } else {
+            triangular(in + index, m_values.data(), n, range.scale, range.lo, range.hi);
+        }
+        pack(m_values.data(), out + index * bytesPerSample, n, bitDepth);
+    }
+    return true;
+}
+
+void Ditherer::triangular(const float *in, int32_t *out, size_t n, float scale, float lo, float hi) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 vScale = _mm256_set1_ps(scale);
+    const __m256 vLo = _mm256_set1_ps(lo);
+    const __m256 vHi = _mm256_set1_ps(hi);
+    const __m256 vRandom = _mm256_set1_ps(RANDOM_SCALE);
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(m_stateA));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(m_stateB));
+    for (; i + LANES <= n; i += LANES) {
+        a = _mm256_xor_si256(a, _mm256_slli_epi32(a, 13));
+        a = _mm256_xor_si256(a, _mm256_srli_epi32(a, 17));
+        a = _mm256_xor_si256(a, _mm256_slli_epi32(a, 5));
+        b = _mm256_xor_si256(b, _mm256_slli_epi32(b, 13));
+        b = _mm256_xor_si256(b, _mm256_srli_epi32(b, 17));
+        b = _mm256_xor_si256(b, _mm256_slli_epi32(b, 5));
+
+        __m256i difference = _mm256_sub_epi32(_mm256_srli_epi32(a, 8), _mm256_srli_epi32(b, 8));
+        __m256 dither = _mm256_mul_ps(_mm256_cvtepi32_ps(difference), vRandom);
+        __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(in + i), vScale), dither);
+        v = _mm256_min_ps(_mm256_max_ps(v, vLo), vHi);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_cvtps_epi32(v));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(m_stateA), a);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(m_stateB), b);
+#elif defined(__SSE2__)
+    const __m128 vScale = _mm_set1_ps(scale);
+    const __m128 vLo = _mm_set1_ps(lo);
+    const __m128 vHi = _mm_set1_ps(hi);
+    const __m128 vRandom = _mm_set1_ps(RANDOM_SCALE);
+    __m128i a[2], b[2];
+    for (int h = 0; h < 2; ++h) {
+        a[h] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(m_stateA + h * 4));
+        b[h] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(m_stateB + h * 4));
+    }
+    for (; i + LANES <= n; i += LANES) {
+        for (int h = 0; h < 2; ++h) {
+            a[h] = _mm_xor_si128(a[h], _mm_slli_epi32(a[h], 13));
+            a[h] = _mm_xor_si128(a[h], _mm_srli_epi32(a[h], 17));
+            a[h] = _mm_xor_si128(a[h], _mm_slli_epi32(a[h], 5));
+            b[h] = _mm_xor_si128(b[h], _mm_slli_epi32(b[h], 13));
+            b[h] = _mm_xor_si128(b[h], _mm_srli_epi32(b[h], 17));
+            b[h] = _mm_xor_si128(b[h], _mm_slli_epi32(b[h], 5));
+
+            __m128i difference = _mm_sub_epi32(_mm_srli_epi32(a[h], 8), _mm_srli_epi32(b[h], 8));
+            __m128 dither = _mm_mul_ps(_mm_cvtepi32_ps(difference), vRandom);
+            __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(in + i + h * 4), vScale), dither);
+            v = _mm_min_ps(_mm_max_ps(v, vLo), vHi);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i + h * 4), _mm_cvtps_epi32(v));
+        }
+    }
+    for (int h = 0; h < 2; ++h) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(m_stateA + h * 4), a[h]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(m_stateB + h * 4), b[h]);
+    }
+#endif
+    for (; i < n; ++i) {
+        size_t lane = i % LANES;
+        int32_t difference = static_cast<int32_t>(xorshift(m_stateA[lane]) >> 8)
+                           - static_cast<int32_t>(xorshift(m_stateB[lane]) >> 8);
+        float v = in[i] * scale + difference * RANDOM_SCALE;
+        out[i] = static_cast<int32_t>(lrintf(min(max(v, lo), hi)));
+    }
+}
+
+void Ditherer::noiseShaped(const float *in, int32_t *out, size_t frames, float scale, float lo, float hi) {
+    size_t i = 0;
+    for (size_t frame = 0; frame < frames; ++frame) {
+        for (uint16_t c = 0; c < m_nChannels; ++c, ++i) {
+            float *errors = &m_errors[c * 3];
+            size_t lane = i % LANES;
+            int32_t difference = static_cast<int32_t>(xorshift(m_stateA[lane]) >> 8)
+                               - static_cast<int32_t>(xorshift(m_stateB[lane]) >> 8);
+
+            float wanted = in[i] * scale
+                         - (SHAPING[0] * errors[0] + SHAPING[1] * errors[1] + SHAPING[2] * errors[2]);
+            float v = min(max(wanted + difference * RANDOM_SCALE, lo), hi);
+            int32_t value = static_cast<int32_t>(lrintf(v));
+            out[i] = value;
+
+            // the error is limited so clipping cannot make the feedback run away
+            errors[2] = errors[1];
+            errors[1] = errors[0];
+            errors[0] = min(max(static_cast<float>(value) - wanted, -2.0f), 2.0f);
+        }
+    }
+}
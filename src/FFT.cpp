@@ -0,0 +1,125 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- FFT --
+
+    A real FFT built on a radix-2 complex transform of half the size.
+*/
+
+#include "FFT.h"
+
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+// complex multiplication without the checks for infinities that
+// operator* makes, which keep it from being inlined
+inline complex<float> multiply(complex<float> a, complex<float> b) {
+    return complex<float>(a.real() * b.real() - a.imag() * b.imag(),
+                          a.real() * b.imag() + a.imag() * b.real());
+}
+
+} // namespace
+
+RealFFT::RealFFT(size_t size):
+    m_size(4), m_bitReverse{}, m_twiddles{}, m_unpack{}, m_work{}
+{
+    while (m_size < size) {
+        m_size <<= 1;
+    }
+
+    // the twiddles are worked out in double so they stay accurate for long transforms
+    const double PI = 3.14159265358979323846;
+    size_t half = m_size / 2;
+    m_twiddles.resize(half / 2);
+    for (size_t i = 0; i < m_twiddles.size(); ++i) {
+        double angle = -2.0 * PI * i / half;
+        m_twiddles[i] = complex<float>(static_cast<float>(cos(angle)), static_cast<float>(sin(angle)));
+    }
+    m_unpack.resize(half + 1);
+    for (size_t k = 0; k <= half; ++k) {
+        double angle = -2.0 * PI * k / m_size;
+        m_unpack[k] = complex<float>(static_cast<float>(cos(angle)), static_cast<float>(sin(angle)));
+    }
+
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < half) {
+        ++bits;
+    }
+    m_bitReverse.resize(half);
+    for (size_t i = 0; i < half; ++i) {
+        size_t reversed = 0;
+        for (unsigned b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bitReverse[i] = reversed;
+    }
+
+    m_work.resize(half);
+}
+
+// transforms size() samples into bins() bins
+void RealFFT::forward(const float *in, float *re, float *im) {
+    size_t half = m_size / 2;
+
+    // even samples are the real parts and odd samples the imaginary parts
+    for (size_t i = 0; i < half; ++i) {
+        m_work[m_bitReverse[i]] = complex<float>(in[2 * i], in[2 * i + 1]);
+    }
+    transform(false);
+
+    // X[k] = E[k] + W^k O[k], where E and O are the transforms of the
+    // even and odd samples, taken apart using their conjugate symmetry
+    for (size_t k = 0; k <= half; ++k) {
+        complex<float> z = m_work[k % half];
+        complex<float> zc = conj(m_work[(half - k) % half]);
+        complex<float> even = 0.5f * (z + zc);
+        complex<float> odd = multiply(complex<float>(0.0f, -0.5f), z - zc);
+        complex<float> x = even + multiply(m_unpack[k], odd);
+        re[k] = x.real();
+        im[k] = x.imag();
+    }
+}
+
+// transforms bins() bins back into size() samples
+void RealFFT::inverse(const float *re, const float *im, float *out) {
+    size_t half = m_size / 2;
+
+    // the reverse of forward(), E and O are put back together from
+    // the bins and packed into one complex transform
+    for (size_t k = 0; k < half; ++k) {
+        complex<float> x(re[k], im[k]);
+        complex<float> xc(re[half - k], -im[half - k]);
+        complex<float> even = 0.5f * (x + xc);
+        complex<float> odd = multiply(0.5f * (x - xc), conj(m_unpack[k]));
+        m_work[m_bitReverse[k]] = even + complex<float>(-odd.imag(), odd.real());
+    }
+    transform(true);
+
+    float scale = 1.0f / static_cast<float>(half);
+    for (size_t i = 0; i < half; ++i) {
+        out[2 * i] = m_work[i].real() * scale;
+        out[2 * i + 1] = m_work[i].imag() * scale;
+    }
+}
+
+// an unscaled complex transform of m_work in place, which must
+// already be in bit reversed order
+void RealFFT::transform(bool inverse) {
+    size_t half = m_size / 2;
+    for (size_t span = 1; span < half; span <<= 1) {
+        size_t step = half / (span * 2);
+        for (size_t start = 0; start < half; start += span * 2) {
+            for (size_t j = 0; j < span; ++j) {
+                complex<float> w = inverse ? conj(m_twiddles[j * step]) : m_twiddles[j * step];
+                complex<float> a = m_work[start + j];
+                complex<float> b = multiply(m_work[start + j + span], w);
+                m_work[start + j] = a + b;
+                m_work[start + j + span] = a - b;
+            }
+        }
+    }
+}
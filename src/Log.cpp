@@ -0,0 +1,54 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- Log --
+
+    The log level and the replaceable message handler.
+*/
+
+#include "Log.h"
+
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+atomic<int> g_logLevel{static_cast<int>(LogLevel::Info)};
+
+namespace {
+
+// the handler is shared so a message can be passed to it after the lock
+// is released, a handler that logs would otherwise deadlock
+mutex g_logLock;
+shared_ptr<const LogHandler> g_logHandler;
+
+} // namespace
+
+void setLogHandler(LogHandler handler) {
+    shared_ptr<const LogHandler> replacement;
+    if (handler) {
+        replacement = make_shared<const LogHandler>(move(handler));
+    }
+    lock_guard<mutex> lock(g_logLock);
+    g_logHandler = move(replacement);
+}
+
+void setLogLevel(LogLevel level) {
+    g_logLevel.store(static_cast<int>(level), memory_order_relaxed);
+}
+
+LogLevel logLevel() {
+    return static_cast<LogLevel>(g_logLevel.load(memory_order_relaxed));
+}
+
+// the default handler writes to cout just as the library used to
+void writeLog(LogLevel level, const string &message) {
+    unique_lock<mutex> lock(g_logLock);
+    shared_ptr<const LogHandler> handler = g_logHandler;
+    if (!handler) {
+        cout << message << endl;
+        return;
+    }
+    lock.unlock();
+    (*handler)(level, message);
+}
@@ -0,0 +1,131 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- MappedFile --
+
+    A small RAII wrapper around mmap() used by WaveFile::map().
+*/
+
+#include "MappedFile.h"
+#include "Log.h"
+
+#if SIMPLE_WAVE_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(): m_data{nullptr}, m_size{}, m_writable{}, m_device{}, m_inode{}
+{
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+// maps the whole file, returns true if successful
+bool MappedFile::open(string fileName, MapMode mode) {
+    close();
+
+#if SIMPLE_WAVE_HAS_MMAP
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        logMessage(LogLevel::Error, "Cannot open file: ", fileName);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        logMessage(LogLevel::Error, "Cannot map empty file: ", fileName);
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(info.st_size);
+    int protection = PROT_READ;
+    if (mode == MapMode::CopyOnWrite) {
+        protection |= PROT_WRITE;
+    }
+
+    // the mapping keeps its own reference to the file, so the descriptor can be closed
+    void *address = mmap(nullptr, size, protection, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (address == MAP_FAILED) {
+        logMessage(LogLevel::Error, "Cannot map file: ", fileName);
+        return false;
+    }
+
+    m_data = static_cast<uint8_t *>(address);
+    m_size = size;
+    m_writable = mode == MapMode::CopyOnWrite;
+    m_device = static_cast<uint64_t>(info.st_dev);
+    m_inode = static_cast<uint64_t>(info.st_ino);
+    return true;
+#else
+    (void) mode;
+    logMessage(LogLevel::Error, "Memory mapping is not supported on this system: ", fileName);
+    return false;
+#endif
+}
+
+void MappedFile::close() {
+#if SIMPLE_WAVE_HAS_MMAP
+    if (m_data != nullptr) {
+        munmap(m_data, m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_writable = false;
+    m_device = 0;
+    m_inode = 0;
+}
+
+// true if fileName names the mapped file, through any path or link
+bool MappedFile::isSameFile(const string &fileName) const {
+    if (m_data == nullptr) {
+        return false;
+    }
+#if SIMPLE_WAVE_HAS_MMAP
+    struct stat info;
+    if (stat(fileName.c_str(), &info) != 0) {
+        return false;
+    }
+    return static_cast<uint64_t>(info.st_dev) == m_device && static_cast<uint64_t>(info.st_ino) == m_inode;
+#else
+    (void) fileName;
+    return false;
+#endif
+}
+
+// passes an access hint on to the kernel for a byte range,
+// a length of 0 means until the end of the file
+bool MappedFile::advise(AccessHint hint, size_t offset, size_t length) {
+    if (m_data == nullptr || offset >= m_size) {
+        return false;
+    }
+    if (length == 0 || length > m_size - offset) {
+        length = m_size - offset;
+    }
+
+#if SIMPLE_WAVE_HAS_MMAP
+    int advice = MADV_NORMAL;
+    switch (hint) {
+        case AccessHint::Normal:     advice = MADV_NORMAL;     break;
+        case AccessHint::Sequential: advice = MADV_SEQUENTIAL; break;
+        case AccessHint::Random:     advice = MADV_RANDOM;     break;
+        case AccessHint::WillNeed:   advice = MADV_WILLNEED;   break;
+    }
+
+    // madvise needs a page aligned start address
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t alignedOffset = offset - offset % pageSize;
+    return madvise(m_data + alignedOffset, length + (offset - alignedOffset), advice) == 0;
+#else
+    (void) hint;
+    return false;
+#endif
+}
@@ -0,0 +1,287 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- Mixer --
+
+    Sums tracks with offsets, gains and gain envelopes a block at a
+    time, clamping only the final mix.
+*/
+
+#include "Mixer.h"
+#include "Log.h"
+#include "SampleConversion.h"
+
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// mix[i] += in[i] * gain
+void addScaled(float *mix, const float *in, float gain, size_t n) {
+    size_t i = 0;
+#if defined(__AVX__)
+    const __m256 vGain = _mm256_set1_ps(gain);
+    for (; i + 8 <= n; i += 8) {
+#if defined(__FMA__)
+        __m256 v = _mm256_fmadd_ps(_mm256_loadu_ps(in + i), vGain, _mm256_loadu_ps(mix + i));
+#else
+        __m256 v = _mm256_add_ps(_mm256_loadu_ps(mix + i), _mm256_mul_ps(_mm256_loadu_ps(in + i), vGain));
+#endif
+        _mm256_storeu_ps(mix + i, v);
+    }
+#elif defined(__SSE__)
+    const __m128 vGain = _mm_set1_ps(gain);
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_add_ps(_mm_loadu_ps(mix + i), _mm_mul_ps(_mm_loadu_ps(in + i), vGain));
+        _mm_storeu_ps(mix + i, v);
+    }
+#endif
+    for (; i < n; ++i) {
+        mix[i] += in[i] * gain;
+    }
+}
+
+// the same with a gain that changes by step every frame
+void addRamp(float *mix, const float *in, size_t frames, uint16_t nChannels, float gain, float step) {
+    for (size_t i = 0; i < frames; ++i) {
+        float g = gain + step * static_cast<float>(i);
+        for (uint16_t c = 0; c < nChannels; ++c) {
+            mix[i * nChannels + c] += in[i * nChannels + c] * g;
+        }
+    }
+}
+
+// out[i] = in[i] clamped between 1 and -1
+void saturate(const float *in, float *out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX__)
+    const __m256 vLo = _mm256_set1_ps(-1.0f);
+    const __m256 vHi = _mm256_set1_ps(1.0f);
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i), vLo), vHi));
+    }
+#elif defined(__SSE__)
+    const __m128 vLo = _mm_set1_ps(-1.0f);
+    const __m128 vHi = _mm_set1_ps(1.0f);
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), vLo), vHi));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = min(max(in[i], -1.0f), 1.0f);
+    }
+}
+
+} // namespace
+
+Mixer::Mixer(uint32_t sampleRate, uint16_t nChannels, uint32_t blockFrames):
+    m_tracks{}, m_mix{}, m_input{}, m_blockFrames(max(blockFrames, 1u)), m_position{}, m_length{},
+    m_sampleRate(sampleRate), m_nChannels(max<uint16_t>(nChannels, 1))
+{
+    m_mix.resize(static_cast<size_t>(m_blockFrames) * m_nChannels);
+    m_input.resize(m_mix.size());
+}
+
+// adds a view as a track, returns true if successful
+bool Mixer::addTrack(const WaveView &view, uint64_t offset, float gain) {
+    Track track{};
+    track.view = view;
+    track.offset = offset;
+    track.length = view.length();
+    track.nChannels = view.nChannels();
+    track.gain = gain;
+    track.isUnsigned = view.bitDepth() == 8;
+    return add(move(track), view.sampleRate());
+}
+
+// adds a file as a track, which is streamed while mixing
+// returns true if successful
+bool Mixer::addTrack(string fileName, uint64_t offset, float gain) {
+    unique_ptr<WaveStreamReader> stream(new WaveStreamReader(m_blockFrames));
+    if (!stream->open(fileName)) {
+        return false;
+    }
+
+    Track track{};
+    track.offset = offset;
+    track.length = stream->length();
+    track.nChannels = stream->nChannels();
+    track.gain = gain;
+    track.isUnsigned = stream->bitDepth() == 8;
+    uint32_t sampleRate = stream->sampleRate();
+    track.stream = move(stream);
+    return add(move(track), sampleRate);
+}
+
+// checks the format of a new track and adds it
+bool Mixer::add(Track track, uint32_t sampleRate) {
+    if (sampleRate != m_sampleRate) {
+        logMessage(LogLevel::Error, "Track sample rate does not match the mix");
+        return false;
+    }
+    if (track.nChannels != m_nChannels && track.nChannels != 1) {
+        logMessage(LogLevel::Error, "Track channel count does not match the mix");
+        return false;
+    }
+
+    m_length = max(m_length, track.offset + track.length);
+    m_tracks.push_back(move(track));
+    return true;
+}
+
+// adds a point to the gain envelope of a track, returns true if successful
+bool Mixer::addGainPoint(size_t track, uint64_t frame, float gain) {
+    if (track >= m_tracks.size()) {
+        logMessage(LogLevel::Error, "Invalid track: ", track);
+        return false;
+    }
+
+    vector<GainPoint> &envelope = m_tracks[track].envelope;
+    auto after = upper_bound(envelope.begin(), envelope.end(), frame,
+                             [](uint64_t f, const GainPoint &point) { return f < point.frame; });
+    envelope.insert(after, GainPoint{frame, gain});
+    return true;
+}
+
+// mixes the next frames frames into out, returns the number of frames mixed
+uint32_t Mixer::process(float *out, uint32_t frames) {
+    frames = static_cast<uint32_t>(min<uint64_t>(frames, m_length - min(m_position, m_length)));
+
+    uint32_t done = 0;
+    while (done < frames) {
+        size_t count = min(frames - done, m_blockFrames);
+        uint64_t start = m_position + done;
+        fill(m_mix.begin(), m_mix.begin() + count * m_nChannels, 0.0f);
+
+        for (Track &track : m_tracks) {
+            // the part of the block the track plays in
+            uint64_t first = max(start, track.offset);
+            uint64_t last = min(start + count, track.offset + track.length);
+            if (first < last) {
+                mixTrack(track, first, static_cast<size_t>(last - first),
+                         static_cast<size_t>(first - start) * m_nChannels);
+            }
+        }
+
+        saturate(m_mix.data(), out + static_cast<size_t>(done) * m_nChannels, count * m_nChannels);
+        done += static_cast<uint32_t>(count);
+    }
+
+    m_position += frames;
+    return frames;
+}
+
+// adds frames frames of a track from frame start of the mix to m_mix at mixIndex
+void Mixer::mixTrack(Track &track, uint64_t start, size_t frames, size_t mixIndex) {
+    uint64_t trackStart = start - track.offset;
+    size_t count;
+    if (track.stream) {
+        if (track.stream->position() != trackStart && !track.stream->seek(trackStart)) {
+            return;
+        }
+        count = track.stream->read(m_input.data(), static_cast<uint32_t>(frames));
+    } else {
+        count = track.view.getSamples(trackStart, static_cast<uint32_t>(frames), m_input.data());
+    }
+    if (track.isUnsigned) {
+        unsignedToSigned(m_input.data(), count * track.nChannels);
+    }
+
+    // a mono track is sent to every channel, spread out from the end
+    // so the samples are not overwritten before they are copied
+    if (track.nChannels == 1 && m_nChannels > 1) {
+        for (size_t i = count; i-- > 0;) {
+            fill_n(m_input.begin() + i * m_nChannels, m_nChannels, m_input[i]);
+        }
+    }
+
+    // the envelope is a straight line between its points, so the block is
+    // split at each point and mixed in pieces with a fixed or ramped gain
+    float *mix = m_mix.data() + mixIndex;
+    const float *in = m_input.data();
+    size_t done = 0;
+    auto next = upper_bound(track.envelope.begin(), track.envelope.end(), start,
+                            [](uint64_t f, const GainPoint &point) { return f < point.frame; });
+    while (done < count) {
+        size_t pieceFrames = count - done;
+        if (next != track.envelope.end()) {
+            pieceFrames = min<size_t>(pieceFrames, next->frame - (start + done));
+            ++next;
+        }
+
+        float gain = track.gain * envelopeAt(track, start + done);
+        float endGain = track.gain * envelopeAt(track, start + done + pieceFrames);
+        size_t offset = done * m_nChannels;
+        if (gain == endGain) {
+            addScaled(mix + offset, in + offset, gain, pieceFrames * m_nChannels);
+        } else {
+            addRamp(mix + offset, in + offset, pieceFrames, m_nChannels, gain,
+                    (endGain - gain) / static_cast<float>(pieceFrames));
+        }
+        done += pieceFrames;
+    }
+}
+
+// the envelope of a track at a frame of the mix
+float Mixer::envelopeAt(const Track &track, uint64_t frame) {
+    const vector<GainPoint> &envelope = track.envelope;
+    if (envelope.empty()) {
+        return 1.0f;
+    }
+    if (frame <= envelope.front().frame) {
+        return envelope.front().gain;
+    }
+    if (frame >= envelope.back().frame) {
+        return envelope.back().gain;
+    }
+
+    auto after = upper_bound(envelope.begin(), envelope.end(), frame,
+                             [](uint64_t f, const GainPoint &point) { return f < point.frame; });
+    const GainPoint &before = *(after - 1);
+    double t = static_cast<double>(frame - before.frame) / static_cast<double>(after->frame - before.frame);
+    return static_cast<float>(before.gain + (after->gain - before.gain) * t);
+}
+
+// moves to a frame of the mix, returns true if successful
+bool Mixer::seek(uint64_t frame) {
+    if (frame > m_length) {
+        logMessage(LogLevel::Error, "Invalid position: ", frame);
+        return false;
+    }
+    m_position = frame;
+    return true;
+}
+
+// mixes everything from the start to a new wave file
+// returns true if successful
+bool Mixer::render(string outFileName, uint16_t bitDepth, SampleFormat sampleFormat) {
+    WaveStreamWriter writer(m_blockFrames);
+    if (!writer.open(outFileName, m_sampleRate, m_nChannels, bitDepth, sampleFormat)) {
+        return false;
+    }
+
+    seek(0);
+    vector<float> block(static_cast<size_t>(m_blockFrames) * m_nChannels);
+    bool toUnsigned = bitDepth == 8;
+    uint32_t frames;
+    while ((frames = process(block.data(), m_blockFrames)) > 0) {
+        if (toUnsigned) {
+            signedToUnsigned(block.data(), static_cast<size_t>(frames) * m_nChannels);
+        }
+        if (writer.write(block.data(), frames) < frames) {
+            logMessage(LogLevel::Error, "Error writing file: ", outFileName);
+            writer.close();
+            return false;
+        }
+    }
+
+    return writer.close();
+}
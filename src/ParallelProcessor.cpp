@@ -0,0 +1,142 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- ParallelProcessor --
+
+    Runs block kernels over a WaveFile on a ThreadPool.
+*/
+
+#include "ParallelProcessor.h"
+#include "SampleConversion.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+// 8-bit samples are unsigned and read as 0 to 1, kernels see every
+// block as -1 to 1, so these move the samples there and back
+bool isUnsigned(const WaveFile &wave) {
+    return wave.bitDepth() == 8 && wave.sampleFormat() == SampleFormat::PCM;
+}
+
+void centerBlock(AudioBuffer &block) {
+    for (uint16_t c = 0; c < block.nChannels(); ++c) {
+        unsignedToSigned(block.channel(c), block.length());
+    }
+}
+
+void uncenterBlock(AudioBuffer &block) {
+    for (uint16_t c = 0; c < block.nChannels(); ++c) {
+        signedToUnsigned(block.channel(c), block.length());
+    }
+}
+
+} // namespace
+
+ParallelProcessor::ParallelProcessor(ThreadPool &pool, size_t blockFrames):
+    m_pool(pool), m_blockFrames(max<size_t>(blockFrames, 1))
+{
+}
+
+bool ParallelProcessor::process(WaveFile &wave, const Kernel &kernel) {
+    return run(wave, &wave, [&](unsigned, AudioBuffer &block, uint64_t start) {
+        kernel(block, start);
+    });
+}
+
+bool ParallelProcessor::analyze(const WaveFile &wave, const ReadKernel &kernel) const {
+    return run(wave, nullptr, [&](unsigned, AudioBuffer &block, uint64_t start) {
+        kernel(block, start);
+    });
+}
+
+bool ParallelProcessor::gain(WaveFile &wave, float gain) {
+    return process(wave, [gain](AudioBuffer &block, uint64_t) {
+        for (uint16_t c = 0; c < block.nChannels(); ++c) {
+            float *samples = block.channel(c);
+            for (size_t i = 0; i < block.length(); ++i) {
+                samples[i] *= gain;
+            }
+        }
+    });
+}
+
+bool ParallelProcessor::invert(WaveFile &wave) {
+    return gain(wave, -1.0f);
+}
+
+bool ParallelProcessor::normalize(WaveFile &wave, float level) {
+    float largest = peak(wave);
+    if (largest == 0.0f) {
+        return true;
+    }
+    return gain(wave, level / largest);
+}
+
+float ParallelProcessor::peak(const WaveFile &wave) const {
+    vector<float> peaks = analyze(wave, 0.0f, [](float &largest, const AudioBuffer &block, uint64_t) {
+        for (uint16_t c = 0; c < block.nChannels(); ++c) {
+            const float *samples = block.channel(c);
+            for (size_t i = 0; i < block.length(); ++i) {
+                largest = max(largest, fabs(samples[i]));
+            }
+        }
+    });
+
+    float largest = 0.0f;
+    for (float value : peaks) {
+        largest = max(largest, value);
+    }
+    return largest;
+}
+
+// the conversion itself is left to convertBitDepth(), which works on the
+// packed samples, with exact integer widening and dither when narrowing
+bool ParallelProcessor::convert(const WaveFile &in, WaveFile &out, uint16_t bitDepth,
+                                SampleFormat format) const {
+    out = in;
+    return out.convertBitDepth(bitDepth, format);
+}
+
+bool ParallelProcessor::run(const WaveFile &in, WaveFile *out, const WorkerKernel &kernel) const {
+    // shared samples are copied now, rather than by every block at once
+    if (out != nullptr && !out->detach()) {
+        return false;
+    }
+
+    vector<AudioBuffer> buffers(m_pool.size() + 1);
+    atomic<bool> ok{true};
+    bool fromUnsigned = isUnsigned(in);
+    bool toUnsigned = out != nullptr && isUnsigned(*out);
+
+    m_pool.parallelFor(0, in.length(), m_blockFrames, [&](uint64_t first, uint64_t last) {
+        unsigned worker = m_pool.workerIndex();
+        size_t frames = static_cast<size_t>(last - first);
+
+        // only the last block is shorter, so this rarely reallocates
+        AudioBuffer &block = buffers[worker];
+        if (block.length() != frames || block.nChannels() != in.nChannels()) {
+            block.resize(in.nChannels(), frames);
+        }
+
+        if (in.readBuffer(first, block) != frames) {
+            ok = false;
+            return;
+        }
+        if (fromUnsigned) {
+            centerBlock(block);
+        }
+        kernel(worker, block, first);
+        if (toUnsigned) {
+            uncenterBlock(block);
+        }
+        if (out != nullptr && out->writeBuffer(first, block) != frames) {
+            ok = false;
+        }
+    });
+
+    return ok;
+}
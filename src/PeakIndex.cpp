@@ -0,0 +1,343 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- PeakIndex --
+
+    A mipmapped min/max/RMS overview of a WaveFile, saved next to the
+    file so it only has to be built once.
+*/
+
+#include "PeakIndex.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "ParallelProcessor.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// frames read at a time while building, a multiple of BASE_FRAMES so
+// every block starts on a bucket
+constexpr size_t BUILD_BLOCK_FRAMES = 65536;
+
+const char SIDECAR_MAGIC[4] = {'S', 'W', 'P', 'K'};
+constexpr uint32_t SIDECAR_VERSION = 1;
+
+struct SidecarHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t fileSize;
+    int64_t modifiedTime;
+    uint64_t length;
+    uint32_t baseFrames;
+    uint16_t nChannels;
+    uint16_t nLevels;
+};
+
+// the minimum, maximum and sum of squares of n samples
+void summarize(const float *in, size_t n, float &lo, float &hi, float &sumSquares) {
+    size_t i = 0;
+    float minimum = in[0];
+    float maximum = in[0];
+    float sum = 0;
+#if defined(__AVX__)
+    if (n >= 8) {
+        __m256 vMin = _mm256_loadu_ps(in);
+        __m256 vMax = vMin;
+        __m256 vSum = _mm256_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+            __m256 v = _mm256_loadu_ps(in + i);
+            vMin = _mm256_min_ps(vMin, v);
+            vMax = _mm256_max_ps(vMax, v);
+#if defined(__FMA__)
+            vSum = _mm256_fmadd_ps(v, v, vSum);
+#else
+            vSum = _mm256_add_ps(vSum, _mm256_mul_ps(v, v));
+#endif
+        }
+        __m128 lo4 = _mm_min_ps(_mm256_castps256_ps128(vMin), _mm256_extractf128_ps(vMin, 1));
+        __m128 hi4 = _mm_max_ps(_mm256_castps256_ps128(vMax), _mm256_extractf128_ps(vMax, 1));
+        __m128 sum4 = _mm_add_ps(_mm256_castps256_ps128(vSum), _mm256_extractf128_ps(vSum, 1));
+        lo4 = _mm_min_ps(lo4, _mm_movehl_ps(lo4, lo4));
+        hi4 = _mm_max_ps(hi4, _mm_movehl_ps(hi4, hi4));
+        sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+        minimum = _mm_cvtss_f32(_mm_min_ss(lo4, _mm_shuffle_ps(lo4, lo4, 1)));
+        maximum = _mm_cvtss_f32(_mm_max_ss(hi4, _mm_shuffle_ps(hi4, hi4, 1)));
+        sum = _mm_cvtss_f32(_mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1)));
+    }
+#elif defined(__SSE__)
+    if (n >= 4) {
+        __m128 vMin = _mm_loadu_ps(in);
+        __m128 vMax = vMin;
+        __m128 vSum = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_loadu_ps(in + i);
+            vMin = _mm_min_ps(vMin, v);
+            vMax = _mm_max_ps(vMax, v);
+            vSum = _mm_add_ps(vSum, _mm_mul_ps(v, v));
+        }
+        vMin = _mm_min_ps(vMin, _mm_movehl_ps(vMin, vMin));
+        vMax = _mm_max_ps(vMax, _mm_movehl_ps(vMax, vMax));
+        vSum = _mm_add_ps(vSum, _mm_movehl_ps(vSum, vSum));
+        minimum = _mm_cvtss_f32(_mm_min_ss(vMin, _mm_shuffle_ps(vMin, vMin, 1)));
+        maximum = _mm_cvtss_f32(_mm_max_ss(vMax, _mm_shuffle_ps(vMax, vMax, 1)));
+        sum = _mm_cvtss_f32(_mm_add_ss(vSum, _mm_shuffle_ps(vSum, vSum, 1)));
+    }
+#endif
+    for (; i < n; ++i) {
+        minimum = min(minimum, in[i]);
+        maximum = max(maximum, in[i]);
+        sum += in[i] * in[i];
+    }
+    lo = minimum;
+    hi = maximum;
+    sumSquares = sum;
+}
+
+} // namespace
+
+PeakIndex::PeakIndex():
+    m_levels{}, m_length{}, m_nChannels{}
+{
+}
+
+// scans the samples of a wave file, returns true if successful
+bool PeakIndex::build(const WaveFile &wave, bool parallel) {
+    allocate(wave.length(), wave.nChannels());
+    if (m_levels.empty()) {
+        return wave.length() == 0;
+    }
+
+    // every block fills its own buckets of level 0, so blocks can run in any order
+    vector<Bucket> &base = m_levels[0];
+    auto summarizeBlock = [&](const AudioBuffer &block, uint64_t start) {
+        size_t first = static_cast<size_t>(start / BASE_FRAMES);
+        for (size_t offset = 0, bucket = first; offset < block.length(); offset += BASE_FRAMES, ++bucket) {
+            size_t frames = min<size_t>(BASE_FRAMES, block.length() - offset);
+            for (uint16_t c = 0; c < m_nChannels; ++c) {
+                Bucket &out = base[bucket * m_nChannels + c];
+                summarize(block.channel(c) + offset, frames, out.min, out.max, out.sumSquares);
+            }
+        }
+    };
+
+    bool ok = true;
+    if (parallel) {
+        ParallelProcessor processor(ThreadPool::shared(), BUILD_BLOCK_FRAMES);
+        ok = processor.analyze(wave, summarizeBlock);
+    } else {
+        AudioBuffer block(m_nChannels, BUILD_BLOCK_FRAMES);
+        for (uint64_t start = 0; start < m_length && ok; start += BUILD_BLOCK_FRAMES) {
+            size_t frames = static_cast<size_t>(min<uint64_t>(BUILD_BLOCK_FRAMES, m_length - start));
+            if (block.length() != frames) {
+                block.resize(m_nChannels, frames);
+            }
+            ok = wave.readBuffer(start, block) == frames;
+            if (ok) {
+                summarizeBlock(block, start);
+            }
+        }
+    }
+
+    if (!ok) {
+        m_levels.clear();
+        return false;
+    }
+
+    combineLevels();
+    return true;
+}
+
+// loads the sidecar of the file wave was read from if it is up to date,
+// otherwise builds the index and saves a new sidecar
+bool PeakIndex::open(const WaveFile &wave, bool parallel) {
+    const string &fileName = wave.fileName();
+    if (fileName.empty() || wave.isPartial()) {
+        return build(wave, parallel);
+    }
+
+    error_code error;
+    uint64_t fileSize = filesystem::file_size(fileName, error);
+    int64_t modifiedTime = 0;
+    if (!error) {
+        modifiedTime = static_cast<int64_t>(filesystem::last_write_time(fileName, error).time_since_epoch().count());
+    }
+    if (error) {
+        return build(wave, parallel);
+    }
+
+    string sidecar = sidecarName(fileName);
+    if (load(sidecar, fileSize, modifiedTime) && m_length == wave.length() && m_nChannels == wave.nChannels()) {
+        return true;
+    }
+
+    if (!build(wave, parallel)) {
+        return false;
+    }
+
+    // the index is still usable if the sidecar cannot be written
+    save(sidecar, fileSize, modifiedTime);
+    return true;
+}
+
+// reads a sidecar file, fails unless the wave file it was made for
+// still has the given size and modification time
+bool PeakIndex::load(string sidecarName, uint64_t fileSize, int64_t modifiedTime) {
+    ifstream inFile(sidecarName, ios::binary);
+    if (!inFile) {
+        return false;
+    }
+
+    SidecarHeader header;
+    inFile.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!inFile || memcmp(header.magic, SIDECAR_MAGIC, 4) != 0 || header.version != SIDECAR_VERSION
+            || header.baseFrames != BASE_FRAMES || header.fileSize != fileSize
+            || header.modifiedTime != modifiedTime) {
+        return false;
+    }
+
+    allocate(header.length, header.nChannels);
+    if (m_levels.size() != header.nLevels) {
+        m_levels.clear();
+        return false;
+    }
+
+    for (vector<Bucket> &level : m_levels) {
+        inFile.read(reinterpret_cast<char *>(level.data()), static_cast<streamsize>(level.size() * sizeof(Bucket)));
+    }
+    if (!inFile) {
+        m_levels.clear();
+        return false;
+    }
+
+    return true;
+}
+
+// writes a sidecar file, returns true if successful
+bool PeakIndex::save(string sidecarName, uint64_t fileSize, int64_t modifiedTime) const {
+    ofstream outFile(sidecarName, ios::binary);
+    if (!outFile) {
+        logMessage(LogLevel::Error, "Cannot create file: ", sidecarName);
+        return false;
+    }
+
+    SidecarHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SIDECAR_MAGIC, 4);
+    header.version = SIDECAR_VERSION;
+    header.fileSize = fileSize;
+    header.modifiedTime = modifiedTime;
+    header.length = m_length;
+    header.baseFrames = BASE_FRAMES;
+    header.nChannels = m_nChannels;
+    header.nLevels = static_cast<uint16_t>(m_levels.size());
+
+    outFile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    for (const vector<Bucket> &level : m_levels) {
+        outFile.write(reinterpret_cast<const char *>(level.data()), static_cast<streamsize>(level.size() * sizeof(Bucket)));
+    }
+    return static_cast<bool>(outFile);
+}
+
+// fills out with one value per pixel for frames start to end of a channel
+bool PeakIndex::query(uint16_t channel, uint64_t start, uint64_t end, size_t pixels,
+                      vector<PeakValue> &out) const {
+    if (m_levels.empty() || channel >= m_nChannels || start >= end || end > m_length || pixels == 0) {
+        return false;
+    }
+
+    // the coarsest level whose buckets still fit in a pixel
+    uint64_t range = end - start;
+    uint64_t pixelFrames = range / pixels;
+    size_t level = 0;
+    while (level + 1 < m_levels.size() && (static_cast<uint64_t>(BASE_FRAMES) << (level + 1)) <= pixelFrames) {
+        ++level;
+    }
+
+    const vector<Bucket> &buckets = m_levels[level];
+    const uint64_t size = static_cast<uint64_t>(BASE_FRAMES) << level;
+    out.resize(pixels);
+
+    for (size_t p = 0; p < pixels; ++p) {
+        uint64_t first = start + range * p / pixels;
+        uint64_t last = max(start + range * (p + 1) / pixels, first + 1);
+
+        size_t bucket = static_cast<size_t>(first / size);
+        size_t lastBucket = static_cast<size_t>((last - 1) / size);
+        const Bucket &b = buckets[bucket * m_nChannels + channel];
+        float minimum = b.min;
+        float maximum = b.max;
+        double sumSquares = 0;
+        uint64_t frames = 0;
+        for (; bucket <= lastBucket; ++bucket) {
+            const Bucket &next = buckets[bucket * m_nChannels + channel];
+            minimum = min(minimum, next.min);
+            maximum = max(maximum, next.max);
+            sumSquares += next.sumSquares;
+            frames += bucketFrames(level, bucket);
+        }
+        out[p] = {minimum, maximum, static_cast<float>(sqrt(sumSquares / frames))};
+    }
+    return true;
+}
+
+// the name of the sidecar kept for a wave file
+string PeakIndex::sidecarName(const string &fileName) {
+    return fileName + ".peaks";
+}
+
+// sizes the levels for a file, each level has half the buckets of the one below
+void PeakIndex::allocate(uint64_t length, uint16_t nChannels) {
+    m_levels.clear();
+    m_length = length;
+    m_nChannels = nChannels;
+    if (length == 0 || nChannels == 0) {
+        return;
+    }
+
+    size_t count = static_cast<size_t>((length + BASE_FRAMES - 1) / BASE_FRAMES);
+    m_levels.emplace_back(count * nChannels);
+    while (count > 1) {
+        count = (count + 1) / 2;
+        m_levels.emplace_back(count * nChannels);
+    }
+}
+
+void PeakIndex::combineLevels() {
+    for (size_t level = 1; level < m_levels.size(); ++level) {
+        const vector<Bucket> &below = m_levels[level - 1];
+        vector<Bucket> &buckets = m_levels[level];
+        size_t belowCount = below.size() / m_nChannels;
+
+        for (size_t bucket = 0; bucket < buckets.size() / m_nChannels; ++bucket) {
+            for (uint16_t c = 0; c < m_nChannels; ++c) {
+                Bucket combined = below[bucket * 2 * m_nChannels + c];
+                if (bucket * 2 + 1 < belowCount) {
+                    const Bucket &next = below[(bucket * 2 + 1) * m_nChannels + c];
+                    combined.min = min(combined.min, next.min);
+                    combined.max = max(combined.max, next.max);
+                    combined.sumSquares += next.sumSquares;
+                }
+                buckets[bucket * m_nChannels + c] = combined;
+            }
+        }
+    }
+}
+
+// the frames covered by a bucket, only the last one of a level is short
+uint64_t PeakIndex::bucketFrames(size_t level, size_t bucket) const {
+    uint64_t size = static_cast<uint64_t>(BASE_FRAMES) << level;
+    return min(size, m_length - bucket * size);
+}
@@ -0,0 +1,37 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SampleBuffer --
+
+    The shared, copy on write storage behind the audio data of a WaveFile.
+*/
+
+#include "SampleBuffer.h"
+
+#include <cstring>
+
+SampleBuffer::SampleBuffer(size_t size):
+    m_data{nullptr}, m_size(size), m_heap(new uint8_t[size]{}), m_mapping{}
+{
+    m_data = m_heap.get();
+}
+
+SampleBuffer::SampleBuffer(unique_ptr<MappedFile> mapping, size_t offset, size_t size):
+    m_data{nullptr}, m_size(size), m_heap{}, m_mapping(move(mapping))
+{
+    m_data = m_mapping->data() + offset;
+}
+
+// returns a private copy of the samples on the heap
+shared_ptr<SampleBuffer> SampleBuffer::clone() const {
+    // left uninitialized as every byte is overwritten
+    shared_ptr<SampleBuffer> copy(new SampleBuffer());
+    copy->m_heap.reset(new uint8_t[m_size]);
+    copy->m_data = copy->m_heap.get();
+    copy->m_size = m_size;
+    if (m_size > 0) {
+        memcpy(copy->m_data, m_data, m_size);
+    }
+    return copy;
+}
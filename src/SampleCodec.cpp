@@ -0,0 +1,55 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SampleCodec --
+
+    The table of specialized kernels for every supported format.
+*/
+
+#include "SampleCodec.h"
+
+namespace {
+
+template <uint16_t BitDepth, SampleFormat Format, uint16_t Channels>
+constexpr CodecTable makeTable() {
+    using Frame = FrameCodec<BitDepth, Format, Channels>;
+    CodecTable table{BitDepth, Format, Channels,
+                     &Frame::readFrame, &Frame::writeFrame,
+                     &Frame::template read<double>, &Frame::template write<double>,
+                     nullptr, nullptr};
+    if constexpr (SampleCodec<BitDepth, Format>::HAS_INTEGERS) {
+        table.readInt = &Frame::template read<int32_t>;
+        table.writeInt = &Frame::template write<int32_t>;
+    }
+    return table;
+}
+
+template <uint16_t BitDepth, SampleFormat Format>
+constexpr CodecTable MONO = makeTable<BitDepth, Format, 1>();
+template <uint16_t BitDepth, SampleFormat Format>
+constexpr CodecTable STEREO = makeTable<BitDepth, Format, 2>();
+template <uint16_t BitDepth, SampleFormat Format>
+constexpr CodecTable MULTI = makeTable<BitDepth, Format, 0>();
+
+const CodecTable* const TABLES[] = {
+    &MONO<8, SampleFormat::PCM>,    &STEREO<8, SampleFormat::PCM>,    &MULTI<8, SampleFormat::PCM>,
+    &MONO<16, SampleFormat::PCM>,   &STEREO<16, SampleFormat::PCM>,   &MULTI<16, SampleFormat::PCM>,
+    &MONO<24, SampleFormat::PCM>,   &STEREO<24, SampleFormat::PCM>,   &MULTI<24, SampleFormat::PCM>,
+    &MONO<32, SampleFormat::PCM>,   &STEREO<32, SampleFormat::PCM>,   &MULTI<32, SampleFormat::PCM>,
+    &MONO<32, SampleFormat::Float>, &STEREO<32, SampleFormat::Float>, &MULTI<32, SampleFormat::Float>,
+    &MONO<64, SampleFormat::Float>, &STEREO<64, SampleFormat::Float>, &MULTI<64, SampleFormat::Float>
+};
+
+} // namespace
+
+// the kernels for a format, or nullptr if it is not supported
+const CodecTable* findCodec(uint16_t bitDepth, SampleFormat format, uint16_t nChannels) {
+    uint16_t channels = nChannels == 1 || nChannels == 2 ? nChannels : 0;
+    for (const CodecTable *table : TABLES) {
+        if (table->bitDepth == bitDepth && table->format == format && table->channels == channels) {
+            return table;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,623 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SampleConversion --
+
+    Block conversion kernels between the packed little endian PCM
+    or float bytes stored in a wave file and interleaved floats.  Each
+    bit depth has a vector loop for the bulk of the block and a scalar
+    loop for the tail, the two produce identical results, NaN included,
+    which is converted as 0.
+*/
+
+#include "SampleConversion.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// samples converted per chunk by the planar conversions, small enough to stay in L1
+constexpr size_t CHUNK_SAMPLES = 2048;
+
+// scale factors, these match the ones used by getSample() and setSample()
+constexpr float SCALE_8 = 255.0f;
+constexpr float SCALE_16 = 32767.0f;
+constexpr float SCALE_32 = 2147483647.0f;
+
+// SCALE_32 rounds up to 2^31 as a float, which no longer fits in an int32_t
+// so the positive side is limited to the largest float below 2^31
+constexpr float MAX_32 = 2147483520.0f;
+
+// NaN is converted as 0, the comparison is false only for NaN
+inline float clampSample(float x) {
+    return !(x == x) ? 0.0f : min(max(x, -1.0f), 1.0f);
+}
+
+inline float clampUnsigned(float x) {
+    return !(x == x) ? 0.0f : min(max(x, 0.0f), 1.0f);
+}
+
+// the vector loops clear NaN lanes the same way before clamping, as
+// min and max would otherwise pass them on to the integer conversion
+#if defined(__AVX2__)
+inline __m256 clampSamples(__m256 x, __m256 lo, __m256 hi) {
+    x = _mm256_and_ps(x, _mm256_cmp_ps(x, x, _CMP_ORD_Q));
+    return _mm256_min_ps(_mm256_max_ps(x, lo), hi);
+}
+#endif
+
+#if defined(__SSE2__)
+inline __m128 clampSamples(__m128 x, __m128 lo, __m128 hi) {
+    x = _mm_and_ps(x, _mm_cmpord_ps(x, x));
+    return _mm_min_ps(_mm_max_ps(x, lo), hi);
+}
+#endif
+
+/* 8-bit */
+
+void read8(const uint8_t *in, float *out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 scale = _mm256_set1_ps(1.0f / SCALE_8);
+    for (; i + 8 <= n; i += 8) {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(in + i));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(f, scale));
+    }
+#elif defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(1.0f / SCALE_8);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+        _mm_storeu_ps(out + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+        _mm_storeu_ps(out + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = in[i] * (1.0f / SCALE_8);
+    }
+}
+
+// 8-bit samples are stored unsigned, so negative values are clamped to zero
+void write8(const float *in, uint8_t *out, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 lo = _mm_setzero_ps();
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(SCALE_8);
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_cvttps_epi32(_mm_mul_ps(clampSamples(_mm_loadu_ps(in + i), lo, hi), scale));
+        __m128i b = _mm_cvttps_epi32(_mm_mul_ps(clampSamples(_mm_loadu_ps(in + i + 4), lo, hi), scale));
+        __m128i c = _mm_cvttps_epi32(_mm_mul_ps(clampSamples(_mm_loadu_ps(in + i + 8), lo, hi), scale));
+        __m128i d = _mm_cvttps_epi32(_mm_mul_ps(clampSamples(_mm_loadu_ps(in + i + 12), lo, hi), scale));
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = static_cast<uint8_t>(static_cast<int32_t>(clampUnsigned(in[i]) * SCALE_8));
+    }
+}
+
+/* 16-bit */
+
+void read16(const uint8_t *in, float *out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 scale = _mm256_set1_ps(1.0f / SCALE_16);
+    for (; i + 8 <= n; i += 8) {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+        __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(words));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(f, scale));
+    }
+#elif defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(1.0f / SCALE_16);
+    for (; i + 8 <= n; i += 8) {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 2));
+        // unpacking a word with itself and shifting back down sign extends it
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(words, words), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+#endif
+    for (; i < n; ++i) {
+        int16_t value = static_cast<int16_t>(in[i * 2] | (in[i * 2 + 1] << 8));
+        out[i] = value * (1.0f / SCALE_16);
+    }
+}
+
+void write16(const float *in, uint8_t *out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(SCALE_16);
+    for (; i + 8 <= n; i += 8) {
+        __m256 f = clampSamples(_mm256_loadu_ps(in + i), lo, hi);
+        __m256i v = _mm256_cvttps_epi32(_mm256_mul_ps(f, scale));
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), packed);
+    }
+#elif defined(__SSE2__)
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(SCALE_16);
+    for (; i + 8 <= n; i += 8) {
+        __m128i a = _mm_cvttps_epi32(_mm_mul_ps(clampSamples(_mm_loadu_ps(in + i), lo, hi), scale));
+        __m128i b = _mm_cvttps_epi32(_mm_mul_ps(clampSamples(_mm_loadu_ps(in + i + 4), lo, hi), scale));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), _mm_packs_epi32(a, b));
+    }
+#endif
+    for (; i < n; ++i) {
+        int16_t value = static_cast<int16_t>(clampSample(in[i]) * SCALE_16);
+        out[i * 2] = value;
+        out[i * 2 + 1] = value >> 8;
+    }
+}
+
+/* 24-bit */
+
+void read24(const uint8_t *in, float *out, size_t n) {
+    size_t i = 0;
+#if defined(__SSSE3__)
+    // moves each 3 byte sample into the top of a 32-bit lane, 0x80 writes a zero byte
+    const __m128i shuffle = _mm_setr_epi8(-128, 0, 1, 2, -128, 3, 4, 5,
+                                          -128, 6, 7, 8, -128, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(1.0f / SCALE_32);
+    // each load reads 16 bytes but only uses 12, so stay clear of the end of the block
+    for (; i + 6 <= n; i += 4) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 3));
+        __m128i v = _mm_shuffle_epi8(bytes, shuffle);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+#endif
+    for (; i < n; ++i) {
+        const uint8_t *p = in + i * 3;
+        int32_t value = static_cast<int32_t>((uint32_t(p[0]) << 8) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 24));
+        out[i] = value * (1.0f / SCALE_32);
+    }
+}
+
+void write24(const float *in, uint8_t *out, size_t n) {
+    size_t i = 0;
+#if defined(__SSSE3__)
+    // gathers the top 3 bytes of each 32-bit lane into the low 12 bytes
+    const __m128i shuffle = _mm_setr_epi8(1, 2, 3, 5, 6, 7, 9, 10,
+                                          11, 13, 14, 15, -128, -128, -128, -128);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(SCALE_32);
+    const __m128 limit = _mm_set1_ps(MAX_32);
+    for (; i + 4 <= n; i += 4) {
+        __m128 f = clampSamples(_mm_loadu_ps(in + i), lo, hi);
+        __m128i v = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(f, scale), limit));
+        __m128i packed = _mm_shuffle_epi8(v, shuffle);
+        uint8_t *p = out + i * 3;
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(p), packed);
+        int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        p[8] = last;
+        p[9] = last >> 8;
+        p[10] = last >> 16;
+        p[11] = last >> 24;
+    }
+#endif
+    for (; i < n; ++i) {
+        int32_t value = static_cast<int32_t>(min(clampSample(in[i]) * SCALE_32, MAX_32));
+        uint8_t *p = out + i * 3;
+        p[0] = value >> 8;
+        p[1] = value >> 16;
+        p[2] = value >> 24;
+    }
+}
+
+/* 32-bit */
+
+void read32(const uint8_t *in, float *out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 scale = _mm256_set1_ps(1.0f / SCALE_32);
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i * 4));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+#elif defined(__SSE2__)
+    const __m128 scale = _mm_set1_ps(1.0f / SCALE_32);
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i * 4));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+#endif
+    for (; i < n; ++i) {
+        const uint8_t *p = in + i * 4;
+        int32_t value = static_cast<int32_t>(uint32_t(p[0]) | (uint32_t(p[1]) << 8)
+            | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24));
+        out[i] = value * (1.0f / SCALE_32);
+    }
+}
+
+void write32(const float *in, uint8_t *out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(SCALE_32);
+    const __m256 limit = _mm256_set1_ps(MAX_32);
+    for (; i + 8 <= n; i += 8) {
+        __m256 f = clampSamples(_mm256_loadu_ps(in + i), lo, hi);
+        __m256i v = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_mul_ps(f, scale), limit));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 4), v);
+    }
+#elif defined(__SSE2__)
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(SCALE_32);
+    const __m128 limit = _mm_set1_ps(MAX_32);
+    for (; i + 4 <= n; i += 4) {
+        __m128 f = clampSamples(_mm_loadu_ps(in + i), lo, hi);
+        __m128i v = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(f, scale), limit));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 4), v);
+    }
+#endif
+    for (; i < n; ++i) {
+        int32_t value = static_cast<int32_t>(min(clampSample(in[i]) * SCALE_32, MAX_32));
+        uint8_t *p = out + i * 4;
+        p[0] = value;
+        p[1] = value >> 8;
+        p[2] = value >> 16;
+        p[3] = value >> 24;
+    }
+}
+
+/* 64-bit float */
+
+void readDouble(const uint8_t *in, float *out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        __m256d d = _mm256_loadu_pd(reinterpret_cast<const double *>(in + i * 8));
+        _mm_storeu_ps(out + i, _mm256_cvtpd_ps(d));
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= n; i += 4) {
+        __m128 a = _mm_cvtpd_ps(_mm_loadu_pd(reinterpret_cast<const double *>(in + i * 8)));
+        __m128 b = _mm_cvtpd_ps(_mm_loadu_pd(reinterpret_cast<const double *>(in + i * 8 + 16)));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(a, b));
+    }
+#endif
+    for (; i < n; ++i) {
+        double value;
+        memcpy(&value, in + i * 8, sizeof(value));
+        out[i] = static_cast<float>(value);
+    }
+}
+
+void writeDouble(const float *in, uint8_t *out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(reinterpret_cast<double *>(out + i * 8), _mm256_cvtps_pd(_mm_loadu_ps(in + i)));
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= n; i += 4) {
+        __m128 f = _mm_loadu_ps(in + i);
+        _mm_storeu_pd(reinterpret_cast<double *>(out + i * 8), _mm_cvtps_pd(f));
+        _mm_storeu_pd(reinterpret_cast<double *>(out + i * 8 + 16), _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+    }
+#endif
+    for (; i < n; ++i) {
+        double value = in[i];
+        memcpy(out + i * 8, &value, sizeof(value));
+    }
+}
+
+} // namespace
+
+// true if the bit depth can be used with the sample format
+bool isSupportedFormat(SampleFormat format, uint16_t bitDepth) {
+    if (format == SampleFormat::Float) {
+        return bitDepth == 32 || bitDepth == 64;
+    }
+    return bitDepth == 8 || bitDepth == 16 || bitDepth == 24 || bitDepth == 32;
+}
+
+bool pcmToFloat(const uint8_t *in, float *out, size_t n, uint16_t bitDepth, SampleFormat format) {
+    if (format == SampleFormat::Float) {
+        switch (bitDepth) {
+            case 32: memcpy(out, in, n * sizeof(float)); return true;
+            case 64: readDouble(in, out, n); return true;
+            default: return false;
+        }
+    }
+
+    switch (bitDepth) {
+        case 8:  read8(in, out, n);  return true;
+        case 16: read16(in, out, n); return true;
+        case 24: read24(in, out, n); return true;
+        case 32: read32(in, out, n); return true;
+        default: return false;
+    }
+}
+
+bool floatToPcm(const float *in, uint8_t *out, size_t n, uint16_t bitDepth, SampleFormat format) {
+    if (format == SampleFormat::Float) {
+        switch (bitDepth) {
+            case 32: memcpy(out, in, n * sizeof(float)); return true;
+            case 64: writeDouble(in, out, n); return true;
+            default: return false;
+        }
+    }
+
+    switch (bitDepth) {
+        case 8:  write8(in, out, n);  return true;
+        case 16: write16(in, out, n); return true;
+        case 24: write24(in, out, n); return true;
+        case 32: write32(in, out, n); return true;
+        default: return false;
+    }
+}
+
+// splits interleaved floats into nChannels separate arrays
+void deinterleave(const float *in, float *const *out, size_t frames, uint16_t nChannels) {
+    if (nChannels == 1) {
+        memcpy(out[0], in, frames * sizeof(float));
+        return;
+    }
+
+    size_t i = 0;
+    if (nChannels == 2) {
+        float *left = out[0];
+        float *right = out[1];
+#if defined(__SSE2__)
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(in + i * 2);
+            __m128 b = _mm_loadu_ps(in + i * 2 + 4);
+            _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        }
+#endif
+        for (; i < frames; ++i) {
+            left[i] = in[i * 2];
+            right[i] = in[i * 2 + 1];
+        }
+        return;
+    }
+
+    for (uint16_t c = 0; c < nChannels; ++c) {
+        float *channel = out[c];
+        const float *sample = in + c;
+        for (i = 0; i < frames; ++i) {
+            channel[i] = sample[i * nChannels];
+        }
+    }
+}
+
+// joins nChannels separate arrays into interleaved floats
+void interleave(const float *const *in, float *out, size_t frames, uint16_t nChannels) {
+    if (nChannels == 1) {
+        memcpy(out, in[0], frames * sizeof(float));
+        return;
+    }
+
+    size_t i = 0;
+    if (nChannels == 2) {
+        const float *left = in[0];
+        const float *right = in[1];
+#if defined(__SSE2__)
+        for (; i + 4 <= frames; i += 4) {
+            __m128 l = _mm_loadu_ps(left + i);
+            __m128 r = _mm_loadu_ps(right + i);
+            _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+        }
+#endif
+        for (; i < frames; ++i) {
+            out[i * 2] = left[i];
+            out[i * 2 + 1] = right[i];
+        }
+        return;
+    }
+
+    for (uint16_t c = 0; c < nChannels; ++c) {
+        const float *channel = in[c];
+        float *sample = out + c;
+        for (i = 0; i < frames; ++i) {
+            sample[i * nChannels] = channel[i];
+        }
+    }
+}
+
+// converts packed PCM straight to separate channel arrays, a chunk at a time
+bool pcmToPlanar(const uint8_t *in, float *const *out, size_t frames, uint16_t nChannels,
+                 uint16_t bitDepth, SampleFormat format) {
+    if (nChannels == 0) {
+        return false;
+    }
+
+    float scratch[CHUNK_SAMPLES];
+    vector<float> wideScratch(nChannels > CHUNK_SAMPLES ? nChannels : 0);
+    float *interleaved = wideScratch.empty() ? scratch : wideScratch.data();
+    size_t chunkFrames = max<size_t>(CHUNK_SAMPLES / nChannels, 1);
+
+    vector<float *> channels(out, out + nChannels);
+    size_t frameBytes = static_cast<size_t>(nChannels) * (bitDepth / 8);
+
+    for (size_t done = 0; done < frames; done += chunkFrames) {
+        size_t count = min(chunkFrames, frames - done);
+        if (!pcmToFloat(in + done * frameBytes, interleaved, count * nChannels, bitDepth, format)) {
+            return false;
+        }
+        deinterleave(interleaved, channels.data(), count, nChannels);
+        for (float *&channel : channels) {
+            channel += count;
+        }
+    }
+    return true;
+}
+
+// converts separate channel arrays straight to packed PCM, a chunk at a time
+bool planarToPcm(const float *const *in, uint8_t *out, size_t frames, uint16_t nChannels,
+                 uint16_t bitDepth, SampleFormat format) {
+    if (nChannels == 0) {
+        return false;
+    }
+
+    float scratch[CHUNK_SAMPLES];
+    vector<float> wideScratch(nChannels > CHUNK_SAMPLES ? nChannels : 0);
+    float *interleaved = wideScratch.empty() ? scratch : wideScratch.data();
+    size_t chunkFrames = max<size_t>(CHUNK_SAMPLES / nChannels, 1);
+
+    vector<const float *> channels(in, in + nChannels);
+    size_t frameBytes = static_cast<size_t>(nChannels) * (bitDepth / 8);
+
+    for (size_t done = 0; done < frames; done += chunkFrames) {
+        size_t count = min(chunkFrames, frames - done);
+        interleave(channels.data(), interleaved, count, nChannels);
+        if (!floatToPcm(interleaved, out + done * frameBytes, count * nChannels, bitDepth, format)) {
+            return false;
+        }
+        for (const float *&channel : channels) {
+            channel += count;
+        }
+    }
+    return true;
+}
+
+// Clipping is rare, so the largest magnitude of the block is found first,
+// which takes one max per vector, and only when it is past full scale are
+// the values counted.  A lane that is past it compares as all ones, -1,
+// so subtracting the comparison counts the lane.
+size_t countClipped(const float *in, size_t n) {
+    size_t count = 0;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 peakA = _mm256_setzero_ps();
+    __m256 peakB = _mm256_setzero_ps();
+    for (; i + 16 <= n; i += 16) {
+        peakA = _mm256_max_ps(peakA, _mm256_andnot_ps(sign, _mm256_loadu_ps(in + i)));
+        peakB = _mm256_max_ps(peakB, _mm256_andnot_ps(sign, _mm256_loadu_ps(in + i + 8)));
+    }
+    if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_max_ps(peakA, peakB), one, _CMP_GT_OQ)) != 0) {
+        __m256i lanes = _mm256_setzero_si256();
+        for (size_t j = 0; j < i; j += 8) {
+            __m256 magnitude = _mm256_andnot_ps(sign, _mm256_loadu_ps(in + j));
+            lanes = _mm256_sub_epi32(lanes, _mm256_castps_si256(_mm256_cmp_ps(magnitude, one, _CMP_GT_OQ)));
+        }
+        alignas(32) uint32_t counts[8];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(counts), lanes);
+        for (uint32_t lane : counts) {
+            count += lane;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 peakA = _mm_setzero_ps();
+    __m128 peakB = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        peakA = _mm_max_ps(peakA, _mm_andnot_ps(sign, _mm_loadu_ps(in + i)));
+        peakB = _mm_max_ps(peakB, _mm_andnot_ps(sign, _mm_loadu_ps(in + i + 4)));
+    }
+    if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_max_ps(peakA, peakB), one)) != 0) {
+        __m128i lanes = _mm_setzero_si128();
+        for (size_t j = 0; j < i; j += 4) {
+            __m128 magnitude = _mm_andnot_ps(sign, _mm_loadu_ps(in + j));
+            lanes = _mm_sub_epi32(lanes, _mm_castps_si128(_mm_cmpgt_ps(magnitude, one)));
+        }
+        alignas(16) uint32_t counts[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(counts), lanes);
+        for (uint32_t lane : counts) {
+            count += lane;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        count += in[i] > 1.0f || in[i] < -1.0f;
+    }
+    return count;
+}
+
+size_t countClipped(const double *in, size_t n) {
+    size_t count = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128d sign = _mm_set1_pd(-0.0);
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128i lanes = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+        __m128d magnitude = _mm_andnot_pd(sign, _mm_loadu_pd(in + i));
+        lanes = _mm_sub_epi64(lanes, _mm_castpd_si128(_mm_cmpgt_pd(magnitude, one)));
+    }
+    alignas(16) uint64_t counts[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(counts), lanes);
+    count = static_cast<size_t>(counts[0] + counts[1]);
+#endif
+    for (; i < n; ++i) {
+        count += in[i] > 1.0 || in[i] < -1.0;
+    }
+    return count;
+}
+
+// 128 is silence, so 0 to 255 become -1 to 127 / 128, the center is
+// worked out the way each format reads 128 and subtracted before scaling,
+// so silence becomes exactly 0 even when multiply and add are fused
+template <typename T>
+void centerUnsigned(T *samples, size_t n, T center, T scale) {
+    for (size_t i = 0; i < n; ++i) {
+        samples[i] = (samples[i] - center) * scale;
+    }
+}
+
+template <typename T>
+void uncenterUnsigned(T *samples, size_t n, T center, T scale) {
+    for (size_t i = 0; i < n; ++i) {
+        samples[i] = samples[i] * scale + center;
+    }
+}
+
+void unsignedToSigned(float *samples, size_t n) {
+    centerUnsigned(samples, n, 128.0f * (1.0f / SCALE_8), SCALE_8 / 128.0f);
+}
+
+void unsignedToSigned(double *samples, size_t n) {
+    centerUnsigned(samples, n, 128.0 / 255.0, 255.0 / 128.0);
+}
+
+void signedToUnsigned(float *samples, size_t n) {
+    uncenterUnsigned(samples, n, 128.0f * (1.0f / SCALE_8), 128.0f / SCALE_8);
+}
+
+void signedToUnsigned(double *samples, size_t n) {
+    uncenterUnsigned(samples, n, 128.0 / 255.0, 128.0 / 255.0);
+}
+
+const char* conversionKernelName() {
+#if defined(__AVX2__)
+    return "avx2";
+#elif defined(__SSSE3__)
+    return "ssse3";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
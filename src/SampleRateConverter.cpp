@@ -0,0 +1,328 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SampleRateConverter --
+
+    Polyphase windowed sinc sample rate conversion.  The filters use a
+    Kaiser window, and each one is scaled to a gain of exactly one so
+    a constant input stays constant whatever the output position.
+*/
+
+#include "SampleRateConverter.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const double PI = 3.141592653589793238463;
+
+// frames read from a wave file at a time by convert()
+constexpr size_t BLOCK_FRAMES = 16384;
+
+// the filter length is kept to a whole number of vectors
+constexpr size_t TAP_MULTIPLE = 8;
+
+struct QualityPreset {
+    size_t halfTaps;    // taps either side of the centre before downsampling
+    double beta;        // Kaiser window shape, higher gives more stopband attenuation
+    double cutoff;      // passband edge as a fraction of the lower Nyquist frequency
+};
+
+QualityPreset qualityPreset(ResampleQuality quality) {
+    switch (quality) {
+        case ResampleQuality::Fast:
+            return {8, 5.0, 0.88};
+        case ResampleQuality::High:
+            return {32, 9.0, 0.95};
+        case ResampleQuality::Best:
+            return {64, 11.0, 0.97};
+        case ResampleQuality::Standard:
+        default:
+            return {16, 7.0, 0.92};
+    }
+}
+
+// zeroth order modified Bessel function of the first kind
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+double sinc(double x) {
+    return x == 0.0 ? 1.0 : sin(PI * x) / (PI * x);
+}
+
+float dotProduct(const float *a, const float *b, size_t n) {
+    size_t i = 0;
+    float sum = 0;
+#if defined(__AVX__)
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= n; i += 16) {
+#if defined(__FMA__)
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+#else
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+#endif
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+    sum = _mm_cvtss_f32(half);
+#elif defined(__SSE__)
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    sum = _mm_cvtss_f32(acc);
+#endif
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+} // namespace
+
+SampleRateConverter::SampleRateConverter():
+    m_inRate{}, m_outRate{}, m_nChannels{}, m_up{1}, m_down{1},
+    m_filters{}, m_taps{}, m_nPhases{}, m_interpolate{false},
+    m_history{}, m_historyStart{}, m_inputFrames{}, m_outputFrames{}
+{
+}
+
+// prepares the filter bank, returns false for an invalid rate or channel count
+bool SampleRateConverter::setup(uint32_t inRate, uint32_t outRate, uint16_t nChannels,
+                                ResampleQuality quality) {
+    if (inRate == 0 || outRate == 0 || nChannels == 0) {
+        logMessage(LogLevel::Error, "Invalid sample rate conversion: ", inRate, "Hz to ", outRate, "Hz");
+        return false;
+    }
+
+    m_inRate = inRate;
+    m_outRate = outRate;
+    m_nChannels = nChannels;
+
+    uint64_t divisor = gcd(inRate, outRate);
+    m_up = outRate / divisor;
+    m_down = inRate / divisor;
+
+    // when downsampling the cutoff moves down to the output Nyquist
+    // frequency and the filter gets longer by the same factor
+    QualityPreset preset = qualityPreset(quality);
+    double factor = max(1.0, static_cast<double>(m_down) / m_up);
+    double cutoff = preset.cutoff / factor;
+    size_t halfTaps = static_cast<size_t>(ceil(preset.halfTaps * factor));
+    halfTaps = (halfTaps + TAP_MULTIPLE / 2 - 1) / (TAP_MULTIPLE / 2) * (TAP_MULTIPLE / 2);
+    m_taps = halfTaps * 2;
+
+    m_interpolate = m_up > MAX_PHASES;
+    m_nPhases = m_interpolate ? MAX_PHASES : static_cast<size_t>(m_up);
+    size_t nFilters = m_interpolate ? m_nPhases + 1 : m_nPhases;
+
+    // filter p is used for output samples that fall p / m_nPhases of the
+    // way between two input samples, tap k is for input sample k - half + 1
+    m_filters.assign(nFilters * m_taps, 0.0f);
+    double windowScale = 1.0 / besselI0(preset.beta);
+    for (size_t p = 0; p < nFilters; ++p) {
+        double fraction = static_cast<double>(p) / m_nPhases;
+        float *filter = &m_filters[p * m_taps];
+
+        double sum = 0;
+        for (size_t k = 0; k < m_taps; ++k) {
+            double x = static_cast<double>(k) - halfTaps + 1 - fraction;
+            double position = x / halfTaps;
+            double window = abs(position) >= 1.0 ? 0.0
+                          : besselI0(preset.beta * sqrt(1.0 - position * position)) * windowScale;
+            double value = cutoff * sinc(cutoff * x) * window;
+            filter[k] = static_cast<float>(value);
+            sum += value;
+        }
+        for (size_t k = 0; k < m_taps; ++k) {
+            filter[k] = static_cast<float>(filter[k] / sum);
+        }
+    }
+
+    reset();
+    return true;
+}
+
+// forgets all input, ready to start a new stream
+void SampleRateConverter::reset() {
+    // the first output sample needs input from before the start, which is silent
+    size_t lead = m_taps > 0 ? m_taps / 2 - 1 : 0;
+    m_history.assign(m_nChannels, vector<float>(lead, 0.0f));
+    m_historyStart = -static_cast<int64_t>(lead);
+    m_inputFrames = 0;
+    m_outputFrames = 0;
+}
+
+size_t SampleRateConverter::process(const AudioBuffer &in, size_t frames, AudioBuffer &out) {
+    if (in.nChannels() != m_nChannels) {
+        logMessage(LogLevel::Error, "Channel count mismatch");
+        return 0;
+    }
+    frames = min(frames, in.length());
+
+    for (uint16_t c = 0; c < m_nChannels; ++c) {
+        m_history[c].insert(m_history[c].end(), in.channel(c), in.channel(c) + frames);
+    }
+    m_inputFrames += frames;
+
+    if (out.nChannels() != m_nChannels || out.length() < maxOutput(frames)) {
+        out.resize(m_nChannels, maxOutput(frames));
+    }
+    return produce(out, numeric_limits<uint64_t>::max());
+}
+
+size_t SampleRateConverter::flush(AudioBuffer &out) {
+    if (m_history.empty()) {
+        return 0;
+    }
+
+    // silence after the end lets the last output samples be computed
+    for (uint16_t c = 0; c < m_nChannels; ++c) {
+        m_history[c].insert(m_history[c].end(), m_taps, 0.0f);
+    }
+
+    if (out.nChannels() != m_nChannels || out.length() < maxOutput(0)) {
+        out.resize(m_nChannels, maxOutput(0));
+    }
+    return produce(out, outputLength(m_inputFrames));
+}
+
+uint64_t SampleRateConverter::outputLength(uint64_t inFrames) const {
+    return (inFrames * m_up + m_down - 1) / m_down;
+}
+
+size_t SampleRateConverter::maxOutput(size_t frames) const {
+    return static_cast<size_t>((frames + m_taps) * m_up / m_down + 1);
+}
+
+size_t SampleRateConverter::produce(AudioBuffer &out, uint64_t outputLimit) {
+    if (m_history.empty()) {
+        return 0;
+    }
+
+    const int64_t half = static_cast<int64_t>(m_taps / 2);
+    const int64_t historyEnd = m_historyStart + static_cast<int64_t>(m_history[0].size());
+    size_t produced = 0;
+
+    while (produced < out.length() && m_outputFrames < outputLimit) {
+        // the output sample falls phase / m_up of the way after input sample index
+        uint64_t position = m_outputFrames * m_down;
+        int64_t index = static_cast<int64_t>(position / m_up);
+        uint64_t phase = position % m_up;
+
+        int64_t first = index - half + 1;
+        if (first + static_cast<int64_t>(m_taps) > historyEnd) {
+            break;
+        }
+        size_t offset = static_cast<size_t>(first - m_historyStart);
+
+        if (m_interpolate) {
+            double exact = static_cast<double>(phase) * m_nPhases / m_up;
+            size_t row = static_cast<size_t>(exact);
+            float weight = static_cast<float>(exact - row);
+            const float *lower = &m_filters[row * m_taps];
+            const float *upper = lower + m_taps;
+            for (uint16_t c = 0; c < m_nChannels; ++c) {
+                const float *input = m_history[c].data() + offset;
+                float a = dotProduct(lower, input, m_taps);
+                float b = dotProduct(upper, input, m_taps);
+                out.channel(c)[produced] = a + weight * (b - a);
+            }
+        } else {
+            const float *filter = &m_filters[static_cast<size_t>(phase) * m_taps];
+            for (uint16_t c = 0; c < m_nChannels; ++c) {
+                out.channel(c)[produced] = dotProduct(filter, m_history[c].data() + offset, m_taps);
+            }
+        }
+
+        ++produced;
+        ++m_outputFrames;
+    }
+
+    trimHistory();
+    return produced;
+}
+
+void SampleRateConverter::trimHistory() {
+    if (m_history.empty()) {
+        return;
+    }
+    int64_t index = static_cast<int64_t>(m_outputFrames * m_down / m_up);
+    int64_t first = index - static_cast<int64_t>(m_taps / 2) + 1;
+    if (first <= m_historyStart) {
+        return;
+    }
+
+    size_t drop = min(static_cast<size_t>(first - m_historyStart), m_history[0].size());
+    for (vector<float> &history : m_history) {
+        history.erase(history.begin(), history.begin() + static_cast<ptrdiff_t>(drop));
+    }
+    m_historyStart += static_cast<int64_t>(drop);
+}
+
+// converts a whole wave file, a block at a time
+bool SampleRateConverter::convert(const WaveFile &in, WaveFile &out, uint32_t sampleRate,
+                                  ResampleQuality quality) {
+    SampleRateConverter converter;
+    if (!converter.setup(in.sampleRate(), sampleRate, in.nChannels(), quality)) {
+        return false;
+    }
+
+    out = WaveFile(converter.outputLength(in.length()), sampleRate, in.nChannels(),
+                   in.bitDepth(), in.sampleFormat());
+
+    AudioBuffer block(in.nChannels(), BLOCK_FRAMES);
+    AudioBuffer converted;
+    uint64_t written = 0;
+
+    for (uint64_t start = 0; start < in.length(); start += BLOCK_FRAMES) {
+        size_t frames = in.readBuffer(start, block);
+        size_t produced = converter.process(block, frames, converted);
+        if (produced > 0) {
+            written += out.writeBuffer(written, converted, produced);
+        }
+    }
+
+    size_t produced = converter.flush(converted);
+    if (produced > 0) {
+        written += out.writeBuffer(written, converted, produced);
+    }
+
+    return written == out.length();
+}
@@ -0,0 +1,323 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- SignalGenerator --
+
+    Test signals from phase accumulators and a vectorized polynomial
+    sine, and noise from a xorshift generator.
+*/
+
+#include "SignalGenerator.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// samples generated at a time, the phases of a chunk are kept in m_block
+constexpr size_t CHUNK_FRAMES = 1024;
+
+constexpr float TWO_PI = 6.28318530717958647692f;
+
+// the Taylor series of sin() to the x^11 term, accurate to about 6e-8
+// between -pi/2 and pi/2
+constexpr float SIN_3 = -1.0f / 6.0f;
+constexpr float SIN_5 = 1.0f / 120.0f;
+constexpr float SIN_7 = -1.0f / 5040.0f;
+constexpr float SIN_9 = 1.0f / 362880.0f;
+constexpr float SIN_11 = -1.0f / 39916800.0f;
+
+// out[i] = sin(2 pi in[i]) for phases between -0.5 and 0.5 turns, which
+// are first folded to between -0.25 and 0.25 using sin(pi - x) = sin(x)
+void sinTurns(const float *in, float *out, size_t n) {
+    size_t i = 0;
+#if defined(__AVX__)
+    const __m256 vHalf = _mm256_set1_ps(0.5f);
+    const __m256 vMinusHalf = _mm256_set1_ps(-0.5f);
+    const __m256 vTwoPi = _mm256_set1_ps(TWO_PI);
+    for (; i + 8 <= n; i += 8) {
+        __m256 y = _mm256_loadu_ps(in + i);
+        y = _mm256_min_ps(y, _mm256_sub_ps(vHalf, y));
+        y = _mm256_max_ps(y, _mm256_sub_ps(vMinusHalf, y));
+        __m256 x = _mm256_mul_ps(y, vTwoPi);
+        __m256 x2 = _mm256_mul_ps(x, x);
+        __m256 p = _mm256_set1_ps(SIN_11);
+        p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(SIN_9));
+        p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(SIN_7));
+        p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(SIN_5));
+        p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(SIN_3));
+        p = _mm256_add_ps(_mm256_mul_ps(p, x2), _mm256_set1_ps(1.0f));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(p, x));
+    }
+#elif defined(__SSE__)
+    const __m128 vHalf = _mm_set1_ps(0.5f);
+    const __m128 vMinusHalf = _mm_set1_ps(-0.5f);
+    const __m128 vTwoPi = _mm_set1_ps(TWO_PI);
+    for (; i + 4 <= n; i += 4) {
+        __m128 y = _mm_loadu_ps(in + i);
+        y = _mm_min_ps(y, _mm_sub_ps(vHalf, y));
+        y = _mm_max_ps(y, _mm_sub_ps(vMinusHalf, y));
+        __m128 x = _mm_mul_ps(y, vTwoPi);
+        __m128 x2 = _mm_mul_ps(x, x);
+        __m128 p = _mm_set1_ps(SIN_11);
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(SIN_9));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(SIN_7));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(SIN_5));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(SIN_3));
+        p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+        _mm_storeu_ps(out + i, _mm_mul_ps(p, x));
+    }
+#endif
+    for (; i < n; ++i) {
+        float y = min(in[i], 0.5f - in[i]);
+        y = max(y, -0.5f - y);
+        float x = y * TWO_PI;
+        float x2 = x * x;
+        float p = ((((SIN_11 * x2 + SIN_9) * x2 + SIN_7) * x2 + SIN_5) * x2 + SIN_3) * x2 + 1.0f;
+        out[i] = p * x;
+    }
+}
+
+// the correction for a jump of 2 at phase 0, spread over the sample either
+// side of it, t is the phase between 0 and 1 and dt the phase step
+inline float polyBlep(float t, float dt) {
+    if (t < dt) {
+        t /= dt;
+        return t + t - t * t - 1.0f;
+    }
+    if (t > 1.0f - dt) {
+        t = (t - 1.0f) / dt;
+        return t * t + t + t + 1.0f;
+    }
+    return 0.0f;
+}
+
+inline uint32_t xorshift(uint32_t &state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// the filtered noise peaks at about 8 times its input, so this keeps
+// pink noise within the amplitude almost all of the time
+constexpr float PINK_SCALE = 0.125f;
+
+} // namespace
+
+SignalGenerator::SignalGenerator(uint32_t sampleRate, uint32_t seed):
+    m_waveform{Waveform::Sine}, m_sampleRate(max(sampleRate, 1u)), m_amplitude{}, m_phases{}, m_increments{},
+    m_sweepRatio{}, m_sweepScale{}, m_sweepFrames{}, m_position{}, m_seed(seed != 0 ? seed : 1),
+    m_random{}, m_pink{}, m_block(CHUNK_FRAMES)
+{
+    reset();
+}
+
+void SignalGenerator::setSine(double frequency, float amplitude) {
+    setTones(Waveform::Sine, {frequency}, amplitude);
+}
+
+void SignalGenerator::setSquare(double frequency, float amplitude) {
+    setTones(Waveform::Square, {frequency}, amplitude);
+}
+
+void SignalGenerator::setSaw(double frequency, float amplitude) {
+    setTones(Waveform::Saw, {frequency}, amplitude);
+}
+
+void SignalGenerator::setWhiteNoise(float amplitude) {
+    setTones(Waveform::WhiteNoise, {}, amplitude);
+}
+
+void SignalGenerator::setPinkNoise(float amplitude) {
+    setTones(Waveform::PinkNoise, {}, amplitude);
+}
+
+// a sweep from startFrequency to endFrequency, the same time is spent on each octave
+void SignalGenerator::setSweep(double startFrequency, double endFrequency, double seconds, float amplitude) {
+    setTones(Waveform::LogSweep, {}, amplitude);
+    m_sweepFrames = static_cast<uint64_t>(max(seconds, 0.0) * m_sampleRate);
+    if (m_sweepFrames == 0 || startFrequency <= 0 || endFrequency <= 0) {
+        m_sweepFrames = 0;
+        return;
+    }
+
+    m_sweepRatio = pow(endFrequency / startFrequency, 1.0 / static_cast<double>(m_sweepFrames));
+    double increment = startFrequency / m_sampleRate;
+    m_sweepScale = m_sweepRatio != 1.0 ? increment / log(m_sweepRatio) : increment;
+}
+
+// a sum of sines of equal level
+void SignalGenerator::setMultitone(const vector<double> &frequencies, float amplitude) {
+    setTones(Waveform::Multitone, frequencies, amplitude);
+}
+
+// sets up tones at the given frequencies
+void SignalGenerator::setTones(Waveform waveform, const vector<double> &frequencies, float amplitude) {
+    m_waveform = waveform;
+    m_amplitude = amplitude;
+    m_increments.clear();
+    for (double frequency : frequencies) {
+        m_increments.push_back(frequency / m_sampleRate);
+    }
+    m_phases.assign(m_increments.size(), 0.0);
+    m_sweepFrames = 0;
+    reset();
+}
+
+// back to the start of the signal
+void SignalGenerator::reset() {
+    fill_n(m_phases.begin(), m_phases.size(), 0.0);
+    m_position = 0;
+    m_random = m_seed;
+    fill_n(m_pink, 7, 0.0f);
+}
+
+// writes the next frames samples of the signal to out
+void SignalGenerator::generate(float *out, size_t frames) {
+    for (size_t done = 0; done < frames; done += CHUNK_FRAMES) {
+        size_t n = min(CHUNK_FRAMES, frames - done);
+        float *chunk = out + done;
+
+        switch (m_waveform) {
+            case Waveform::Sine:
+                tonePhases(0, m_block.data(), n);
+                sinTurns(m_block.data(), chunk, n);
+                for (size_t i = 0; i < n; ++i) {
+                    chunk[i] *= m_amplitude;
+                }
+                break;
+            case Waveform::Multitone: {
+                fill_n(chunk, n, 0.0f);
+                float level = m_phases.empty() ? 0.0f : m_amplitude / m_phases.size();
+                for (size_t tone = 0; tone < m_phases.size(); ++tone) {
+                    tonePhases(tone, m_block.data(), n);
+                    sinTurns(m_block.data(), m_block.data(), n);
+                    for (size_t i = 0; i < n; ++i) {
+                        chunk[i] += m_block[i] * level;
+                    }
+                }
+                break;
+            }
+            case Waveform::Square:
+            case Waveform::Saw: {
+                float dt = static_cast<float>(min(m_increments[0], 0.5));
+                tonePhases(0, m_block.data(), n);
+                for (size_t i = 0; i < n; ++i) {
+                    float t = m_block[i] + 0.5f;
+                    float value;
+                    if (m_waveform == Waveform::Saw) {
+                        value = 2.0f * t - 1.0f - polyBlep(t, dt);
+                    } else {
+                        float shifted = t < 0.5f ? t + 0.5f : t - 0.5f;
+                        value = (t < 0.5f ? 1.0f : -1.0f) + polyBlep(t, dt) - polyBlep(shifted, dt);
+                    }
+                    chunk[i] = value * m_amplitude;
+                }
+                break;
+            }
+            case Waveform::LogSweep:
+                generateSweep(chunk, n);
+                break;
+            case Waveform::WhiteNoise:
+            case Waveform::PinkNoise:
+                generateNoise(chunk, n);
+                break;
+        }
+        m_position += n;
+    }
+}
+
+// writes the next frames of the signal to every channel of a wave
+// returns true if successful
+bool SignalGenerator::fill(WaveFile &wave, uint64_t start, uint64_t frames) {
+    if (start > wave.length()) {
+        logMessage(LogLevel::Error, "Invalid range: frame ", start, " is past the end of the file");
+        return false;
+    }
+    frames = min(frames, wave.length() - start);
+
+    uint16_t nChannels = wave.nChannels();
+    vector<float> mono(CHUNK_FRAMES);
+    vector<float> frame(CHUNK_FRAMES * nChannels);
+    for (uint64_t done = 0; done < frames; done += CHUNK_FRAMES) {
+        uint32_t n = static_cast<uint32_t>(min<uint64_t>(CHUNK_FRAMES, frames - done));
+        const float *samples = mono.data();
+        generate(mono.data(), n);
+        if (nChannels > 1) {
+            for (uint32_t i = 0; i < n; ++i) {
+                fill_n(frame.begin() + static_cast<size_t>(i) * nChannels, nChannels, mono[i]);
+            }
+            samples = frame.data();
+        }
+        if (wave.setSamples(start + done, n, samples) != n) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the phases of the next n samples of a tone, between -0.5 and 0.5 turns,
+// worked out from the start of the block in double so they do not drift
+void SignalGenerator::tonePhases(size_t tone, float *phases, size_t n) {
+    double phase = m_phases[tone];
+    double increment = m_increments[tone];
+    for (size_t i = 0; i < n; ++i) {
+        double x = phase + static_cast<double>(i) * increment;
+        phases[i] = static_cast<float>(x - floor(x + 0.5));
+    }
+    double next = phase + static_cast<double>(n) * increment;
+    m_phases[tone] = next - floor(next);
+}
+
+void SignalGenerator::generateSweep(float *out, size_t n) {
+    size_t sweeping = static_cast<size_t>(min<uint64_t>(n, m_sweepFrames - min(m_position, m_sweepFrames)));
+
+    // ratio^n is started again from pow() every block, then multiplied
+    // along, so it never drifts far
+    double growth = pow(m_sweepRatio, static_cast<double>(m_position));
+    for (size_t i = 0; i < sweeping; ++i) {
+        double x = m_sweepRatio != 1.0 ? m_sweepScale * (growth - 1.0)
+                                       : m_sweepScale * static_cast<double>(m_position + i);
+        m_block[i] = static_cast<float>(x - floor(x + 0.5));
+        growth *= m_sweepRatio;
+    }
+    sinTurns(m_block.data(), out, sweeping);
+    for (size_t i = 0; i < sweeping; ++i) {
+        out[i] *= m_amplitude;
+    }
+    fill_n(out + sweeping, n - sweeping, 0.0f);
+}
+
+void SignalGenerator::generateNoise(float *out, size_t n) {
+    const float WHITE_SCALE = 1.0f / 2147483648.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float white = static_cast<float>(static_cast<int32_t>(xorshift(m_random))) * WHITE_SCALE;
+        if (m_waveform == Waveform::WhiteNoise) {
+            out[i] = white * m_amplitude;
+            continue;
+        }
+
+        // Paul Kellet's refined pink noise filter
+        float *b = m_pink;
+        b[0] = 0.99886f * b[0] + white * 0.0555179f;
+        b[1] = 0.99332f * b[1] + white * 0.0750759f;
+        b[2] = 0.96900f * b[2] + white * 0.1538520f;
+        b[3] = 0.86650f * b[3] + white * 0.3104856f;
+        b[4] = 0.55000f * b[4] + white * 0.5329522f;
+        b[5] = -0.7616f * b[5] - white * 0.0168980f;
+        float pink = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + white * 0.5362f;
+        b[6] = white * 0.115926f;
+        out[i] = min(max(pink * PINK_SCALE, -1.0f), 1.0f) * m_amplitude;
+    }
+}
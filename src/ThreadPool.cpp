@@ -0,0 +1,163 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- ThreadPool --
+
+    A work stealing pool of worker threads.
+*/
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+
+// the pool and index of the worker running on this thread
+thread_local const ThreadPool *t_pool = nullptr;
+thread_local unsigned t_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned nThreads):
+    m_queues{}, m_threads{}, m_sleepLock{}, m_wake{}, m_queued{}, m_stopping{false}, m_nextQueue{0}
+{
+    if (nThreads == 0) {
+        nThreads = max(thread::hardware_concurrency(), 1u);
+    }
+
+    for (unsigned i = 0; i < nThreads; ++i) {
+        m_queues.emplace_back(new Queue());
+    }
+    for (unsigned i = 0; i < nThreads; ++i) {
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+// the workers finish every queued task before they stop
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(m_sleepLock);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (thread &worker : m_threads) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+unsigned ThreadPool::workerIndex() const {
+    return t_pool == this ? t_index : size();
+}
+
+// a worker adds tasks to its own queue, where it will find them first
+// while they are still in its cache, other threads spread them out
+void ThreadPool::submit(function<void()> task) {
+    unsigned index = workerIndex();
+    if (index == size()) {
+        index = m_nextQueue.fetch_add(1, memory_order_relaxed) % size();
+    }
+
+    // counted before it is pushed, so a worker that takes it straight
+    // away never counts it down below zero
+    {
+        lock_guard<mutex> guard(m_sleepLock);
+        ++m_queued;
+    }
+    {
+        lock_guard<mutex> guard(m_queues[index]->lock);
+        m_queues[index]->tasks.push_back(move(task));
+    }
+    m_wake.notify_one();
+}
+
+void ThreadPool::parallelFor(uint64_t begin, uint64_t end, uint64_t grain,
+                             const function<void(uint64_t, uint64_t)> &body) {
+    if (begin >= end) {
+        return;
+    }
+    grain = max<uint64_t>(grain, 1);
+
+    // the last chunk to finish wakes the caller
+    uint64_t nChunks = (end - begin + grain - 1) / grain;
+    atomic<uint64_t> remaining{nChunks};
+    mutex doneLock;
+    condition_variable done;
+
+    for (uint64_t first = begin; first < end; first += grain) {
+        uint64_t last = min(first + grain, end);
+        submit([&, first, last]() {
+            body(first, last);
+            lock_guard<mutex> guard(doneLock);
+            if (remaining.fetch_sub(1, memory_order_acq_rel) == 1) {
+                done.notify_all();
+            }
+        });
+    }
+
+    // a worker keeps running tasks while it waits, any other thread just waits,
+    // the lock is always taken at the end so the last task has let go of it
+    // before it is destroyed
+    unsigned index = workerIndex();
+    while (remaining.load(memory_order_acquire) > 0 && index < size() && runOne(index)) {
+    }
+    unique_lock<mutex> guard(doneLock);
+    done.wait(guard, [&]() { return remaining.load(memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::runOne(unsigned index) {
+    function<void()> task;
+
+    // newest task from its own queue first
+    {
+        Queue &own = *m_queues[index];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+
+    // then the oldest task of another worker
+    for (unsigned i = 1; !task && i < size(); ++i) {
+        Queue &other = *m_queues[(index + i) % size()];
+        lock_guard<mutex> guard(other.lock);
+        if (!other.tasks.empty()) {
+            task = move(other.tasks.front());
+            other.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+    {
+        lock_guard<mutex> guard(m_sleepLock);
+        --m_queued;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(unsigned index) {
+    t_pool = this;
+    t_index = index;
+
+    while (true) {
+        if (runOne(index)) {
+            continue;
+        }
+
+        unique_lock<mutex> guard(m_sleepLock);
+        m_wake.wait(guard, [this]() { return m_queued > 0 || m_stopping; });
+        if (m_queued == 0 && m_stopping) {
+            return;
+        }
+    }
+}
@@ -9,71 +9,297 @@
     be created by opening and reading a wave file into memory, or
     by creating a new empty wave file.  The audio data in a wave
     file can be manipulated using the getSample() and setSample()
-    methods.  After processing, a WaveFile object can be written to
-    a new wave file using the write method.
+    methods, or a block at a time with getSamples() and
+    setSamples().  After processing, a WaveFile object can be
+    written to a new wave file using the write method.
+
+    AudioSample only holds two channels, files with more channels
+    can be processed with readBuffer() and writeBuffer().
+
+    Both PCM and IEEE float waves are supported, including waves in
+    the extensible format, which are written back as plain waves.
+
+    For large files, map() can be used instead of read().  The audio
+    data is then memory mapped straight from the file rather than
+    copied, so opening is almost instant and pages are only loaded
+    when their samples are used.  When only a part of a long file is
+    needed, read() and write() can also be given a range of frames.
+
+    Copies of a WaveFile share their samples until one of them is
+    changed, only then are the samples copied (copy on write).
 */
 
 #include "WaveFile.h"
+#include "SampleConversion.h"
+#include "WaveHeaderIO.h"
 #include "util.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if SIMPLE_WAVE_HAS_MMAP
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// the number of samples the block set methods convert at a time
+constexpr size_t CLIP_CHUNK = 4096;
+
+// the number of bytes probe() reads at a time, enough for the headers of
+// most files, including a short LIST or bext chunk before the data
+constexpr size_t PROBE_BYTES = 512;
+
+// reads blocks of a file by position, with pread() where it is available
+// so opening a file costs no stream buffer
+class ProbeFile {
+private:
+#if SIMPLE_WAVE_HAS_MMAP
+    int m_fd;
+#else
+    ifstream m_file;
+#endif
+
+public:
+    explicit ProbeFile(const string &fileName) {
+#if SIMPLE_WAVE_HAS_MMAP
+        m_fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+#else
+        m_file.open(fileName, ios::binary);
+#endif
+    }
+
+    ~ProbeFile() {
+#if SIMPLE_WAVE_HAS_MMAP
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+#endif
+    }
+
+    ProbeFile(const ProbeFile &other) = delete;
+    ProbeFile& operator=(const ProbeFile &other) = delete;
+
+#if SIMPLE_WAVE_HAS_MMAP
+    bool isOpen() const { return m_fd >= 0; }
+#else
+    bool isOpen() const { return m_file.is_open(); }
+#endif
+
+    // reads up to size bytes from offset on, returns the number read
+    size_t read(uint64_t offset, uint8_t *out, size_t size) {
+#if SIMPLE_WAVE_HAS_MMAP
+        ssize_t count;
+        do {
+            count = pread(m_fd, out, size, static_cast<off_t>(offset));
+        } while (count < 0 && errno == EINTR);
+        return count > 0 ? static_cast<size_t>(count) : 0;
+#else
+        m_file.clear();
+        m_file.seekg(static_cast<streamoff>(offset));
+        m_file.read(reinterpret_cast<char *>(out), static_cast<streamsize>(size));
+        return static_cast<size_t>(m_file.gcount());
+#endif
+    }
+};
+
+// a stream buffer over a ProbeFile, so probe() reads the headers with
+// the same readWaveHeaders() as read(), seeking only moves the position
+// and a block is read when bytes are needed from outside the last one
+class ProbeBuffer : public streambuf {
+private:
+    ProbeFile &m_file;
+    char m_block[PROBE_BYTES];
+    uint64_t m_blockStart;
+
+    uint64_t position() const { return m_blockStart + static_cast<uint64_t>(gptr() - eback()); }
+
+public:
+    explicit ProbeBuffer(ProbeFile &file): m_file(file), m_block{}, m_blockStart{0}
+    {
+        setg(m_block, m_block, m_block);
+    }
+
+protected:
+    int_type underflow() override {
+        m_blockStart = position();
+        size_t count = m_file.read(m_blockStart, reinterpret_cast<uint8_t *>(m_block), PROBE_BYTES);
+        setg(m_block, m_block, m_block + count);
+        return count > 0 ? traits_type::to_int_type(m_block[0]) : traits_type::eof();
+    }
+
+    pos_type seekoff(off_type offset, ios_base::seekdir dir, ios_base::openmode which) override {
+        if (dir == ios_base::cur) {
+            return seekpos(static_cast<off_type>(position()) + offset, which);
+        }
+        if (dir == ios_base::beg) {
+            return seekpos(offset, which);
+        }
+        return pos_type(off_type(-1));
+    }
+
+    pos_type seekpos(pos_type pos, ios_base::openmode which) override {
+        if (!(which & ios_base::in) || pos < 0) {
+            return pos_type(off_type(-1));
+        }
+        uint64_t target = static_cast<uint64_t>(static_cast<off_type>(pos));
+        if (target >= m_blockStart && target <= m_blockStart + static_cast<uint64_t>(egptr() - eback())) {
+            setg(eback(), eback() + (target - m_blockStart), egptr());
+        } else {
+            m_blockStart = target;
+            setg(m_block, m_block, m_block);
+        }
+        return pos;
+    }
+};
+
+// moves PCM integers to another bit depth by shifting them, 8-bit
+// samples are unsigned so they are centered on zero first
+void shiftPcm(int32_t *samples, size_t n, uint16_t inBits, uint16_t outBits) {
+    const int32_t inOffset = inBits == 8 ? 128 : 0;
+    const int32_t outOffset = outBits == 8 ? 128 : 0;
+    if (outBits >= inBits) {
+        const int shift = outBits - inBits;
+        for (size_t i = 0; i < n; ++i) {
+            samples[i] = static_cast<int32_t>(static_cast<uint32_t>(samples[i] - inOffset) << shift) + outOffset;
+        }
+    } else {
+        const int shift = inBits - outBits;
+        for (size_t i = 0; i < n; ++i) {
+            samples[i] = ((samples[i] - inOffset) >> shift) + outOffset;
+        }
+    }
+}
+
+} // namespace
+
 WaveFile::WaveFile():
-    m_riffHeader{}, m_formatHeader{}, m_dataHeader{}, m_data{nullptr},
-    m_length{}, m_sampleRate{}, m_nChannels{}, m_bitDepth{}
+    m_riffHeader{}, m_ds64Chunk{}, m_formatHeader{}, m_dataHeader{},
+    m_chunks{}, m_fileName{}, m_partial{false},
+    m_data{nullptr}, m_samples{}, m_readOnly{false}, m_exposed{false},
+    m_length{}, m_sampleRate{}, m_nChannels{}, m_bitDepth{}, m_sampleFormat{SampleFormat::PCM},
+    m_codec{nullptr}, m_lastError{WaveError::None}, m_clipped{0}, m_outOfRange{0}, m_invalid{0}
 {
 }
 
 // constructor for creating a new wave file
-WaveFile::WaveFile(uint32_t length, uint32_t sampleRate, uint16_t nChannels, uint16_t bitDepth):
-    m_riffHeader{}, m_formatHeader{}, m_dataHeader{}, m_data{nullptr},
-    m_length(length), m_sampleRate(sampleRate), m_nChannels(nChannels), m_bitDepth(bitDepth)
+WaveFile::WaveFile(uint64_t length, uint32_t sampleRate, uint16_t nChannels, uint16_t bitDepth,
+                   SampleFormat sampleFormat):
+    m_riffHeader{}, m_ds64Chunk{}, m_formatHeader{}, m_dataHeader{},
+    m_chunks{}, m_fileName{}, m_partial{false},
+    m_data{nullptr}, m_samples{}, m_readOnly{false}, m_exposed{false},
+    m_length(length), m_sampleRate(sampleRate), m_nChannels(nChannels), m_bitDepth(bitDepth),
+    m_sampleFormat(sampleFormat), m_codec{nullptr},
+    m_lastError{WaveError::None}, m_clipped{0}, m_outOfRange{0}, m_invalid{0}
 {
+    m_formatHeader.audioFormat = sampleFormat == SampleFormat::Float ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
     setHeaders();
-    m_data.reset(new uint8_t[m_dataHeader.subChunk2Size]{});
+    allocate(dataSize());
 }
 
-// the copy constructor performs a deep copy
+// the copy constructor shares the samples, they are only
+// copied once either object is changed
 WaveFile::WaveFile(const WaveFile &other): WaveFile()
 {
+    *this = other;
+}
+
+// the move constructor takes over the samples, leaving other empty
+WaveFile::WaveFile(WaveFile &&other) noexcept: WaveFile()
+{
+    *this = move(other);
+}
+
+// constructor for directly reading a wave file into memory
+WaveFile::WaveFile(string fileName): WaveFile()
+{
+    read(fileName);
+}
+
+// the overloaded assignment operator shares the samples, a copy of a read
+// only mapping can be changed as its samples are copied before the first change
+WaveFile& WaveFile::operator=(const WaveFile &other) {
+    if (this == &other) {
+        return *this;
+    }
+
     m_riffHeader = other.m_riffHeader;
     m_formatHeader = other.m_formatHeader;
+    m_ds64Chunk = other.m_ds64Chunk;
     m_dataHeader = other.m_dataHeader;
+    m_chunks = other.m_chunks;
+    m_fileName = other.m_fileName;
+    m_partial = other.m_partial;
 
     m_length = other.m_length;
     m_sampleRate = other.m_sampleRate;
     m_nChannels = other.m_nChannels;
     m_bitDepth = other.m_bitDepth;
+    m_sampleFormat = other.m_sampleFormat;
+    m_codec = other.m_codec;
 
-    m_data.reset(new uint8_t[m_dataHeader.subChunk2Size]{});
-    for (uint32_t i = 0; i < m_dataHeader.subChunk2Size; ++i) {
-        m_data[i] = other.m_data[i];
-    }
-}
+    m_samples = other.shareSamples();
+    m_data = m_samples ? m_samples->data() : nullptr;
+    m_readOnly = false;
+    m_exposed = false;
 
-// constructor for directly reading a wave file into memory
-WaveFile::WaveFile(string fileName): WaveFile()
-{
-    read(fileName);
+    m_lastError.store(other.m_lastError.load(memory_order_relaxed), memory_order_relaxed);
+    m_clipped.store(other.m_clipped.load(memory_order_relaxed), memory_order_relaxed);
+    m_outOfRange.store(other.m_outOfRange.load(memory_order_relaxed), memory_order_relaxed);
+    m_invalid.store(other.m_invalid.load(memory_order_relaxed), memory_order_relaxed);
+
+    return *this;
 }
 
-// the overloaded assignment operator performs a deep copy
-WaveFile& WaveFile::operator=(const WaveFile &other) {
+WaveFile& WaveFile::operator=(WaveFile &&other) noexcept {
     if (this == &other) {
         return *this;
     }
 
     m_riffHeader = other.m_riffHeader;
     m_formatHeader = other.m_formatHeader;
+    m_ds64Chunk = other.m_ds64Chunk;
     m_dataHeader = other.m_dataHeader;
+    m_chunks = move(other.m_chunks);
+    m_fileName = move(other.m_fileName);
+    m_partial = other.m_partial;
 
     m_length = other.m_length;
     m_sampleRate = other.m_sampleRate;
     m_nChannels = other.m_nChannels;
     m_bitDepth = other.m_bitDepth;
+    m_sampleFormat = other.m_sampleFormat;
+    m_codec = other.m_codec;
 
-    m_data.reset(new uint8_t[m_dataHeader.subChunk2Size]{});
-    for (uint32_t i = 0; i < m_dataHeader.subChunk2Size; ++i) {
-        m_data[i] = other.m_data[i];
-    }
+    m_samples = move(other.m_samples);
+    m_data = other.m_data;
+    m_readOnly = other.m_readOnly;
+    m_exposed = other.m_exposed;
+
+    m_lastError.store(other.m_lastError.load(memory_order_relaxed), memory_order_relaxed);
+    m_clipped.store(other.m_clipped.load(memory_order_relaxed), memory_order_relaxed);
+    m_outOfRange.store(other.m_outOfRange.load(memory_order_relaxed), memory_order_relaxed);
+    m_invalid.store(other.m_invalid.load(memory_order_relaxed), memory_order_relaxed);
+
+    // leave other as an empty file
+    other.m_riffHeader = {};
+    other.m_formatHeader = {};
+    other.m_ds64Chunk = {};
+    other.m_dataHeader = {};
+    other.m_chunks.clear();
+    other.m_partial = false;
+    other.m_data = nullptr;
+    other.m_readOnly = false;
+    other.m_exposed = false;
+    other.m_length = 0;
+    other.m_sampleRate = 0;
+    other.m_nChannels = 0;
+    other.m_bitDepth = 0;
+    other.m_sampleFormat = SampleFormat::PCM;
+    other.m_codec = nullptr;
 
     return *this;
 }
@@ -85,246 +311,637 @@ bool WaveFile::read(string inFileName) {
     inFile.open(inFileName, ios::binary);
 
     if (!inFile) {
-        cout << "Cannot open file: " << inFileName << endl;
-        return false;
+        return fail(WaveError::CannotOpen, "Cannot open file: ", inFileName);
     }
 
-    cout << "Reading from file: " << inFileName << endl;
+    logMessage(LogLevel::Info, "Reading from file: ", inFileName);
 
-    inFile.read(reinterpret_cast<char *>(&m_riffHeader), sizeof(RiffHeader));
-
-    // first check to ensure a valid wave file
-    if (!wordCompare(m_riffHeader.chunkID, "RIFF")) {
-        cout << "File format error: missing RIFF header" << endl;
+    if (!readHeaders(inFile)) {
         inFile.close();
         return false;
     }
+    m_fileName = inFileName;
+    m_partial = false;
 
-    // parse through the extra parameters until the format is reached
-    do {
-        inFile.ignore(numeric_limits<streamsize>::max(), 'f');
-        if (inFile.eof()) {
-            cout << "File format error: missing format header" << endl;
-            inFile.close();
-            return false;
-        }
-        inFile.seekg(-1, inFile.cur);
-        inFile.read(reinterpret_cast<char *>(&m_formatHeader), sizeof(WaveFormatHeader));
-    } while (!wordCompare(m_formatHeader.subChunk1ID, "fmt "));
-
-    // audioFormat 1 is a standard PCM wave, currently this is the only kind of
-    // wave file supported, but I would like to add support for extensible waves and
-    // 32bit float waves in the future
-    if (m_formatHeader.audioFormat != 1) {
-        cout << "Incompatible wave format:" << m_formatHeader.audioFormat << endl;
+    allocate(dataSize());
+    inFile.read(reinterpret_cast<char *>(m_data), static_cast<streamsize>(dataSize()));
+
+    inFile.close();
+
+    if (!inFile) {
+        return fail(WaveError::ReadFailed, "Error closing file: ", inFileName);
+    }
+
+    return true;
+}
+
+// reads frameCount frames from startFrame on, seeking straight to them
+// so only that part of the data is read
+// returns true if successful
+bool WaveFile::read(string inFileName, uint64_t startFrame, uint64_t frameCount) {
+    ifstream inFile;
+    inFile.open(inFileName, ios::binary);
+
+    if (!inFile) {
+        return fail(WaveError::CannotOpen, "Cannot open file: ", inFileName);
+    }
+
+    logMessage(LogLevel::Info, "Reading from file: ", inFileName);
+
+    if (!readHeaders(inFile)) {
         inFile.close();
         return false;
     }
+    m_fileName = inFileName;
+    m_partial = true;
 
-    // parse through the extra parameters until the data is reached
-    do {
-        inFile.ignore(numeric_limits<streamsize>::max(), 'd');
-        if (inFile.eof()) {
-            cout << "File format error: missing data header" << endl;
-            inFile.close();
-            return false;
-        }
-        inFile.seekg(-1, inFile.cur);
-        inFile.read(reinterpret_cast<char *>(&m_dataHeader), sizeof(WaveDataHeader));
-    } while (!wordCompare(m_dataHeader.subChunk2ID, "data"));
+    // the headers have already been replaced, so on failure leave an empty file
+    if (startFrame > m_length) {
+        m_length = 0;
+        setHeaders();
+        allocate(0);
+        return fail(WaveError::OutOfRange, "Invalid range: frame ", startFrame, " is past the end of the file");
+    }
 
-    m_data.reset(new uint8_t[m_dataHeader.subChunk2Size]);
-    inFile.read(reinterpret_cast<char *>(m_data.get()), m_dataHeader.subChunk2Size);
+    streamoff offset = static_cast<streamoff>(startFrame * m_formatHeader.blockAlign);
+    m_length = min(frameCount, m_length - startFrame);
+    setHeaders();
+
+    allocate(dataSize());
+    inFile.seekg(offset, ios::cur);
+    inFile.read(reinterpret_cast<char *>(m_data), static_cast<streamsize>(dataSize()));
 
     inFile.close();
 
     if (!inFile) {
-        cout << "Error closing file: " << inFileName << endl;
+        return fail(WaveError::ReadFailed, "Error closing file: ", inFileName);
+    }
+
+    return true;
+}
+
+// memory maps a standard PCM wave file, m_data points straight
+// into the mapping so nothing is copied until a page is used
+// returns true if successful
+bool WaveFile::map(string inFileName, MapMode mode, AccessHint hint) {
+    ifstream inFile;
+    inFile.open(inFileName, ios::binary);
+
+    if (!inFile) {
+        return fail(WaveError::CannotOpen, "Cannot open file: ", inFileName);
+    }
+
+    logMessage(LogLevel::Info, "Mapping file: ", inFileName);
+
+    if (!readHeaders(inFile)) {
+        inFile.close();
         return false;
     }
+    m_fileName = inFileName;
+    m_partial = false;
+
+    size_t dataOffset = static_cast<size_t>(inFile.tellg());
+    inFile.close();
 
-    // if there were extra parameters thrown away, then recalculate the size
-    if (m_formatHeader.subChunk1Size != sizeof(WaveFormatHeader)) {
-        m_formatHeader.subChunk1Size = sizeof(WaveFormatHeader)
-            - sizeof(m_formatHeader.subChunk1ID) - sizeof(m_formatHeader.subChunk1Size);
-        m_riffHeader.chunkSize = m_dataHeader.subChunk2Size + WAVE_HEADER_SIZE
-            - sizeof(m_riffHeader.chunkID) - sizeof(m_riffHeader.chunkSize);
+    // the headers have already been replaced, so on failure leave an empty file
+    unique_ptr<MappedFile> mapping(new MappedFile());
+    if (!mapping->open(inFileName, mode)) {
+        m_length = 0;
+        allocate(0);
+        m_lastError = SIMPLE_WAVE_HAS_MMAP ? WaveError::CannotOpen : WaveError::NotSupported;
+        return false;
     }
 
-    // calculate the total number of samples and store all core attributes
-    // in a more easily accessible place
-    m_length = m_dataHeader.subChunk2Size / m_formatHeader.numChannels
-            / (m_formatHeader.bitsPerSample / 8);
-    m_nChannels = m_formatHeader.numChannels;
-    m_sampleRate = m_formatHeader.sampleRate;
-    m_bitDepth = m_formatHeader.bitsPerSample;
+    if (dataOffset + dataSize() > mapping->size()) {
+        m_length = 0;
+        allocate(0);
+        return fail(WaveError::FormatError, "File format error: data is shorter than its header");
+    }
+
+    m_samples.reset(new SampleBuffer(move(mapping), dataOffset, static_cast<size_t>(dataSize())));
+    m_data = m_samples->data();
+    m_exposed = false;
+    m_readOnly = mode == MapMode::ReadOnly;
+    advise(hint);
 
     return true;
 }
 
+// reads only the headers, with the same readWaveHeaders() as read() but
+// through a ProbeBuffer, so only the blocks holding chunk headers are read
+// returns true if read() would accept the headers
+bool WaveFile::probe(string fileName, WaveInfo &info) {
+    ProbeFile file(fileName);
+    if (!file.isOpen()) {
+        return false;
+    }
+    ProbeBuffer buffer(file);
+    istream inFile(&buffer);
+
+    RiffHeader riffHeader;
+    Ds64Chunk ds64Chunk;
+    WaveFormatHeader formatHeader;
+    WaveDataHeader dataHeader;
+    ChunkIndex chunks;
+    if (!readWaveHeaders(inFile, riffHeader, ds64Chunk, formatHeader, dataHeader, chunks, nullptr, true)) {
+        return false;
+    }
+
+    info.length = ds64Chunk.sampleCount;
+    info.dataOffset = chunks.find("data")->offset;
+    info.sampleRate = formatHeader.sampleRate;
+    info.nChannels = formatHeader.numChannels;
+    info.bitDepth = formatHeader.bitsPerSample;
+    info.sampleFormat = formatHeader.audioFormat == WAVE_FORMAT_IEEE_FLOAT ? SampleFormat::Float : SampleFormat::PCM;
+
+    return true;
+}
+
+// changes the access hint for a mapped file, returns false if not mapped
+bool WaveFile::advise(AccessHint hint) {
+    MappedFile *mapping = m_samples ? m_samples->mapping() : nullptr;
+    if (mapping == nullptr) {
+        return false;
+    }
+    return mapping->advise(hint, m_data - mapping->data(), dataSize());
+}
+
 // writes the WaveFile object to a new wave file
 // returns true if successful
 bool WaveFile::write(string outFileName) {
+    // mapped samples are still read from the file they were mapped from,
+    // so saving over that file writes a new one and renames it into place,
+    // the mapping keeps the old file until it is closed
+    MappedFile *mapping = m_samples ? m_samples->mapping() : nullptr;
+    bool replace = mapping != nullptr && mapping->isSameFile(outFileName);
+    string path = replace ? outFileName + ".tmp" : outFileName;
+
     ofstream outFile;
-    outFile.open(outFileName, ios::binary);
+    outFile.open(path, ios::binary);
 
     if (!outFile) {
-        cout << "Cannot create file: " << outFileName << endl;
-        return false;
+        return fail(WaveError::CannotOpen, "Cannot create file: ", path);
     }
 
-    cout << "Writing to file: " << outFileName << endl;
+    logMessage(LogLevel::Info, "Writing to file: ", outFileName);
 
-    outFile.write(reinterpret_cast<char *>(&m_riffHeader), sizeof(RiffHeader));
-    outFile.write(reinterpret_cast<char *>(&m_formatHeader), sizeof(WaveFormatHeader));
-    outFile.write(reinterpret_cast<char *>(&m_dataHeader), sizeof(WaveDataHeader));
-    outFile.write(reinterpret_cast<char *>(m_data.get()), m_dataHeader.subChunk2Size);
+    writeWaveHeaders(outFile, m_riffHeader, isRF64() ? &m_ds64Chunk : nullptr,
+                     m_formatHeader, m_dataHeader);
+    outFile.write(reinterpret_cast<char *>(m_data), static_cast<streamsize>(dataSize()));
     outFile.close();
 
     if (!outFile) {
-        cout << "Error closing file: " << outFileName << endl;
+        if (replace) {
+            remove(path.c_str());
+        }
+        return fail(WaveError::WriteFailed, "Error closing file: ", path);
+    }
+    if (replace && rename(path.c_str(), outFileName.c_str()) != 0) {
+        remove(path.c_str());
+        return fail(WaveError::WriteFailed, "Cannot replace file: ", outFileName);
+    }
+
+    return true;
+}
+
+// overwrites part of the data of an existing wave file in place, the
+// headers of the file are left as they are
+// returns true if successful
+bool WaveFile::write(string outFileName, uint64_t startFrame) {
+    fstream outFile;
+    outFile.open(outFileName, ios::binary | ios::in | ios::out);
+
+    if (!outFile) {
+        return fail(WaveError::CannotOpen, "Cannot open file: ", outFileName);
+    }
+
+    logMessage(LogLevel::Info, "Writing to file: ", outFileName);
+
+    RiffHeader riffHeader;
+    Ds64Chunk ds64Chunk;
+    WaveFormatHeader formatHeader;
+    WaveDataHeader dataHeader;
+    ChunkIndex chunks;
+    WaveError error{WaveError::FormatError};
+    if (!readWaveHeaders(outFile, riffHeader, ds64Chunk, formatHeader, dataHeader, chunks, &error)) {
+        m_lastError = error;
         return false;
     }
 
+    SampleFormat sampleFormat = formatHeader.audioFormat == WAVE_FORMAT_IEEE_FLOAT ? SampleFormat::Float
+                                                                                    : SampleFormat::PCM;
+    if (formatHeader.numChannels != m_nChannels || formatHeader.bitsPerSample != m_bitDepth
+        || sampleFormat != m_sampleFormat) {
+        return fail(WaveError::FormatMismatch, "File format does not match: ", outFileName);
+    }
+    if (startFrame > ds64Chunk.sampleCount || m_length > ds64Chunk.sampleCount - startFrame) {
+        return fail(WaveError::OutOfRange, "Invalid range: the file is too short");
+    }
+
+    outFile.seekp(outFile.tellg() + static_cast<streamoff>(startFrame * formatHeader.blockAlign));
+    outFile.write(reinterpret_cast<char *>(m_data), static_cast<streamsize>(dataSize()));
+    outFile.close();
+
+    if (!outFile) {
+        return fail(WaveError::WriteFailed, "Error closing file: ", outFileName);
+    }
+
     return true;
 }
 
+// reads the data of any chunk in the file this was read from
+// returns true if successful
+bool WaveFile::readChunk(string id, vector<uint8_t> &out) const {
+    const ChunkInfo *chunk = m_chunks.find(id);
+    if (chunk == nullptr) {
+        return false;
+    }
+
+    ifstream inFile;
+    inFile.open(m_fileName, ios::binary);
+
+    if (!inFile) {
+        return fail(WaveError::CannotOpen, "Cannot open file: ", m_fileName);
+    }
+
+    return ChunkIndex::readChunk(inFile, *chunk, out);
+}
+
 // Returns an AudioSample given a sample number within the wave file.
 // This function perform the conversion from an uint8_t[] to
-// a double.
-AudioSample WaveFile::getSample(uint32_t sample) {
+// a double, using the kernel specialized for the format.
+AudioSample WaveFile::getSample(uint64_t sample) {
     // if the sample is beyond the length of the file, return empty audio data
-    if (sample > m_length) {
-        //cout << "Sample exceeds file length" << endl;
+    if (sample >= m_length) {
+        sampleError(WaveError::OutOfRange, "Sample exceeds file length");
         return AudioSample();
     }
+    if (m_codec == nullptr) {
+        sampleError(WaveError::UnsupportedFormat, "Invalid bit depth");
+        return AudioSample(0, 0);
+    }
 
     double left{};
     double right{};
-    uint32_t index = sample * m_nChannels * (m_bitDepth / 8);
+    size_t index = sample * m_nChannels * (m_bitDepth / 8);
+    m_codec->readFrame(&m_data[index], left, right);
 
-    switch (m_bitDepth) {
-        case 8:
-        {
-            left = m_data[index] / static_cast<double>(numeric_limits<uint8_t>::max());
+    return AudioSample(left, right);
+}
 
-            if (m_nChannels == 2) {
-                right = m_data[index + 1] / static_cast<double>(numeric_limits<uint8_t>::max());
-            }
-            break;
-        }
-        case 16:
-        {
-            int16_t left_16bit = m_data[index] | (m_data[index + 1] << 8);
-            left = left_16bit / static_cast<double>(numeric_limits<int16_t>::max());
-
-            if (m_nChannels == 2) {
-                int16_t right_16bit = m_data[index + 2] | (m_data[index + 3] << 8);
-                right = right_16bit / static_cast<double>(numeric_limits<int16_t>::max());
-            }
-            break;
+// Sets a sample within the wave file to the AudioSample passed in.
+// This function perform the conversion back from a double
+// to an uint8_t[], using the kernel specialized for the format.
+void WaveFile::setSample(uint64_t sample, const AudioSample &audio) {
+    if (sample >= m_length) {
+        sampleError(WaveError::OutOfRange, "Sample exceeds file length");
+        return;
+    }
+    if (m_codec == nullptr) {
+        sampleError(WaveError::UnsupportedFormat, "Invalid bit depth");
+        return;
+    }
+    if (!detach()) {
+        return;
+    }
+
+    size_t index = sample * m_nChannels * (m_bitDepth / 8);
+    m_codec->writeFrame(&m_data[index], audio.left, audio.right);
+}
+
+// Copies a block of frames into out as interleaved floats.  The
+// conversion is done by the vectorized kernels in SampleConversion
+// so the bit depth is only checked once per block.  For a 32-bit
+// float wave this is a plain memcpy.
+uint32_t WaveFile::getSamples(uint64_t start, uint32_t count, float *out) const {
+    if (start >= m_length) {
+        return 0;
+    }
+    count = static_cast<uint32_t>(min<uint64_t>(count, m_length - start));
+
+    uint32_t bytesPerSample = m_bitDepth / 8;
+    size_t index = start * m_nChannels * bytesPerSample;
+
+    if (!pcmToFloat(&m_data[index], out, static_cast<size_t>(count) * m_nChannels, m_bitDepth, m_sampleFormat)) {
+        sampleError(WaveError::UnsupportedFormat, "Invalid bit depth");
+        return 0;
+    }
+    return count;
+}
+
+// Sets a block of frames from interleaved floats, PCM values are
+// clamped between 1 and -1 just like an AudioSample.  The values are
+// converted a chunk at a time, and the values that get clamped counted,
+// so the second pass over a chunk finds it still in the L1 cache.
+uint32_t WaveFile::setSamples(uint64_t start, uint32_t count, const float *in) {
+    if (start >= m_length) {
+        sampleError(WaveError::OutOfRange, "Sample exceeds file length");
+        return 0;
+    }
+    if (!detach()) {
+        return 0;
+    }
+    count = static_cast<uint32_t>(min<uint64_t>(count, m_length - start));
+
+    uint32_t bytesPerSample = m_bitDepth / 8;
+    size_t index = start * m_nChannels * bytesPerSample;
+
+    size_t n = static_cast<size_t>(count) * m_nChannels;
+    for (size_t done = 0; done < n; done += CLIP_CHUNK) {
+        size_t chunk = min(CLIP_CHUNK, n - done);
+        countClips(in + done, chunk);
+        if (!floatToPcm(in + done, &m_data[index + done * bytesPerSample], chunk, m_bitDepth, m_sampleFormat)) {
+            sampleError(WaveError::UnsupportedFormat, "Invalid bit depth");
+            return 0;
         }
-        case 24:
-        {
-            int32_t left_24bit = (m_data[index] << 8) | (m_data[index + 1] << 16) | (m_data[index + 2] << 24);
-            left = left_24bit / static_cast<double>(numeric_limits<int32_t>::max());
+    }
+    return count;
+}
 
-            if (m_nChannels == 2) {
-                int32_t right_24bit = (m_data[index + 3] << 8) | (m_data[index + 4] << 16) | (m_data[index + 5] << 24);
-                right = right_24bit / static_cast<double>(numeric_limits<int32_t>::max());
+// Copies a block of frames into out as interleaved doubles.
+uint32_t WaveFile::getSamples(uint64_t start, uint32_t count, double *out) const {
+    if (start >= m_length) {
+        return 0;
+    }
+    if (m_codec == nullptr) {
+        sampleError(WaveError::UnsupportedFormat, "Invalid bit depth");
+        return 0;
+    }
+    count = static_cast<uint32_t>(min<uint64_t>(count, m_length - start));
 
-            }
-            break;
+    size_t index = start * m_nChannels * (m_bitDepth / 8);
+    m_codec->readDouble(&m_data[index], out, static_cast<size_t>(count) * m_nChannels);
+    return count;
+}
+
+// Sets a block of frames from interleaved doubles, PCM values are
+// clamped between 1 and -1.
+uint32_t WaveFile::setSamples(uint64_t start, uint32_t count, const double *in) {
+    if (start >= m_length) {
+        sampleError(WaveError::OutOfRange, "Sample exceeds file length");
+        return 0;
+    }
+    if (m_codec == nullptr) {
+        sampleError(WaveError::UnsupportedFormat, "Invalid bit depth");
+        return 0;
+    }
+    if (!detach()) {
+        return 0;
+    }
+    count = static_cast<uint32_t>(min<uint64_t>(count, m_length - start));
+
+    uint32_t bytesPerSample = m_bitDepth / 8;
+    size_t index = start * m_nChannels * bytesPerSample;
+    size_t n = static_cast<size_t>(count) * m_nChannels;
+    for (size_t done = 0; done < n; done += CLIP_CHUNK) {
+        size_t chunk = min(CLIP_CHUNK, n - done);
+        countClips(in + done, chunk);
+        m_codec->writeDouble(in + done, &m_data[index + done * bytesPerSample], chunk);
+    }
+    return count;
+}
+
+// Copies a block of frames into out as the integers stored in the file,
+// 0 to 255 for 8-bit waves and signed for the others.
+uint32_t WaveFile::getSamples(uint64_t start, uint32_t count, int32_t *out) const {
+    if (start >= m_length) {
+        return 0;
+    }
+    if (m_codec == nullptr || m_codec->readInt == nullptr) {
+        sampleError(WaveError::FormatMismatch, "Integer samples need a PCM wave");
+        return 0;
+    }
+    count = static_cast<uint32_t>(min<uint64_t>(count, m_length - start));
+
+    size_t index = start * m_nChannels * (m_bitDepth / 8);
+    m_codec->readInt(&m_data[index], out, static_cast<size_t>(count) * m_nChannels);
+    return count;
+}
+
+// Sets a block of frames from integers, which are stored as they are
+// apart from being cut down to the bit depth.
+uint32_t WaveFile::setSamples(uint64_t start, uint32_t count, const int32_t *in) {
+    if (start >= m_length) {
+        sampleError(WaveError::OutOfRange, "Sample exceeds file length");
+        return 0;
+    }
+    if (m_codec == nullptr || m_codec->writeInt == nullptr) {
+        sampleError(WaveError::FormatMismatch, "Integer samples need a PCM wave");
+        return 0;
+    }
+    if (!detach()) {
+        return 0;
+    }
+    count = static_cast<uint32_t>(min<uint64_t>(count, m_length - start));
+
+    size_t index = start * m_nChannels * (m_bitDepth / 8);
+    m_codec->writeInt(in, &m_data[index], static_cast<size_t>(count) * m_nChannels);
+    return count;
+}
+
+// Copies a block of frames into the separate channels of an AudioBuffer.
+// This works for any number of channels.
+size_t WaveFile::readBuffer(uint64_t start, AudioBuffer &buffer, size_t frames) const {
+    if (buffer.nChannels() != m_nChannels) {
+        sampleError(WaveError::FormatMismatch, "Channel count mismatch");
+        return 0;
+    }
+    if (start >= m_length) {
+        return 0;
+    }
+    size_t count = static_cast<size_t>(min<uint64_t>(min(frames, buffer.length()), m_length - start));
+
+    vector<float *> channels(m_nChannels);
+    for (uint16_t c = 0; c < m_nChannels; ++c) {
+        channels[c] = buffer.channel(c);
+    }
+
+    size_t index = start * m_nChannels * (m_bitDepth / 8);
+    if (!pcmToPlanar(&m_data[index], channels.data(), count, m_nChannels, m_bitDepth, m_sampleFormat)) {
+        sampleError(WaveError::UnsupportedFormat, "Invalid bit depth");
+        return 0;
+    }
+    return count;
+}
+
+// Sets a block of frames from the separate channels of an AudioBuffer.
+// Values are clamped between 1 and -1.
+size_t WaveFile::writeBuffer(uint64_t start, const AudioBuffer &buffer, size_t frames) {
+    if (buffer.nChannels() != m_nChannels) {
+        sampleError(WaveError::FormatMismatch, "Channel count mismatch");
+        return 0;
+    }
+    if (start >= m_length) {
+        sampleError(WaveError::OutOfRange, "Sample exceeds file length");
+        return 0;
+    }
+    if (!detach()) {
+        return 0;
+    }
+    size_t count = static_cast<size_t>(min<uint64_t>(min(frames, buffer.length()), m_length - start));
+
+    // a chunk of frames at a time, as setSamples() does
+    size_t chunkFrames = max<size_t>(CLIP_CHUNK / m_nChannels, 1);
+    size_t blockAlign = m_nChannels * (m_bitDepth / 8);
+    size_t index = start * blockAlign;
+    vector<const float *> channels(m_nChannels);
+    for (size_t done = 0; done < count; done += chunkFrames) {
+        size_t chunk = min(chunkFrames, count - done);
+        for (uint16_t c = 0; c < m_nChannels; ++c) {
+            channels[c] = buffer.channel(c) + done;
+            countClips(channels[c], chunk);
         }
-        case 32:
-        {
-            int32_t left_32bit = m_data[index] | (m_data[index + 1] << 8) | (m_data[index + 2] << 16) | (m_data[index + 3] << 24);
-            left = left_32bit / static_cast<double>(numeric_limits<int32_t>::max());
-
-            if (m_nChannels == 2) {
-                int32_t right_32bit = m_data[index + 4] | (m_data[index + 5] << 8) | (m_data[index + 6] << 16) | (m_data[index + 7] << 24);
-                right = right_32bit / static_cast<double>(numeric_limits<int32_t>::max());
-            }
-            break;
+        if (!planarToPcm(channels.data(), &m_data[index + done * blockAlign], chunk, m_nChannels,
+                         m_bitDepth, m_sampleFormat)) {
+            sampleError(WaveError::UnsupportedFormat, "Invalid bit depth");
+            return 0;
         }
-        default:
-            cout << "Invalid bit depth" << endl;
-            return AudioSample(0, 0);
     }
-
-    return AudioSample(left, right);
+    return count;
 }
 
-// Sets a sample within the wave file to the AudioSample passed in.
-// This function perform the conversion back from a double
-// to an uint8_t[].
-void WaveFile::setSample(uint32_t sample, const AudioSample &audio) {
-    if (sample > m_length) {
-        cout << "Sample exceeds file length" << endl;
-        return;
+// Converts the samples to another bit depth or sample format a chunk at
+// a time through floats.  When each sample gets smaller the result is
+// written over the original samples, the output of a chunk never reaches
+// past its own input, otherwise a new buffer is filled.  Dither is only
+// added when going to PCM with fewer bits than before.
+bool WaveFile::convertBitDepth(uint16_t bitDepth, SampleFormat sampleFormat, DitherMode dither) {
+    if (!isSupportedFormat(sampleFormat, bitDepth)) {
+        return fail(WaveError::UnsupportedFormat, "Unsupported format: ", bitDepth, "-bit");
+    }
+    if (m_samples == nullptr || m_nChannels == 0) {
+        return fail(WaveError::FormatError, "Wave file has no samples to convert");
+    }
+    if (bitDepth == m_bitDepth && sampleFormat == m_sampleFormat) {
+        return true;
+    }
+    if (isReadOnly()) {
+        return fail(WaveError::ReadOnly, "Wave file is read only");
     }
 
-    uint32_t index = sample * m_nChannels * (m_bitDepth / 8);
+    uint32_t inBytes = m_bitDepth / 8;
+    uint32_t outBytes = bitDepth / 8;
+
+    // shared or read only samples have to be copied anyway, so convert
+    // straight into a new buffer rather than copying them first
+    shared_ptr<SampleBuffer> target;
+    uint8_t *out = m_data;
+    if (outBytes > inBytes || isShared() || !m_samples->writable()) {
+        target.reset(new SampleBuffer(static_cast<size_t>(m_length * m_nChannels * outBytes)));
+        out = target->data();
+    }
 
-    switch (m_bitDepth) {
-        case 8:
-        {
-            m_data[index] = static_cast<uint8_t>(audio.left * numeric_limits<uint8_t>::max());
+    bool reduced = sampleFormat == SampleFormat::PCM
+                && (m_sampleFormat == SampleFormat::Float || bitDepth < m_bitDepth);
+    Ditherer ditherer(reduced ? dither : DitherMode::None, m_nChannels);
+    // 8-bit samples are read from 0 to 1 with 128 as silence
+    bool fromUnsigned = m_bitDepth == 8 && bitDepth != 8;
+    bool toUnsigned = bitDepth == 8 && m_bitDepth != 8;
 
-            if (m_nChannels == 2) {
-                 m_data[index + 1] = static_cast<uint8_t>(audio.right * numeric_limits<uint8_t>::max());
+    // a float only holds 24 bits, so 32-bit PCM and 64-bit float samples
+    // are converted through doubles, the codecs do that a block at a time
+    bool wide = (m_bitDepth == 32 && m_sampleFormat == SampleFormat::PCM) || m_bitDepth == 64
+             || (bitDepth == 32 && sampleFormat == SampleFormat::PCM) || bitDepth == 64;
+    // PCM to PCM without dither only moves the bits, so it is done on the
+    // integers, widening is then exact and narrowing again undoes it
+    bool integer = m_sampleFormat == SampleFormat::PCM && sampleFormat == SampleFormat::PCM
+                && ditherer.mode() == DitherMode::None;
+    const CodecTable *inCodec = findCodec(m_bitDepth, m_sampleFormat, m_nChannels);
+    const CodecTable *outCodec = findCodec(bitDepth, sampleFormat, m_nChannels);
+    // dither is only added down to 24 bits, a float still holds every
+    // step of those, the steps of 32-bit samples are far below any noise
+    bool dithered = ditherer.mode() != DitherMode::None && sampleFormat == SampleFormat::PCM && bitDepth <= 24;
+
+    const size_t chunkFrames = max<size_t>(4096 / m_nChannels, 1);
+    vector<float> chunk(chunkFrames * m_nChannels);
+    vector<double> wideChunk(wide && !integer ? chunk.size() : 0);
+    vector<int32_t> intChunk(integer ? chunk.size() : 0);
+
+    for (uint64_t frame = 0; frame < m_length; frame += chunkFrames) {
+        size_t count = static_cast<size_t>(min<uint64_t>(chunkFrames, m_length - frame));
+        size_t index = frame * m_nChannels;
+        size_t n = count * m_nChannels;
+
+        if (integer) {
+            inCodec->readInt(&m_data[index * inBytes], intChunk.data(), n);
+            shiftPcm(intChunk.data(), n, m_bitDepth, bitDepth);
+            outCodec->writeInt(intChunk.data(), &out[index * outBytes], n);
+        } else if (wide) {
+            inCodec->readDouble(&m_data[index * inBytes], wideChunk.data(), n);
+            if (fromUnsigned) {
+                unsignedToSigned(wideChunk.data(), n);
+            } else if (toUnsigned) {
+                signedToUnsigned(wideChunk.data(), n);
             }
-            break;
-        }
-        case 16:
-        {
-            int16_t left_16bit = static_cast<int16_t>(audio.left * numeric_limits<int16_t>::max());
-            m_data[index] = left_16bit;
-            m_data[index + 1] = left_16bit >> 8;
-
-            if (m_nChannels == 2) {
-                int16_t right_16bit = static_cast<int16_t>(audio.right * numeric_limits<int16_t>::max());
-                m_data[index + 2] = right_16bit;
-                m_data[index + 3] = right_16bit >> 8;
+            if (dithered) {
+                copy(wideChunk.begin(), wideChunk.begin() + n, chunk.begin());
+                ditherer.quantize(chunk.data(), &out[index * outBytes], count, bitDepth);
+            } else {
+                outCodec->writeDouble(wideChunk.data(), &out[index * outBytes], n);
             }
-            break;
-        }
-        case 24:
-        {
-            int32_t left_24bit = static_cast<int32_t>(audio.left * numeric_limits<int32_t>::max());
-            m_data[index] = left_24bit >> 8;
-            m_data[index + 1] = left_24bit >> 16;
-            m_data[index + 2] = left_24bit >> 24;
-
-            if (m_nChannels == 2) {
-                int32_t right_24bit = static_cast<int32_t>(audio.right * numeric_limits<int32_t>::max());
-                m_data[index + 3] = right_24bit >> 8;
-                m_data[index + 4] = right_24bit >> 16;
-                m_data[index + 5] = right_24bit >> 24;
+        } else {
+            pcmToFloat(&m_data[index * inBytes], chunk.data(), n, m_bitDepth, m_sampleFormat);
+            if (fromUnsigned) {
+                unsignedToSigned(chunk.data(), n);
+            } else if (toUnsigned) {
+                signedToUnsigned(chunk.data(), n);
             }
-            break;
-        }
-        case 32:
-        {
-            int32_t left_32bit = static_cast<int32_t>(audio.left * numeric_limits<int32_t>::max());
-            m_data[index] = left_32bit;
-            m_data[index + 1] = left_32bit >> 8;
-            m_data[index + 2] = left_32bit >> 16;
-            m_data[index + 3] = left_32bit >> 24;
-
-            if (m_nChannels == 2) {
-                int32_t right_32bit = static_cast<int32_t>(audio.right * numeric_limits<int32_t>::max());
-                m_data[index + 4] = right_32bit;
-                m_data[index + 5] = right_32bit >> 8;
-                m_data[index + 6] = right_32bit >> 16;
-                m_data[index + 7] = right_32bit >> 24;
+            if (sampleFormat == SampleFormat::Float) {
+                floatToPcm(chunk.data(), &out[index * outBytes], n, bitDepth, sampleFormat);
+            } else {
+                ditherer.quantize(chunk.data(), &out[index * outBytes], count, bitDepth);
             }
-            break;
         }
-        default:
-            cout << "Invalid bit depth" << endl;
-            return;
     }
+
+    if (target) {
+        m_samples = target;
+        m_data = m_samples->data();
+    }
+    m_exposed = false;
+    m_bitDepth = bitDepth;
+    m_sampleFormat = sampleFormat;
+    m_formatHeader.audioFormat = sampleFormat == SampleFormat::Float ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+    setHeaders();
+
+    return true;
+}
+
+// direct views of the samples of a float wave, these return nullptr
+// unless the samples are stored in exactly that type, the non-const
+// versions copy shared samples first, just like any other change
+float* WaveFile::floatData() {
+    if (m_sampleFormat != SampleFormat::Float || m_bitDepth != 32 || isReadOnly()
+            || reinterpret_cast<uintptr_t>(m_data) % alignof(float) != 0 || !detach()) {
+        return nullptr;
+    }
+    m_exposed = true;
+    return reinterpret_cast<float *>(m_data);
+}
+
+const float* WaveFile::floatData() const {
+    if (m_sampleFormat != SampleFormat::Float || m_bitDepth != 32
+            || reinterpret_cast<uintptr_t>(m_data) % alignof(float) != 0) {
+        return nullptr;
+    }
+    return reinterpret_cast<const float *>(m_data);
+}
+
+double* WaveFile::doubleData() {
+    if (m_sampleFormat != SampleFormat::Float || m_bitDepth != 64 || isReadOnly()
+            || reinterpret_cast<uintptr_t>(m_data) % alignof(double) != 0 || !detach()) {
+        return nullptr;
+    }
+    m_exposed = true;
+    return reinterpret_cast<double *>(m_data);
+}
+
+const double* WaveFile::doubleData() const {
+    if (m_sampleFormat != SampleFormat::Float || m_bitDepth != 64
+            || reinterpret_cast<uintptr_t>(m_data) % alignof(double) != 0) {
+        return nullptr;
+    }
+    return reinterpret_cast<const double *>(m_data);
 }
 
 // this print function displays only the core information about an audio file
@@ -333,10 +950,16 @@ void WaveFile::print() {
     cout << m_sampleRate << "Hz" << endl;
     if (m_nChannels == 1) {
         cout << "Mono" << endl;
-    } else {
+    } else if (m_nChannels == 2) {
         cout << "Stereo" << endl;
+    } else {
+        cout << m_nChannels << " channels" << endl;
     }
-    cout << m_bitDepth << "-bit" << endl;
+    cout << m_bitDepth << "-bit";
+    if (m_sampleFormat == SampleFormat::Float) {
+        cout << " float";
+    }
+    cout << endl;
 }
 
 // this print function is used to display all of the header information
@@ -347,6 +970,14 @@ void WaveFile::printHeaderInfo() {
     cout << "Chunk size: " << m_riffHeader.chunkSize << endl;
     printWord(m_riffHeader.format);
 
+    //ds64 chunk
+    if (isRF64()) {
+        printWord(m_ds64Chunk.chunkID);
+        cout << "RIFF size: " << m_ds64Chunk.riffSize << endl;
+        cout << "Data size: " << m_ds64Chunk.dataSize << endl;
+        cout << "Sample count: " << m_ds64Chunk.sampleCount << endl;
+    }
+
     //format header
     printWord(m_formatHeader.subChunk1ID);
     cout << "SubChunk1 size: " << m_formatHeader.subChunk1Size << endl;
@@ -366,14 +997,88 @@ void WaveFile::printHeaderInfo() {
 
 // recalculates header values
 void WaveFile::setHeaders() {
-    m_formatHeader.subChunk1Size = sizeof(WaveFormatHeader)
-        - sizeof(m_formatHeader.subChunk1ID) - sizeof(m_formatHeader.subChunk1Size);
-    m_formatHeader.numChannels = m_nChannels;
-    m_formatHeader.sampleRate = m_sampleRate;
-    m_formatHeader.byteRate = m_sampleRate * m_nChannels * (m_bitDepth / 8);
-    m_formatHeader.blockAlign = m_nChannels * (m_bitDepth / 8);
-    m_formatHeader.bitsPerSample = m_bitDepth;
-    m_dataHeader.subChunk2Size = m_length * m_nChannels * (m_bitDepth / 8);
-    m_riffHeader.chunkSize = m_dataHeader.subChunk2Size + WAVE_HEADER_SIZE
-        - sizeof(m_riffHeader.chunkID) - sizeof(m_riffHeader.chunkSize);
+    fillWaveHeaders(m_length, m_sampleRate, m_nChannels, m_bitDepth,
+                    m_riffHeader, m_ds64Chunk, m_formatHeader, m_dataHeader);
+    m_codec = findCodec(m_bitDepth, m_sampleFormat, m_nChannels);
+}
+
+// reads the headers and stores the core attributes
+// returns true if successful
+bool WaveFile::readHeaders(ifstream &inFile) {
+    WaveError error{WaveError::FormatError};
+    if (!readWaveHeaders(inFile, m_riffHeader, m_ds64Chunk, m_formatHeader, m_dataHeader, m_chunks, &error)) {
+        m_lastError = error;
+        return false;
+    }
+
+    // calculate the total number of samples and store all core attributes
+    // in a more easily accessible place
+    m_length = m_ds64Chunk.sampleCount;
+    m_nChannels = m_formatHeader.numChannels;
+    m_sampleRate = m_formatHeader.sampleRate;
+    m_bitDepth = m_formatHeader.bitsPerSample;
+    m_sampleFormat = m_formatHeader.audioFormat == WAVE_FORMAT_IEEE_FLOAT ? SampleFormat::Float : SampleFormat::PCM;
+    m_codec = findCodec(m_bitDepth, m_sampleFormat, m_nChannels);
+
+    return true;
+}
+
+// allocates a zeroed buffer for the audio data, releasing any mapping
+// or samples shared with a copy
+void WaveFile::allocate(uint64_t size) {
+    m_samples.reset(new SampleBuffer(static_cast<size_t>(size)));
+    m_data = m_samples->data();
+    m_exposed = false;
+    m_readOnly = false;
+}
+
+// Called before the samples are changed.  Samples shared with a copy of
+// this object, or mapped read only by a copy, are copied to a private
+// buffer first so that the change is not seen by the other objects.
+// Returns false if this object itself is a read only mapping.
+bool WaveFile::detach() {
+    if (m_readOnly) {
+        sampleError(WaveError::ReadOnly, "Wave file is read only");
+        return false;
+    }
+    if (m_samples && (m_samples.use_count() > 1 || !m_samples->writable())) {
+        m_samples = m_samples->clone();
+        m_data = m_samples->data();
+    }
+    return true;
+}
+
+// a pointer from floatData() or doubleData() may be written through at
+// any time, so once one is handed out, sharing is no longer safe
+shared_ptr<SampleBuffer> WaveFile::shareSamples() const {
+    if (m_exposed && m_samples) {
+        return m_samples->clone();
+    }
+    return m_samples;
+}
+
+// the problems counted so far
+WaveCounters WaveFile::counters() const {
+    WaveCounters counters;
+    counters.clipped = m_clipped.load(memory_order_relaxed);
+    counters.outOfRange = m_outOfRange.load(memory_order_relaxed);
+    counters.invalid = m_invalid.load(memory_order_relaxed);
+    return counters;
+}
+
+void WaveFile::resetCounters() {
+    m_clipped.store(0, memory_order_relaxed);
+    m_outOfRange.store(0, memory_order_relaxed);
+    m_invalid.store(0, memory_order_relaxed);
+}
+
+// A bad index in a processing loop fails once for every sample, so
+// rather than flooding the log the error is counted, and only logged the
+// first time, until the counters are reset.
+void WaveFile::sampleError(WaveError error, const char *message) const {
+    m_lastError.store(error, memory_order_relaxed);
+    atomic<uint64_t> &counter = error == WaveError::OutOfRange ? m_outOfRange : m_invalid;
+    if (counter.fetch_add(1, memory_order_relaxed) == 0) {
+        logMessage(LogLevel::Warning, message, ", further errors of this kind are only counted");
+    }
 }
@@ -0,0 +1,169 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- WaveHeaderIO --
+
+    Reading and filling in the wave headers.
+*/
+
+#include "WaveHeaderIO.h"
+
+#include <algorithm>
+#include "Log.h"
+#include "SampleConversion.h"
+#include "util.h"
+
+// reads the riff, format and data headers, leaving inFile at the
+// start of the audio data, returns true if successful
+bool readWaveHeaders(istream &inFile, RiffHeader &riffHeader, Ds64Chunk &ds64Chunk,
+                     WaveFormatHeader &formatHeader, WaveDataHeader &dataHeader) {
+    ChunkIndex chunks;
+    return readWaveHeaders(inFile, riffHeader, ds64Chunk, formatHeader, dataHeader, chunks);
+}
+
+// the same as above, but also keeps the index of every chunk in the file
+bool readWaveHeaders(istream &inFile, RiffHeader &riffHeader, Ds64Chunk &ds64Chunk,
+                     WaveFormatHeader &formatHeader, WaveDataHeader &dataHeader,
+                     ChunkIndex &chunks, WaveError *error, bool quiet) {
+    // logs a rejected header and records why
+    auto reject = [error, quiet](WaveError reason, const auto &...message) {
+        if (!quiet) {
+            logMessage(LogLevel::Error, message...);
+        }
+        if (error != nullptr) {
+            *error = reason;
+        }
+        return false;
+    };
+
+    inFile.read(reinterpret_cast<char *>(&riffHeader), sizeof(RiffHeader));
+
+    // first check to ensure a valid wave file, BW64 is the broadcast name for RF64
+    if (!inFile || !(wordCompare(riffHeader.chunkID, "RIFF") || wordCompare(riffHeader.chunkID, "RF64")
+                     || wordCompare(riffHeader.chunkID, "BW64"))) {
+        return reject(WaveError::FormatError, "File format error: missing RIFF header");
+    }
+    if (!wordCompare(riffHeader.format, "WAVE")) {
+        return reject(WaveError::FormatError, "File format error: missing WAVE format");
+    }
+
+    // follow the chunk sizes rather than searching for the headers,
+    // this way chunk data can never be mistaken for a header
+    chunks.build(inFile);
+
+    const ChunkInfo *format = chunks.find("fmt ");
+    if (format == nullptr || format->size < sizeof(WaveFormatHeader) - 8) {
+        return reject(WaveError::FormatError, "File format error: missing format header");
+    }
+
+    // the id and size are already known, only the fields after them are read
+    inFile.seekg(static_cast<streamoff>(format->offset));
+    inFile.read(reinterpret_cast<char *>(&formatHeader.audioFormat), sizeof(WaveFormatHeader) - 8);
+    if (!inFile) {
+        return reject(WaveError::FormatError, "File format error: missing format header");
+    }
+
+    // an extensible wave keeps the real audioFormat in the first two bytes of
+    // its sub format, once that is known it is treated like any other wave
+    if (formatHeader.audioFormat == WAVE_FORMAT_EXTENSIBLE
+            && format->size >= sizeof(WaveFormatHeader) - 8 + sizeof(WaveFormatExtension)) {
+        WaveFormatExtension extension;
+        inFile.read(reinterpret_cast<char *>(&extension), sizeof(WaveFormatExtension));
+        if (!inFile) {
+            return reject(WaveError::FormatError, "File format error: missing format extension");
+        }
+        formatHeader.audioFormat = extension.subFormat[0] | (extension.subFormat[1] << 8);
+    }
+
+    // standard PCM waves and 32 or 64-bit float waves are supported
+    bool isPCM = formatHeader.audioFormat == WAVE_FORMAT_PCM;
+    bool isFloat = formatHeader.audioFormat == WAVE_FORMAT_IEEE_FLOAT;
+    if (!isPCM && !isFloat) {
+        return reject(WaveError::UnsupportedFormat, "Incompatible wave format:", formatHeader.audioFormat);
+    }
+    if (!isSupportedFormat(isFloat ? SampleFormat::Float : SampleFormat::PCM, formatHeader.bitsPerSample)) {
+        return reject(WaveError::UnsupportedFormat, "Incompatible bit depth:", formatHeader.bitsPerSample);
+    }
+
+    const ChunkInfo *data = chunks.find("data");
+    if (data == nullptr) {
+        return reject(WaveError::FormatError, "File format error: missing data header");
+    }
+    inFile.seekg(static_cast<streamoff>(data->offset));
+
+    // any extra format parameters and other chunks are not written back out,
+    // so the sizes are recalculated for just the headers, this also decides
+    // whether the file still needs to be an RF64 file
+    // extensible waves are written back as plain PCM or float waves
+    if (formatHeader.blockAlign == 0) {
+        return reject(WaveError::FormatError, "File format error: invalid block align");
+    }
+    fillWaveHeaders(data->size / formatHeader.blockAlign, formatHeader.sampleRate,
+                    formatHeader.numChannels, formatHeader.bitsPerSample,
+                    riffHeader, ds64Chunk, formatHeader, dataHeader);
+
+    return true;
+}
+
+// writes the headers in the order they appear in a wave file,
+// the ds64 chunk is only written if ds64Chunk is not null
+void writeWaveHeaders(ostream &outFile, const RiffHeader &riffHeader, const Ds64Chunk *ds64Chunk,
+                      const WaveFormatHeader &formatHeader, const WaveDataHeader &dataHeader) {
+    outFile.write(reinterpret_cast<const char *>(&riffHeader), sizeof(RiffHeader));
+    if (ds64Chunk != nullptr) {
+        outFile.write(reinterpret_cast<const char *>(ds64Chunk), sizeof(Ds64Chunk));
+    }
+    outFile.write(reinterpret_cast<const char *>(&formatHeader), sizeof(WaveFormatHeader));
+    outFile.write(reinterpret_cast<const char *>(&dataHeader), sizeof(WaveDataHeader));
+}
+
+// recalculates every size and rate in the headers from the core attributes,
+// the audioFormat is left as it is
+// returns true if the sizes need 64 bits, in which case the RIFF header
+// becomes an RF64 header and the ds64 chunk must be written
+bool fillWaveHeaders(uint64_t length, uint32_t sampleRate, uint16_t nChannels, uint16_t bitDepth,
+                     RiffHeader &riffHeader, Ds64Chunk &ds64Chunk,
+                     WaveFormatHeader &formatHeader, WaveDataHeader &dataHeader,
+                     bool reserveDs64) {
+    formatHeader.subChunk1Size = sizeof(WaveFormatHeader)
+        - sizeof(formatHeader.subChunk1ID) - sizeof(formatHeader.subChunk1Size);
+    formatHeader.numChannels = nChannels;
+    formatHeader.sampleRate = sampleRate;
+    formatHeader.byteRate = sampleRate * nChannels * (bitDepth / 8);
+    formatHeader.blockAlign = nChannels * (bitDepth / 8);
+    formatHeader.bitsPerSample = bitDepth;
+
+    uint64_t dataSize = length * formatHeader.blockAlign;
+    uint64_t riffSize = dataSize + WAVE_HEADER_SIZE
+        - sizeof(riffHeader.chunkID) - sizeof(riffHeader.chunkSize);
+    if (reserveDs64) {
+        riffSize += sizeof(Ds64Chunk);
+    }
+
+    bool isRF64 = riffSize >= RF64_SIZE_MARKER;
+    if (isRF64 && !reserveDs64) {
+        riffSize += sizeof(Ds64Chunk);
+    }
+
+    ds64Chunk.chunkSize = sizeof(Ds64Chunk) - sizeof(ds64Chunk.chunkID) - sizeof(ds64Chunk.chunkSize);
+    ds64Chunk.riffSize = riffSize;
+    ds64Chunk.dataSize = dataSize;
+    ds64Chunk.sampleCount = length;
+    ds64Chunk.tableLength = 0;
+
+    if (isRF64) {
+        copy_n("RF64", 4, riffHeader.chunkID);
+        copy_n("ds64", 4, ds64Chunk.chunkID);
+        riffHeader.chunkSize = RF64_SIZE_MARKER;
+        dataHeader.subChunk2Size = RF64_SIZE_MARKER;
+    } else {
+        // a reserved ds64 chunk is written as JUNK so that readers skip it
+        copy_n("RIFF", 4, riffHeader.chunkID);
+        copy_n("JUNK", 4, ds64Chunk.chunkID);
+        riffHeader.chunkSize = static_cast<uint32_t>(riffSize);
+        dataHeader.subChunk2Size = static_cast<uint32_t>(dataSize);
+    }
+
+    return isRF64;
+}
@@ -0,0 +1,94 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- WaveScanner --
+
+    Finds wave files and probes their headers on a ThreadPool.
+*/
+
+#include "WaveScanner.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+
+bool isWaveFile(const filesystem::path &path) {
+    string extension = path.extension().string();
+    transform(extension.begin(), extension.end(), extension.begin(),
+              [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return extension == ".wav";
+}
+
+// adds the wave files in directory to fileNames
+template <typename Iterator>
+bool findWaveFiles(const string &directory, vector<string> &fileNames) {
+    error_code error;
+    Iterator entry(directory, filesystem::directory_options::skip_permission_denied, error);
+    for (; !error && entry != Iterator(); entry.increment(error)) {
+        // the type comes from the directory listing, so this does not stat the file
+        if (entry->is_regular_file(error) && isWaveFile(entry->path())) {
+            fileNames.push_back(entry->path().string());
+        }
+    }
+    return !error;
+}
+
+} // namespace
+
+void WaveCatalog::clear() {
+    paths.clear();
+    info.clear();
+    failed.clear();
+}
+
+WaveScanner::WaveScanner(ThreadPool &pool, size_t grain):
+    m_pool(pool), m_grain(max<size_t>(grain, 1))
+{
+}
+
+// probes every .wav file in a directory
+// returns false if the directory could not be read
+bool WaveScanner::scan(string directory, WaveCatalog &catalog, bool recursive) const {
+    catalog.clear();
+
+    vector<string> fileNames;
+    bool found = recursive ? findWaveFiles<filesystem::recursive_directory_iterator>(directory, fileNames)
+                           : findWaveFiles<filesystem::directory_iterator>(directory, fileNames);
+    if (!found) {
+        logMessage(LogLevel::Error, "Cannot read directory: ", directory);
+        return false;
+    }
+
+    probe(fileNames, catalog);
+    return true;
+}
+
+// probes a list of files, each task fills in its own rows so no locking is needed
+void WaveScanner::probe(const vector<string> &fileNames, WaveCatalog &catalog) const {
+    catalog.clear();
+
+    vector<WaveInfo> info(fileNames.size());
+    vector<uint8_t> probed(fileNames.size());
+    m_pool.parallelFor(0, fileNames.size(), m_grain, [&](uint64_t first, uint64_t last) {
+        for (uint64_t i = first; i < last; ++i) {
+            probed[i] = WaveFile::probe(fileNames[i], info[i]);
+        }
+    });
+
+    size_t count = static_cast<size_t>(count_if(probed.begin(), probed.end(), [](uint8_t ok) { return ok; }));
+    catalog.paths.reserve(count);
+    catalog.info.reserve(count);
+    for (size_t i = 0; i < fileNames.size(); ++i) {
+        if (probed[i]) {
+            catalog.paths.push_back(fileNames[i]);
+            catalog.info.push_back(info[i]);
+        } else {
+            catalog.failed.push_back(fileNames[i]);
+        }
+    }
+}
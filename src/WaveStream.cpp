@@ -0,0 +1,221 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- WaveStream --
+
+    WaveStreamReader and WaveStreamWriter process a wave file a block
+    at a time instead of holding all of it in memory like a WaveFile.
+*/
+
+#include "WaveStream.h"
+
+#include <algorithm>
+#include "Log.h"
+#include "SampleConversion.h"
+#include "WaveHeaderIO.h"
+
+/* WaveStreamReader */
+
+WaveStreamReader::WaveStreamReader(uint32_t blockFrames):
+    m_file{}, m_riffHeader{}, m_ds64Chunk{}, m_formatHeader{}, m_dataHeader{},
+    m_block{}, m_blockFrames(max(blockFrames, 1u)), m_dataStart{}, m_position{},
+    m_length{}, m_sampleRate{}, m_nChannels{}, m_bitDepth{}, m_sampleFormat{SampleFormat::PCM}
+{
+}
+
+WaveStreamReader::WaveStreamReader(string fileName, uint32_t blockFrames):
+    WaveStreamReader(blockFrames)
+{
+    open(fileName);
+}
+
+// opens a wave file and reads its headers, returns true if successful
+bool WaveStreamReader::open(string inFileName) {
+    close();
+    m_file.open(inFileName, ios::binary);
+
+    if (!m_file) {
+        logMessage(LogLevel::Error, "Cannot open file: ", inFileName);
+        return false;
+    }
+
+    if (!readWaveHeaders(m_file, m_riffHeader, m_ds64Chunk, m_formatHeader, m_dataHeader)) {
+        close();
+        return false;
+    }
+
+    m_dataStart = m_file.tellg();
+    m_position = 0;
+
+    m_nChannels = m_formatHeader.numChannels;
+    m_sampleRate = m_formatHeader.sampleRate;
+    m_bitDepth = m_formatHeader.bitsPerSample;
+    m_sampleFormat = m_formatHeader.audioFormat == WAVE_FORMAT_IEEE_FLOAT ? SampleFormat::Float : SampleFormat::PCM;
+    m_length = m_ds64Chunk.sampleCount;
+
+    m_block.resize(static_cast<size_t>(m_blockFrames) * m_formatHeader.blockAlign);
+
+    return true;
+}
+
+void WaveStreamReader::close() {
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+    m_file.clear();
+    m_position = 0;
+    m_length = 0;
+}
+
+// reads up to frames frames of interleaved floats into out,
+// returns the number of frames read, 0 at the end of the file
+uint32_t WaveStreamReader::read(float *out, uint32_t frames) {
+    if (!m_file.is_open()) {
+        return 0;
+    }
+    frames = static_cast<uint32_t>(min<uint64_t>(frames, m_length - m_position));
+
+    uint32_t framesRead = 0;
+    while (framesRead < frames) {
+        uint32_t count = min(frames - framesRead, m_blockFrames);
+        m_file.read(reinterpret_cast<char *>(m_block.data()),
+                    static_cast<streamsize>(count) * m_formatHeader.blockAlign);
+
+        // a truncated file only yields the frames that were actually there
+        count = static_cast<uint32_t>(m_file.gcount() / m_formatHeader.blockAlign);
+        if (count == 0) {
+            break;
+        }
+
+        pcmToFloat(m_block.data(), out + static_cast<size_t>(framesRead) * m_nChannels,
+                   static_cast<size_t>(count) * m_nChannels, m_bitDepth, m_sampleFormat);
+        framesRead += count;
+    }
+
+    m_position += framesRead;
+    return framesRead;
+}
+
+// moves to a frame within the file, returns true if successful
+bool WaveStreamReader::seek(uint64_t frame) {
+    if (!m_file.is_open() || frame > m_length) {
+        return false;
+    }
+
+    m_file.clear();
+    m_file.seekg(m_dataStart + static_cast<streamoff>(frame) * m_formatHeader.blockAlign);
+    if (!m_file) {
+        return false;
+    }
+
+    m_position = frame;
+    return true;
+}
+
+/* WaveStreamWriter */
+
+WaveStreamWriter::WaveStreamWriter(uint32_t blockFrames):
+    m_file{}, m_fileName{}, m_riffHeader{}, m_ds64Chunk{}, m_formatHeader{}, m_dataHeader{},
+    m_block{}, m_blockFrames(max(blockFrames, 1u)),
+    m_length{}, m_sampleRate{}, m_nChannels{}, m_bitDepth{}, m_sampleFormat{SampleFormat::PCM}
+{
+}
+
+WaveStreamWriter::WaveStreamWriter(string fileName, uint32_t sampleRate, uint16_t nChannels,
+                                   uint16_t bitDepth, SampleFormat sampleFormat, uint32_t blockFrames):
+    WaveStreamWriter(blockFrames)
+{
+    open(fileName, sampleRate, nChannels, bitDepth, sampleFormat);
+}
+
+WaveStreamWriter::~WaveStreamWriter() {
+    close();
+}
+
+// creates a new wave file, returns true if successful
+bool WaveStreamWriter::open(string outFileName, uint32_t sampleRate, uint16_t nChannels,
+                            uint16_t bitDepth, SampleFormat sampleFormat) {
+    close();
+
+    if (!isSupportedFormat(sampleFormat, bitDepth)) {
+        logMessage(LogLevel::Error, "Invalid bit depth");
+        return false;
+    }
+    if (nChannels == 0) {
+        logMessage(LogLevel::Error, "Invalid number of channels");
+        return false;
+    }
+
+    m_file.open(outFileName, ios::binary);
+
+    if (!m_file) {
+        logMessage(LogLevel::Error, "Cannot create file: ", outFileName);
+        return false;
+    }
+
+    logMessage(LogLevel::Info, "Writing to file: ", outFileName);
+
+    m_fileName = outFileName;
+    m_length = 0;
+    m_sampleRate = sampleRate;
+    m_nChannels = nChannels;
+    m_bitDepth = bitDepth;
+    m_sampleFormat = sampleFormat;
+    m_formatHeader.audioFormat = sampleFormat == SampleFormat::Float ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+
+    // the sizes are placeholders until close() patches them, the reserved
+    // ds64 chunk lets the file become an RF64 file without moving the data
+    fillWaveHeaders(m_length, m_sampleRate, m_nChannels, m_bitDepth,
+                    m_riffHeader, m_ds64Chunk, m_formatHeader, m_dataHeader, true);
+    writeWaveHeaders(m_file, m_riffHeader, &m_ds64Chunk, m_formatHeader, m_dataHeader);
+
+    m_block.resize(static_cast<size_t>(m_blockFrames) * m_formatHeader.blockAlign);
+
+    return static_cast<bool>(m_file);
+}
+
+// patches the header sizes and closes the file, returns true if successful
+bool WaveStreamWriter::close() {
+    if (!m_file.is_open()) {
+        return true;
+    }
+
+    fillWaveHeaders(m_length, m_sampleRate, m_nChannels, m_bitDepth,
+                    m_riffHeader, m_ds64Chunk, m_formatHeader, m_dataHeader, true);
+    m_file.seekp(0);
+    writeWaveHeaders(m_file, m_riffHeader, &m_ds64Chunk, m_formatHeader, m_dataHeader);
+    m_file.close();
+
+    if (!m_file) {
+        logMessage(LogLevel::Error, "Error closing file: ", m_fileName);
+        m_file.clear();
+        return false;
+    }
+
+    return true;
+}
+
+// appends frames frames of interleaved floats, PCM values are clamped
+// between 1 and -1, returns the number of frames written
+uint32_t WaveStreamWriter::write(const float *in, uint32_t frames) {
+    if (!m_file.is_open()) {
+        return 0;
+    }
+
+    uint32_t framesWritten = 0;
+    while (framesWritten < frames) {
+        uint32_t count = min(frames - framesWritten, m_blockFrames);
+        floatToPcm(in + static_cast<size_t>(framesWritten) * m_nChannels, m_block.data(),
+                   static_cast<size_t>(count) * m_nChannels, m_bitDepth, m_sampleFormat);
+        m_file.write(reinterpret_cast<const char *>(m_block.data()),
+                     static_cast<streamsize>(count) * m_formatHeader.blockAlign);
+        if (!m_file) {
+            break;
+        }
+        framesWritten += count;
+    }
+
+    m_length += framesWritten;
+    return framesWritten;
+}
@@ -0,0 +1,385 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- WaveView --
+
+    Slices of the samples of a WaveFile, and lists of slices joined
+    end to end, that are read and written without copying the wave.
+*/
+
+#include "WaveView.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "Log.h"
+#include "WaveHeaderIO.h"
+
+namespace {
+
+// views of only some channels are gathered this many frames at a time
+const size_t CHUNK_FRAMES = 4096;
+
+// writes the headers of a wave file holding length frames
+void writeHeaders(ostream &outFile, uint64_t length, uint32_t sampleRate, uint16_t nChannels,
+                  uint16_t bitDepth, SampleFormat sampleFormat) {
+    RiffHeader riffHeader{};
+    Ds64Chunk ds64Chunk{};
+    WaveFormatHeader formatHeader{};
+    WaveDataHeader dataHeader{};
+    formatHeader.audioFormat = sampleFormat == SampleFormat::Float ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
+    bool rf64 = fillWaveHeaders(length, sampleRate, nChannels, bitDepth,
+                                riffHeader, ds64Chunk, formatHeader, dataHeader);
+    writeWaveHeaders(outFile, riffHeader, rf64 ? &ds64Chunk : nullptr, formatHeader, dataHeader);
+}
+
+} // namespace
+
+/* WaveView */
+
+WaveView::WaveView():
+    m_samples{}, m_data{nullptr}, m_channels{}, m_stride{}, m_contiguous{true},
+    m_length{}, m_sampleRate{}, m_bitDepth{}, m_sampleFormat{SampleFormat::PCM}, m_codec{nullptr}
+{
+}
+
+// a view of the whole wave
+WaveView::WaveView(const WaveFile &wave):
+    WaveView(wave, 0, wave.length())
+{
+}
+
+// a view of length frames of the wave from start, cut short at its end
+WaveView::WaveView(const WaveFile &wave, uint64_t start, uint64_t length): WaveView()
+{
+    if (wave.m_data == nullptr) {
+        return;
+    }
+    start = min(start, wave.length());
+
+    m_samples = wave.shareSamples();
+    m_stride = static_cast<size_t>(wave.nChannels()) * (wave.bitDepth() / 8);
+    m_data = m_samples->data() + start * m_stride;
+    m_channels.resize(wave.nChannels());
+    for (uint16_t c = 0; c < wave.nChannels(); ++c) {
+        m_channels[c] = c;
+    }
+
+    m_length = min(length, wave.length() - start);
+    m_sampleRate = wave.sampleRate();
+    m_bitDepth = wave.bitDepth();
+    m_sampleFormat = wave.sampleFormat();
+    m_codec = findCodec(m_bitDepth, m_sampleFormat, nChannels());
+}
+
+// a view of part of this view, cut short at its end
+WaveView WaveView::slice(uint64_t start, uint64_t length) const {
+    WaveView view(*this);
+    start = min(start, m_length);
+    if (m_data != nullptr) {
+        view.m_data = m_data + start * m_stride;
+    }
+    view.m_length = min(length, m_length - start);
+    return view;
+}
+
+// a view of some of the channels of this view
+WaveView WaveView::select(const vector<uint16_t> &channels) const {
+    WaveView view(*this);
+    view.m_channels.clear();
+    for (uint16_t channel : channels) {
+        if (channel >= m_channels.size()) {
+            logMessage(LogLevel::Error, "Invalid channel: ", channel);
+            return WaveView();
+        }
+        view.m_channels.push_back(m_channels[channel]);
+    }
+
+    // the frames are still contiguous if every channel of the wave is
+    // used in its own place
+    size_t waveChannels = m_bitDepth >= 8 ? m_stride / (m_bitDepth / 8) : 0;
+    view.m_contiguous = view.m_channels.size() == waveChannels;
+    for (size_t c = 0; c < view.m_channels.size() && view.m_contiguous; ++c) {
+        view.m_contiguous = view.m_channels[c] == c;
+    }
+
+    view.m_codec = findCodec(m_bitDepth, m_sampleFormat, view.nChannels());
+    return view;
+}
+
+// cuts the view into segments of segmentFrames frames
+vector<WaveView> WaveView::split(uint64_t segmentFrames) const {
+    vector<WaveView> segments;
+    segmentFrames = max<uint64_t>(segmentFrames, 1);
+    for (uint64_t start = 0; start < m_length; start += segmentFrames) {
+        segments.push_back(slice(start, segmentFrames));
+    }
+    return segments;
+}
+
+// returns the first two channels of a stereo view, the first channel
+// otherwise, like WaveFile::getSample()
+AudioSample WaveView::getSample(uint64_t sample) const {
+    if (sample >= m_length) {
+        return AudioSample();
+    }
+    if (m_codec == nullptr) {
+        logMessage(LogLevel::Error, "Invalid bit depth");
+        return AudioSample(0, 0);
+    }
+
+    // only the channels readFrame() uses are gathered
+    uint8_t frame[16];
+    size_t bytesPerSample = m_bitDepth / 8;
+    const uint8_t *in = m_data + sample * m_stride;
+    for (size_t c = 0; c < min<size_t>(m_channels.size(), 2); ++c) {
+        memcpy(frame + c * bytesPerSample, in + m_channels[c] * bytesPerSample, bytesPerSample);
+    }
+
+    double left{};
+    double right{};
+    m_codec->readFrame(frame, left, right);
+    return AudioSample(left, right);
+}
+
+// count frames of interleaved floats, returns the number of frames copied
+uint32_t WaveView::getSamples(uint64_t start, uint32_t count, float *out) const {
+    if (start >= m_length) {
+        return 0;
+    }
+    count = static_cast<uint32_t>(min<uint64_t>(count, m_length - start));
+
+    vector<uint8_t> scratch;
+    size_t step = m_contiguous ? count : CHUNK_FRAMES;
+    for (size_t done = 0; done < count; done += step) {
+        size_t frames = min<size_t>(step, count - done);
+        if (!pcmToFloat(packed(start + done, frames, scratch), out + done * m_channels.size(),
+                        frames * m_channels.size(), m_bitDepth, m_sampleFormat)) {
+            logMessage(LogLevel::Error, "Invalid bit depth");
+            return 0;
+        }
+    }
+    return count;
+}
+
+// the buffer must have nChannels() channels, returns the number of frames copied
+size_t WaveView::readBuffer(uint64_t start, AudioBuffer &buffer, size_t frames) const {
+    if (buffer.nChannels() != nChannels()) {
+        logMessage(LogLevel::Error, "Channel count mismatch");
+        return 0;
+    }
+
+    vector<float *> channels(nChannels());
+    for (uint16_t c = 0; c < nChannels(); ++c) {
+        channels[c] = buffer.channel(c);
+    }
+    return readPlanar(start, channels.data(), min(frames, buffer.length()));
+}
+
+// reads up to frames frames into separate channel arrays
+size_t WaveView::readPlanar(uint64_t start, float *const *out, size_t frames) const {
+    if (start >= m_length) {
+        return 0;
+    }
+    size_t count = static_cast<size_t>(min<uint64_t>(frames, m_length - start));
+
+    vector<uint8_t> scratch;
+    vector<float *> channels(out, out + m_channels.size());
+    size_t step = m_contiguous ? count : CHUNK_FRAMES;
+    for (size_t done = 0; done < count; done += step) {
+        size_t chunk = min(step, count - done);
+        for (size_t c = 0; c < channels.size(); ++c) {
+            channels[c] = out[c] + done;
+        }
+        if (!pcmToPlanar(packed(start + done, chunk, scratch), channels.data(), chunk, nChannels(),
+                         m_bitDepth, m_sampleFormat)) {
+            logMessage(LogLevel::Error, "Invalid bit depth");
+            return 0;
+        }
+    }
+    return count;
+}
+
+// writes the view to a new wave file
+// returns true if successful
+bool WaveView::write(string outFileName) const {
+    ofstream outFile;
+    outFile.open(outFileName, ios::binary);
+
+    if (!outFile) {
+        logMessage(LogLevel::Error, "Cannot create file: ", outFileName);
+        return false;
+    }
+
+    logMessage(LogLevel::Info, "Writing to file: ", outFileName);
+
+    writeHeaders(outFile, m_length, m_sampleRate, nChannels(), m_bitDepth, m_sampleFormat);
+    writeData(outFile);
+    outFile.close();
+
+    if (!outFile) {
+        logMessage(LogLevel::Error, "Error closing file: ", outFileName);
+        return false;
+    }
+
+    return true;
+}
+
+// appends the packed samples of the view to a stream, a contiguous view
+// is written straight from the samples of the wave
+bool WaveView::writeData(ostream &outFile) const {
+    vector<uint8_t> scratch;
+    uint64_t step = m_contiguous ? m_length : CHUNK_FRAMES;
+    for (uint64_t done = 0; done < m_length && outFile; done += step) {
+        size_t frames = static_cast<size_t>(min(step, m_length - done));
+        outFile.write(reinterpret_cast<const char *>(packed(done, frames, scratch)),
+                      static_cast<streamsize>(frames * frameBytes()));
+    }
+    return static_cast<bool>(outFile);
+}
+
+// copies the view into a WaveFile of its own
+WaveFile WaveView::toWaveFile() const {
+    WaveFile wave(m_length, m_sampleRate, nChannels(), m_bitDepth, m_sampleFormat);
+
+    vector<uint8_t> scratch;
+    uint64_t step = m_contiguous ? m_length : CHUNK_FRAMES;
+    for (uint64_t done = 0; done < m_length; done += step) {
+        size_t frames = static_cast<size_t>(min(step, m_length - done));
+        memcpy(wave.m_data + done * frameBytes(), packed(done, frames, scratch), frames * frameBytes());
+    }
+    return wave;
+}
+
+// the packed samples of count frames from start
+const uint8_t* WaveView::packed(uint64_t start, size_t count, vector<uint8_t> &scratch) const {
+    const uint8_t *in = m_data + start * m_stride;
+    if (m_contiguous) {
+        return in;
+    }
+
+    size_t bytesPerSample = m_bitDepth / 8;
+    scratch.resize(count * frameBytes());
+    uint8_t *out = scratch.data();
+    for (size_t i = 0; i < count; ++i, in += m_stride) {
+        for (uint16_t channel : m_channels) {
+            memcpy(out, in + channel * bytesPerSample, bytesPerSample);
+            out += bytesPerSample;
+        }
+    }
+    return scratch.data();
+}
+
+/* WaveViewList */
+
+WaveViewList::WaveViewList():
+    m_views{}, m_starts{}, m_length{}
+{
+}
+
+// adds a view to the end, returns true if successful
+bool WaveViewList::append(const WaveView &view) {
+    if (!m_views.empty() && (view.sampleRate() != sampleRate() || view.nChannels() != nChannels()
+                             || view.bitDepth() != bitDepth() || view.sampleFormat() != sampleFormat())) {
+        logMessage(LogLevel::Error, "Wave view format does not match the list");
+        return false;
+    }
+
+    m_views.push_back(view);
+    m_starts.push_back(m_length);
+    m_length += view.length();
+    return true;
+}
+
+void WaveViewList::clear() {
+    m_views.clear();
+    m_starts.clear();
+    m_length = 0;
+}
+
+uint64_t WaveViewList::dataSize() const {
+    return m_views.empty() ? 0 : m_length * m_views.front().frameBytes();
+}
+
+// count frames of interleaved floats, returns the number of frames copied
+uint32_t WaveViewList::getSamples(uint64_t start, uint32_t count, float *out) const {
+    if (start >= m_length) {
+        return 0;
+    }
+    count = static_cast<uint32_t>(min<uint64_t>(count, m_length - start));
+
+    uint32_t done = 0;
+    for (size_t i = find(start); done < count; ++i) {
+        uint32_t copied = m_views[i].getSamples(start + done - m_starts[i], count - done,
+                                                out + static_cast<size_t>(done) * nChannels());
+        if (copied == 0 && m_views[i].length() > 0) {
+            return 0;
+        }
+        done += copied;
+    }
+    return count;
+}
+
+// the buffer must have nChannels() channels, returns the number of frames copied
+size_t WaveViewList::readBuffer(uint64_t start, AudioBuffer &buffer, size_t frames) const {
+    if (buffer.nChannels() != nChannels()) {
+        logMessage(LogLevel::Error, "Channel count mismatch");
+        return 0;
+    }
+    if (start >= m_length) {
+        return 0;
+    }
+    size_t count = static_cast<size_t>(min<uint64_t>(min(frames, buffer.length()), m_length - start));
+
+    vector<float *> channels(nChannels());
+    size_t done = 0;
+    for (size_t i = find(start); done < count; ++i) {
+        for (uint16_t c = 0; c < nChannels(); ++c) {
+            channels[c] = buffer.channel(c) + done;
+        }
+        size_t copied = m_views[i].readPlanar(start + done - m_starts[i], channels.data(), count - done);
+        if (copied == 0 && m_views[i].length() > 0) {
+            return 0;
+        }
+        done += copied;
+    }
+    return count;
+}
+
+// writes every view in turn to a new wave file
+// returns true if successful
+bool WaveViewList::write(string outFileName) const {
+    if (m_views.empty()) {
+        logMessage(LogLevel::Error, "Wave view list is empty");
+        return false;
+    }
+
+    ofstream outFile;
+    outFile.open(outFileName, ios::binary);
+
+    if (!outFile) {
+        logMessage(LogLevel::Error, "Cannot create file: ", outFileName);
+        return false;
+    }
+
+    logMessage(LogLevel::Info, "Writing to file: ", outFileName);
+
+    writeHeaders(outFile, m_length, sampleRate(), nChannels(), bitDepth(), sampleFormat());
+    for (const WaveView &view : m_views) {
+        view.writeData(outFile);
+    }
+    outFile.close();
+
+    if (!outFile) {
+        logMessage(LogLevel::Error, "Error closing file: ", outFileName);
+        return false;
+    }
+
+    return true;
+}
+
+// the index of the view holding a frame, frame must be less than m_length
+size_t WaveViewList::find(uint64_t frame) const {
+    return static_cast<size_t>(upper_bound(m_starts.begin(), m_starts.end(), frame) - m_starts.begin()) - 1;
+}
@@ -0,0 +1,406 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- wave_tests --
+
+    Checks of the library's behavior that are easy to get subtly
+    wrong.  Each test prints what failed and the program returns
+    non-zero if any of them did, so it can be run by ctest.
+
+    usage: wave_tests
+*/
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include "WaveFile.h"
+#include "WaveView.h"
+#include "ParallelProcessor.h"
+#include "Mixer.h"
+#include "Convolver.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const string &test, const string &message) {
+    if (!ok) {
+        cout << test << ": " << message << endl;
+        ++failures;
+    }
+}
+
+// an 8-bit wave holding every value once, in one channel
+WaveFile every8BitValue() {
+    WaveFile wave(256, 44100, 1, 8);
+    vector<int32_t> values(256);
+    for (int32_t i = 0; i < 256; ++i) {
+        values[i] = i;
+    }
+    wave.setSamples(0, 256, values.data());
+    return wave;
+}
+
+// 8-bit samples are unsigned, so 128 is silence and has to stay
+// silence in a signed format, every value has to come back exactly
+// from PCM and within a step from float, which is truncated when written
+void test8BitRoundTrip(uint16_t bitDepth, SampleFormat format) {
+    string test = "8-bit to " + to_string(bitDepth) + "-bit "
+                + (format == SampleFormat::Float ? "float" : "PCM") + " and back";
+    WaveFile wave = every8BitValue();
+
+    if (!wave.convertBitDepth(bitDepth, format, DitherMode::None)) {
+        check(false, test, "conversion failed");
+        return;
+    }
+    vector<double> converted(256);
+    wave.getSamples(0, 256, converted.data());
+    check(converted[0] <= -0.999, test, "0 is not converted to -1");
+    // 128 is silence, so 255 becomes 127 / 128, just short of 1
+    check(converted[255] >= 0.99, test, "255 is not converted to 1");
+    check(converted[128] == 0.0, test, "128 is not converted to silence");
+
+    if (!wave.convertBitDepth(8, SampleFormat::PCM, DitherMode::None)) {
+        check(false, test, "conversion back failed");
+        return;
+    }
+    vector<int32_t> values(256);
+    wave.getSamples(0, 256, values.data());
+    int32_t tolerance = format == SampleFormat::Float ? 1 : 0;
+    for (int32_t i = 0; i < 256; ++i) {
+        if (abs(values[i] - i) > tolerance) {
+            check(false, test, to_string(i) + " came back as " + to_string(values[i]));
+            break;
+        }
+    }
+}
+
+// silence in a signed format has to become 128 in an 8-bit wave
+void testSilenceTo8Bit(uint16_t bitDepth, SampleFormat format) {
+    string test = to_string(bitDepth) + "-bit "
+                + (format == SampleFormat::Float ? "float" : "PCM") + " silence to 8-bit";
+    WaveFile wave(16, 44100, 1, bitDepth, format);
+
+    if (!wave.convertBitDepth(8, SampleFormat::PCM, DitherMode::None)) {
+        check(false, test, "conversion failed");
+        return;
+    }
+    vector<int32_t> values(16);
+    wave.getSamples(0, 16, values.data());
+    for (int32_t value : values) {
+        if (value < 127 || value > 128) {
+            check(false, test, "silence came back as " + to_string(value));
+            break;
+        }
+    }
+}
+
+// a float only holds 24 bits, so 32-bit PCM samples have to come back
+// from 64-bit float within a step
+void test32BitRoundTrip() {
+    string test = "32-bit PCM to 64-bit float and back";
+    const vector<int32_t> original = {0, 1, -1, 123456789, -987654321, 2147483000, -2147483000};
+    size_t count = original.size();
+    WaveFile wave(count, 44100, 1, 32);
+    wave.setSamples(0, static_cast<uint32_t>(count), original.data());
+
+    if (!wave.convertBitDepth(64, SampleFormat::Float, DitherMode::None)
+            || !wave.convertBitDepth(32, SampleFormat::PCM, DitherMode::None)) {
+        check(false, test, "conversion failed");
+        return;
+    }
+    vector<int32_t> values(count);
+    wave.getSamples(0, static_cast<uint32_t>(count), values.data());
+    for (size_t i = 0; i < count; ++i) {
+        if (abs(static_cast<int64_t>(values[i]) - original[i]) > 1) {
+            check(false, test, to_string(original[i]) + " came back as " + to_string(values[i]));
+            break;
+        }
+    }
+}
+
+// widening PCM is a shift, so narrowing again without dither has to
+// give back exactly the samples it started with
+void test16BitRoundTrip() {
+    string test = "16-bit to 24-bit PCM and back";
+    const vector<int32_t> original = {0, 1, -1, 16384, -16384, 32767, -32768, 12345};
+    uint32_t count = static_cast<uint32_t>(original.size());
+    WaveFile wave(count, 44100, 1, 16);
+    wave.setSamples(0, count, original.data());
+
+    if (!wave.convertBitDepth(24)) {
+        check(false, test, "conversion failed");
+        return;
+    }
+    vector<int32_t> values(count);
+    wave.getSamples(0, count, values.data());
+    for (uint32_t i = 0; i < count; ++i) {
+        if (values[i] != original[i] * 256) {
+            check(false, test, to_string(original[i]) + " was widened to " + to_string(values[i]));
+            break;
+        }
+    }
+
+    if (!wave.convertBitDepth(16, SampleFormat::PCM, DitherMode::None)) {
+        check(false, test, "conversion back failed");
+        return;
+    }
+    wave.getSamples(0, count, values.data());
+    check(values == original, test, "the samples did not come back identical");
+}
+
+// NaN has to be converted as 0 by the vector loops and the scalar tail
+void testNaNToPcm() {
+    const size_t n = 37;
+    vector<float> nan(n, numeric_limits<float>::quiet_NaN());
+    vector<uint8_t> out(n * 4);
+    for (uint16_t bitDepth : {8, 16, 24, 32}) {
+        string test = "NaN to " + to_string(bitDepth) + "-bit PCM";
+        fill(out.begin(), out.end(), 0xff);
+        floatToPcm(nan.data(), out.data(), n, bitDepth, SampleFormat::PCM);
+        size_t bytes = n * (bitDepth / 8);
+        check(all_of(out.begin(), out.begin() + bytes, [](uint8_t b) { return b == 0; }),
+              test, "NaN was not converted as 0");
+    }
+}
+
+// a wave without a format has nothing to convert, and one without
+// frames just changes its format
+void testConvertEmpty() {
+    string test = "convertBitDepth() of empty waves";
+    WaveFile none;
+    check(!none.convertBitDepth(16) && none.lastError() == WaveError::FormatError,
+          test, "a default constructed wave was converted");
+
+    WaveFile empty(0, 44100, 2, 16);
+    check(empty.convertBitDepth(24) && empty.bitDepth() == 24, test, "a wave with no frames was not converted");
+}
+
+// writing through floatData() must not change copies made after it
+void testFloatDataCopies() {
+    string test = "floatData() and later copies";
+    WaveFile wave(16, 44100, 1, 32, SampleFormat::Float);
+    float *samples = wave.floatData();
+    if (samples == nullptr) {
+        check(false, test, "no float data");
+        return;
+    }
+    WaveFile copy(wave);
+    WaveView view(wave);
+    samples[0] = 0.5f;
+
+    float value = 0;
+    copy.getSamples(0, 1, &value);
+    check(value == 0.0f, test, "the copy changed");
+    view.getSamples(0, 1, &value);
+    check(value == 0.0f, test, "the view changed");
+    wave.getSamples(0, 1, &value);
+    check(value == 0.5f, test, "the wave did not change");
+}
+
+// probe() has to find the same format and data as read(), also when a
+// chunk before the data is larger than the block it reads at a time
+void testProbeMatchesRead() {
+    string test = "probe() and read()";
+    filesystem::path path = filesystem::temp_directory_path() / "wave_tests_probe.wav";
+    WaveFile wave(1000, 48000, 2, 24);
+    if (!wave.write(path.string())) {
+        check(false, test, "cannot write " + path.string());
+        return;
+    }
+
+    // put a LIST chunk between the format and data chunks
+    vector<char> bytes(filesystem::file_size(path));
+    ifstream(path, ios::binary).read(bytes.data(), bytes.size());
+    const uint32_t listSize = 1000;
+    vector<char> list(8 + listSize, 0);
+    copy_n("LIST", 4, list.begin());
+    memcpy(&list[4], &listSize, sizeof(listSize));
+    bytes.insert(bytes.begin() + 36, list.begin(), list.end());
+    uint32_t riffSize;
+    memcpy(&riffSize, &bytes[4], sizeof(riffSize));
+    riffSize += static_cast<uint32_t>(list.size());
+    memcpy(&bytes[4], &riffSize, sizeof(riffSize));
+    ofstream(path, ios::binary).write(bytes.data(), bytes.size());
+
+    WaveInfo info;
+    WaveFile read;
+    bool probed = WaveFile::probe(path.string(), info);
+    bool ok = read.read(path.string());
+    filesystem::remove(path);
+    if (!probed || !ok) {
+        check(false, test, probed ? "read failed" : "probe failed");
+        return;
+    }
+    check(info.length == read.length(), test, "the lengths differ");
+    check(info.dataOffset == 44 + list.size(), test, "wrong data offset " + to_string(info.dataOffset));
+    check(info.sampleRate == read.sampleRate() && info.nChannels == read.nChannels()
+          && info.bitDepth == read.bitDepth() && info.sampleFormat == read.sampleFormat(),
+          test, "the formats differ");
+}
+
+// saving a mapped wave over the file it was mapped from must not
+// destroy the samples it is still reading from that file
+void testWriteOverMappedFile() {
+    string test = "write() over a mapped file";
+    filesystem::path path = filesystem::temp_directory_path() / "wave_tests_mapped.wav";
+    const uint32_t frames = 200000;
+    vector<int32_t> original(frames * 2);
+    for (size_t i = 0; i < original.size(); ++i) {
+        original[i] = static_cast<int32_t>(i % 20000) - 10000;
+    }
+    WaveFile wave(frames, 44100, 2, 16);
+    wave.setSamples(0, frames, original.data());
+    if (!wave.write(path.string())) {
+        check(false, test, "cannot write " + path.string());
+        return;
+    }
+
+    WaveFile mapped;
+    if (!mapped.map(path.string())) {
+        // memory mapping is not available everywhere
+        filesystem::remove(path);
+        return;
+    }
+    const int32_t changed[2] = {1234, -1234};
+    mapped.setSamples(0, 1, changed);
+    bool written = mapped.write(path.string());
+
+    WaveFile result;
+    bool ok = result.read(path.string());
+    filesystem::remove(path);
+    if (!written || !ok || result.length() != frames) {
+        check(false, test, written ? "the file cannot be read back" : "write failed");
+        return;
+    }
+    original[0] = changed[0];
+    original[1] = changed[1];
+    vector<int32_t> values(original.size());
+    result.getSamples(0, frames, values.data());
+    check(values == original, test, "the samples were not saved");
+}
+
+// the kernels of a ParallelProcessor see 8-bit samples from -1 to 1
+void testParallel8Bit() {
+    string test = "ParallelProcessor on 8-bit waves";
+    ThreadPool pool(2);
+    ParallelProcessor processor(pool, 64);
+
+    WaveFile silence(1000, 44100, 1, 8);
+    vector<int32_t> values(1000, 128);
+    silence.setSamples(0, 1000, values.data());
+    processor.invert(silence);
+    silence.getSamples(0, 1000, values.data());
+    check(all_of(values.begin(), values.end(), [](int32_t v) { return v == 128; }),
+          test, "inverted silence came back as " + to_string(values[0]));
+
+    WaveFile converted;
+    processor.convert(silence, converted, 16);
+    converted.getSamples(0, 1000, values.data());
+    check(all_of(values.begin(), values.end(), [](int32_t v) { return v == 0; }),
+          test, "silence converted to 16 bits came back as " + to_string(values[0]));
+
+    WaveFile wave(2, 44100, 1, 16);
+    const int32_t samples[2] = {10000, -10000};
+    wave.setSamples(0, 2, samples);
+    processor.convert(wave, converted, 8);
+    converted.getSamples(0, 2, values.data());
+    check(abs(values[0] - 167) <= 1 && abs(values[1] - 88) <= 1, test,
+          "+-10000 converted to 8 bits came back as " + to_string(values[0]) + " and " + to_string(values[1]));
+}
+
+// 8-bit tracks are mixed centered on 0, two silent ones stay silent
+// and are rendered to 8 bits as 128 again
+void testMix8Bit() {
+    string test = "Mixer with 8-bit tracks";
+    WaveFile silence(1000, 44100, 1, 8);
+    vector<int32_t> values(1000, 128);
+    silence.setSamples(0, 1000, values.data());
+
+    Mixer mixer(44100, 1, 256);
+    mixer.addTrack(WaveView(silence));
+    mixer.addTrack(WaveView(silence), 500);
+    vector<float> mix(1500);
+    mixer.process(mix.data(), 1500);
+    check(all_of(mix.begin(), mix.end(), [](float v) { return v == 0.0f; }), test, "the mix is not silent");
+
+    filesystem::path path = filesystem::temp_directory_path() / "wave_tests_mix.wav";
+    WaveFile rendered;
+    bool ok = mixer.render(path.string(), 8) && rendered.read(path.string());
+    filesystem::remove(path);
+    if (!ok || rendered.length() != 1500) {
+        check(false, test, "the mix was not rendered");
+        return;
+    }
+    values.resize(1500);
+    rendered.getSamples(0, 1500, values.data());
+    check(all_of(values.begin(), values.end(), [](int32_t v) { return v == 128; }),
+          test, "silence was rendered as " + to_string(values[0]));
+}
+
+// 8-bit silence is 128, convolving it or with it has to give silence
+void testConvolve8Bit() {
+    string test = "Convolver with 8-bit waves";
+    WaveFile silence(100, 44100, 1, 8);
+    vector<int32_t> values(100, 128);
+    silence.setSamples(0, 100, values.data());
+    WaveFile wave(100, 44100, 1, 16);
+    vector<int32_t> loud(100, 10000);
+    wave.setSamples(0, 100, loud.data());
+
+    WaveFile out;
+    if (!Convolver::convolve(silence, wave, out, 64)) {
+        check(false, test, "convolve() failed");
+        return;
+    }
+    values.resize(out.length());
+    out.getSamples(0, static_cast<uint32_t>(out.length()), values.data());
+    check(all_of(values.begin(), values.end(), [](int32_t v) { return v == 128; }),
+          test, "8-bit silence came back as " + to_string(values[0]));
+
+    if (!Convolver::convolve(wave, silence, out, 64)) {
+        check(false, test, "convolve() with an 8-bit impulse failed");
+        return;
+    }
+    values.resize(out.length());
+    out.getSamples(0, static_cast<uint32_t>(out.length()), values.data());
+    check(all_of(values.begin(), values.end(), [](int32_t v) { return v == 0; }),
+          test, "an 8-bit silent impulse gave " + to_string(values[0]));
+}
+
+} // namespace
+
+int main() {
+    setLogLevel(LogLevel::Off);
+
+    test8BitRoundTrip(16, SampleFormat::PCM);
+    test8BitRoundTrip(32, SampleFormat::Float);
+    testSilenceTo8Bit(16, SampleFormat::PCM);
+    testSilenceTo8Bit(32, SampleFormat::Float);
+    test32BitRoundTrip();
+    test16BitRoundTrip();
+    testNaNToPcm();
+    testConvertEmpty();
+    testFloatDataCopies();
+    testProbeMatchesRead();
+    testWriteOverMappedFile();
+    testParallel8Bit();
+    testMix8Bit();
+    testConvolve8Bit();
+
+    if (failures != 0) {
+        cout << failures << " failed" << endl;
+        return EXIT_FAILURE;
+    }
+    cout << "All tests passed" << endl;
+    return EXIT_SUCCESS;
+}
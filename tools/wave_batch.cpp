@@ -0,0 +1,509 @@
+/*
+    Simple Wave File
+    Author: Daniel Schwartz
+
+    -- wave_batch --
+
+    Converts a whole set of wave files to one bit depth, sample format
+    and channel count.  Reading, converting and writing run as separate
+    pipeline stages, each with its own threads, connected by bounded
+    queues, so files are read and written while others are converted.
+    The memory held by files in flight is limited by --max-memory, a
+    file larger than the limit is still converted, just on its own.
+
+    The input is either a directory, which is searched for .wav files,
+    or a text file listing one wave file per line.  Files keep their
+    path relative to the input directory, or for a list to the deepest
+    directory shared by every file in it, inside the output directory.
+    A file that would overwrite the output of another one is skipped.
+
+    usage: wave_batch [options] <input directory | list file> <output directory>
+
+        --bits n            bit depth to convert to, default unchanged
+        --float, --pcm      sample format to convert to, default unchanged
+        --channels n        channel count to convert to, default unchanged
+        --readers n         reading threads, default 2
+        --converters n      converting threads, default one per core
+        --writers n         writing threads, default 2
+        --queue n           files waiting between two stages, default 4
+        --max-memory n      megabytes held by files in flight, default 1024
+*/
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <set>
+#include <filesystem>
+#include <condition_variable>
+#include "WaveFile.h"
+#include "WaveStream.h"
+#include "BoundedQueue.h"
+using namespace std;
+
+namespace {
+
+const size_t BLOCK_FRAMES = 16384;
+
+struct BatchOptions {
+    uint16_t bitDepth{0};
+    bool changeFormat{false};
+    SampleFormat sampleFormat{SampleFormat::PCM};
+    uint16_t nChannels{0};
+    unsigned readers{2};
+    unsigned converters{0};
+    unsigned writers{2};
+    size_t queueLength{4};
+    uint64_t maxMemory{1024ull << 20};
+    string input;
+    string outputDirectory;
+};
+
+// a file on its way through the pipeline
+struct BatchJob {
+    filesystem::path inPath;
+    filesystem::path outPath;
+    WaveFile wave;
+    uint64_t budget{0};
+};
+
+// the work done by one stage, shared by its threads
+struct StageStats {
+    string name;
+    unsigned nThreads{0};
+    atomic<uint64_t> files{0};
+    atomic<uint64_t> bytes{0};
+    atomic<uint64_t> busyNanos{0};
+};
+
+// limits the number of bytes held by files in flight, a request larger
+// than the whole limit is let through once nothing else is held
+class ByteBudget {
+private:
+    uint64_t m_limit;
+    uint64_t m_used;
+    mutex m_lock;
+    condition_variable m_released;
+
+public:
+    explicit ByteBudget(uint64_t limit): m_limit(limit), m_used{0}
+    {
+    }
+
+    void acquire(uint64_t bytes) {
+        unique_lock<mutex> guard(m_lock);
+        m_released.wait(guard, [&]() { return m_used + bytes <= m_limit || m_used == 0; });
+        m_used += bytes;
+    }
+
+    void release(uint64_t bytes) {
+        lock_guard<mutex> guard(m_lock);
+        m_used -= bytes;
+        m_released.notify_all();
+    }
+};
+
+// times the work of a stage
+class StageTimer {
+private:
+    StageStats &m_stats;
+    chrono::steady_clock::time_point m_start;
+
+public:
+    explicit StageTimer(StageStats &stats): m_stats(stats), m_start(chrono::steady_clock::now())
+    {
+    }
+
+    ~StageTimer() {
+        auto elapsed = chrono::steady_clock::now() - m_start;
+        m_stats.busyNanos += static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+    }
+};
+
+bool isWaveFile(const filesystem::path &path) {
+    string extension = path.extension().string();
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".wav";
+}
+
+// the deepest directory holding every one of the paths
+filesystem::path commonRoot(const vector<filesystem::path> &paths) {
+    filesystem::path root;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        filesystem::path parent = paths[i].parent_path();
+        if (i == 0) {
+            root = parent;
+            continue;
+        }
+        filesystem::path shared;
+        auto a = root.begin();
+        auto b = parent.begin();
+        for (; a != root.end() && b != parent.end() && *a == *b; ++a, ++b) {
+            shared /= *a;
+        }
+        root = shared;
+    }
+    return root;
+}
+
+// builds the list of input and output paths, returns false if the input
+// cannot be read, files whose output path is already taken are left out
+// and added to failures
+bool findInputs(const BatchOptions &options, vector<BatchJob> &jobs, vector<string> &failures) {
+    filesystem::path outDirectory(options.outputDirectory);
+    error_code error;
+
+    if (filesystem::is_directory(options.input, error)) {
+        for (const auto &entry : filesystem::recursive_directory_iterator(options.input, error)) {
+            if (entry.is_regular_file() && isWaveFile(entry.path())) {
+                BatchJob job;
+                job.inPath = entry.path();
+                job.outPath = outDirectory / filesystem::relative(entry.path(), options.input);
+                jobs.push_back(move(job));
+            }
+        }
+        return !error;
+    }
+
+    ifstream list(options.input);
+    if (!list) {
+        cerr << "Cannot open file: " << options.input << endl;
+        return false;
+    }
+
+    vector<filesystem::path> paths;
+    string line;
+    while (getline(list, line)) {
+        if (!line.empty()) {
+            paths.push_back(filesystem::absolute(line, error).lexically_normal());
+        }
+    }
+
+    // a file listed twice would be written twice to one path, so the
+    // repeats are failed rather than racing each other
+    filesystem::path root = commonRoot(paths);
+    set<filesystem::path> outputs;
+    for (const filesystem::path &path : paths) {
+        BatchJob job;
+        job.inPath = path;
+        job.outPath = outDirectory / path.lexically_relative(root);
+        if (!outputs.insert(job.outPath).second) {
+            failures.push_back(job.inPath.string() + ": listed more than once, converted only once");
+            continue;
+        }
+        jobs.push_back(move(job));
+    }
+    return true;
+}
+
+// copies a block into a buffer with a different number of channels,
+// everything is mixed down to mono, mono is copied to every channel,
+// otherwise the shared channels are copied and the rest left silent
+void remapChannels(const AudioBuffer &in, AudioBuffer &out) {
+    if (out.nChannels() == 1) {
+        float *mono = out.channel(0);
+        float scale = 1.0f / in.nChannels();
+        for (size_t i = 0; i < out.length(); ++i) {
+            float sum = 0;
+            for (uint16_t c = 0; c < in.nChannels(); ++c) {
+                sum += in.channel(c)[i];
+            }
+            mono[i] = sum * scale;
+        }
+        return;
+    }
+
+    for (uint16_t c = 0; c < out.nChannels(); ++c) {
+        if (in.nChannels() == 1) {
+            copy(in.channel(0), in.channel(0) + out.length(), out.channel(c));
+        } else if (c < in.nChannels()) {
+            copy(in.channel(c), in.channel(c) + out.length(), out.channel(c));
+        }
+    }
+}
+
+// converts in to the target format, returns true if successful
+// the channels are remapped a block at a time, then convertBitDepth()
+// changes the bit depth and format, with dither when it is reduced
+bool convertWave(const WaveFile &in, WaveFile &out, const BatchOptions &options) {
+    uint16_t bitDepth = options.bitDepth ? options.bitDepth : in.bitDepth();
+    SampleFormat format = options.changeFormat ? options.sampleFormat : in.sampleFormat();
+    uint16_t nChannels = options.nChannels ? options.nChannels : in.nChannels();
+
+    if (!isSupportedFormat(format, bitDepth)) {
+        return false;
+    }
+
+    // shares the samples of in until they are converted
+    out = in;
+
+    // 8-bit samples are unsigned, so the silent channels added by a remap
+    // would be full scale, they are widened exactly to 16 bits first and
+    // narrowed back without dither, as no resolution was added
+    DitherMode dither = DitherMode::Triangular;
+    if (nChannels != in.nChannels()) {
+        if (out.bitDepth() == 8) {
+            if (!out.convertBitDepth(16)) {
+                return false;
+            }
+            dither = DitherMode::None;
+        }
+
+        WaveFile remapped(in.length(), in.sampleRate(), nChannels, out.bitDepth(), out.sampleFormat());
+        AudioBuffer inBlock(in.nChannels(), BLOCK_FRAMES);
+        AudioBuffer outBlock(nChannels, BLOCK_FRAMES);
+        for (uint64_t start = 0; start < in.length(); start += BLOCK_FRAMES) {
+            size_t frames = out.readBuffer(start, inBlock);
+            if (frames == 0) {
+                return false;
+            }
+            remapChannels(inBlock, outBlock);
+            if (remapped.writeBuffer(start, outBlock, frames) == 0) {
+                return false;
+            }
+        }
+        out = move(remapped);
+    }
+
+    return out.convertBitDepth(bitDepth, format, dither);
+}
+
+// the number of bytes a file holds while it is in flight, the input and
+// its converted copy, found from the headers alone, returns false if
+// the file cannot be opened
+bool jobBudget(BatchJob &job, const BatchOptions &options) {
+    WaveStreamReader reader;
+    if (!reader.open(job.inPath.string())) {
+        return false;
+    }
+
+    uint16_t bitDepth = options.bitDepth ? options.bitDepth : reader.bitDepth();
+    uint16_t nChannels = options.nChannels ? options.nChannels : reader.nChannels();
+    uint64_t inSize = reader.length() * reader.nChannels() * (reader.bitDepth() / 8);
+    uint64_t outSize = reader.length() * nChannels * (bitDepth / 8);
+    job.budget = inSize + outSize;
+    return true;
+}
+
+void printStats(const vector<StageStats *> &stages, double wallSeconds) {
+    printf("%-8s %7s %7s %9s %8s %8s %10s\n", "stage", "threads", "files", "MB", "busy s", "MB/s",
+           "MB/s/thread");
+    for (const StageStats *stage : stages) {
+        double busySeconds = stage->busyNanos / 1e9;
+        double megabytes = stage->bytes / 1e6;
+        printf("%-8s %7u %7llu %9.1f %8.2f %8.1f %10.1f\n", stage->name.c_str(), stage->nThreads,
+               static_cast<unsigned long long>(stage->files.load()), megabytes, busySeconds,
+               wallSeconds > 0 ? megabytes / wallSeconds : 0.0,
+               busySeconds > 0 ? megabytes / busySeconds : 0.0);
+    }
+    printf("total time: %.2f s\n", wallSeconds);
+}
+
+bool parseOptions(int argc, char *argv[], BatchOptions &options) {
+    vector<string> positional;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--bits" && hasValue) {
+            options.bitDepth = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "--float") {
+            options.changeFormat = true;
+            options.sampleFormat = SampleFormat::Float;
+        } else if (arg == "--pcm") {
+            options.changeFormat = true;
+            options.sampleFormat = SampleFormat::PCM;
+        } else if (arg == "--channels" && hasValue) {
+            options.nChannels = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "--readers" && hasValue) {
+            options.readers = max(atoi(argv[++i]), 1);
+        } else if (arg == "--converters" && hasValue) {
+            options.converters = max(atoi(argv[++i]), 1);
+        } else if (arg == "--writers" && hasValue) {
+            options.writers = max(atoi(argv[++i]), 1);
+        } else if (arg == "--queue" && hasValue) {
+            options.queueLength = max(atoi(argv[++i]), 1);
+        } else if (arg == "--max-memory" && hasValue) {
+            options.maxMemory = static_cast<uint64_t>(max(atoll(argv[++i]), 1ll)) << 20;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            return false;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() != 2) {
+        return false;
+    }
+    options.input = positional[0];
+    options.outputDirectory = positional[1];
+
+    if (options.converters == 0) {
+        options.converters = max(thread::hardware_concurrency(), 1u);
+    }
+    if (options.bitDepth != 0) {
+        SampleFormat format = options.changeFormat ? options.sampleFormat : SampleFormat::PCM;
+        if (!isSupportedFormat(format, options.bitDepth)) {
+            cerr << "Unsupported bit depth: " << options.bitDepth << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    BatchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        cerr << "usage: wave_batch [--bits n] [--float | --pcm] [--channels n] [--readers n]" << endl;
+        cerr << "                  [--converters n] [--writers n] [--queue n] [--max-memory n]" << endl;
+        cerr << "                  <input directory | list file> <output directory>" << endl;
+        return 1;
+    }
+
+    vector<BatchJob> jobs;
+    vector<string> failures;
+    if (!findInputs(options, jobs, failures)) {
+        return 1;
+    }
+
+    StageStats readStats, convertStats, writeStats;
+    readStats.name = "read";
+    readStats.nThreads = options.readers;
+    convertStats.name = "convert";
+    convertStats.nThreads = options.converters;
+    writeStats.name = "write";
+    writeStats.nThreads = options.writers;
+
+    BoundedQueue<BatchJob> readQueue(options.queueLength);
+    BoundedQueue<BatchJob> writeQueue(options.queueLength);
+    ByteBudget budget(options.maxMemory);
+
+    atomic<size_t> nextJob{0};
+    mutex failureLock;
+    atomic<uint64_t> clipped{0};
+    auto fail = [&](const BatchJob &job, WaveError error) {
+        budget.release(job.budget);
+        string failure = job.inPath.string();
+        if (error != WaveError::None) {
+            failure += string(": ") + errorMessage(error);
+        }
+        lock_guard<mutex> guard(failureLock);
+        failures.push_back(failure);
+    };
+
+    // the library logs every file it reads and writes, that is too much
+    // for thousands of files so failures are listed at the end instead
+    LogLevel level = logLevel();
+    setLogLevel(LogLevel::Off);
+    auto start = chrono::steady_clock::now();
+
+    vector<thread> readers, converters, writers;
+    for (unsigned i = 0; i < options.readers; ++i) {
+        readers.emplace_back([&]() {
+            for (size_t index = nextJob++; index < jobs.size(); index = nextJob++) {
+                BatchJob job = move(jobs[index]);
+                if (!jobBudget(job, options)) {
+                    fail(job, WaveError::None);
+                    continue;
+                }
+                budget.acquire(job.budget);
+
+                bool ok;
+                {
+                    StageTimer timer(readStats);
+                    ok = job.wave.read(job.inPath.string());
+                }
+                if (!ok) {
+                    fail(job, job.wave.lastError());
+                    continue;
+                }
+
+                readStats.files++;
+                readStats.bytes += job.wave.dataSize();
+                readQueue.push(move(job));
+            }
+        });
+    }
+
+    for (unsigned i = 0; i < options.converters; ++i) {
+        converters.emplace_back([&]() {
+            BatchJob job;
+            while (readQueue.pop(job)) {
+                WaveFile converted;
+                bool ok;
+                {
+                    StageTimer timer(convertStats);
+                    ok = convertWave(job.wave, converted, options);
+                }
+                if (!ok) {
+                    fail(job, converted.lastError());
+                    continue;
+                }
+                clipped += converted.counters().clipped;
+
+                convertStats.files++;
+                convertStats.bytes += job.wave.dataSize();
+                job.wave = move(converted);
+                writeQueue.push(move(job));
+            }
+        });
+    }
+
+    for (unsigned i = 0; i < options.writers; ++i) {
+        writers.emplace_back([&]() {
+            BatchJob job;
+            while (writeQueue.pop(job)) {
+                bool ok;
+                {
+                    StageTimer timer(writeStats);
+                    error_code error;
+                    filesystem::create_directories(job.outPath.parent_path(), error);
+                    ok = job.wave.write(job.outPath.string());
+                }
+                if (!ok) {
+                    fail(job, job.wave.lastError());
+                    continue;
+                }
+
+                writeStats.files++;
+                writeStats.bytes += job.wave.dataSize();
+                job.wave = WaveFile();
+                budget.release(job.budget);
+            }
+        });
+    }
+
+    // each stage finishes once the one before it has
+    for (thread &reader : readers) {
+        reader.join();
+    }
+    readQueue.close();
+    for (thread &converter : converters) {
+        converter.join();
+    }
+    writeQueue.close();
+    for (thread &writer : writers) {
+        writer.join();
+    }
+
+    double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    setLogLevel(level);
+
+    printStats({&readStats, &convertStats, &writeStats}, wallSeconds);
+    if (clipped > 0) {
+        cout << "Clipped samples: " << clipped << endl;
+    }
+    for (const string &failure : failures) {
+        cerr << "Failed: " << failure << endl;
+    }
+
+    return failures.empty() ? 0 : 1;
+}